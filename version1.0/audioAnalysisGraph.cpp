@@ -0,0 +1,125 @@
+#include "audioAnalysisGraph.h"
+
+#include "console/engineAPI.h"
+#include "loopbackAudio.h"
+
+// nodes
+AudioAnalysisNode::AudioAnalysisNode(const String& key){
+   mKey = key;
+   mRequests = 0;
+   mComputes = 0;
+   mUsers = 0;
+}
+
+void AudioAnalysisNode::lockBlock(AudioSampleBlock* block){
+   mMutex.lock();
+
+   mRequests++;
+   if(mBlock != block){
+      mBlock = block;
+      mComputes++;
+      compute(block);
+   }
+}
+
+// graph
+Mutex AudioAnalysisGraph::smMutex;
+Vector<AudioAnalysisNode*> AudioAnalysisGraph::smNodes;
+
+AudioAnalysisNode* AudioAnalysisGraph::findNode(const String& key){
+   for(U32 count=0; count<smNodes.size(); count++){
+      if(smNodes[count]->getKey() == key)
+         return smNodes[count];
+   }
+   return NULL;
+}
+
+AudioAnalysisNode* AudioAnalysisGraph::acquireNode(const String& key){
+   AudioAnalysisNode* node = findNode(key);
+   if(node)
+      node->mUsers++;
+   return node;
+}
+
+void AudioAnalysisGraph::addNode(AudioAnalysisNode* node){
+   node->mUsers = 1;
+   smNodes.push_back(node);
+}
+
+void AudioAnalysisGraph::releaseNode(AudioAnalysisNode* node){
+   if(!node)
+      return;
+
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+
+   if(--node->mUsers)
+      return;
+   for(U32 count=0; count<smNodes.size(); count++){
+      if(smNodes[count] == node){
+         smNodes.erase(count);
+         break;
+      }
+   }
+   delete node;
+}
+
+U32 AudioAnalysisGraph::getNodeCount(){
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+   return smNodes.size();
+}
+
+void AudioAnalysisGraph::dump(){
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+
+   Con::printf("AudioAnalysisGraph: %d nodes", smNodes.size());
+   for(U32 count=0; count<smNodes.size(); count++){
+      AudioAnalysisNode* node = smNodes[count];
+      U32 requests = node->getRequests();
+      U32 computes = node->getComputes();
+      Con::printf("   %s: %d requests, %d computed (%.1f objects per block)", node->getKey().c_str(),
+         requests, computes, computes ? F32(requests)/computes : 0.0f);
+   }
+}
+
+// mono mix
+AudioMonoNode::AudioMonoNode() : AudioAnalysisNode("mono"){
+   mFrames = 0;
+}
+
+AudioMonoNode* AudioMonoNode::find(){
+   MutexHandle mutex;
+   mutex.lock( &AudioAnalysisGraph::getMutex(), true );
+
+   AudioAnalysisNode* node = AudioAnalysisGraph::acquireNode("mono");
+   if(!node){
+      node = new AudioMonoNode();
+      AudioAnalysisGraph::addNode(node);
+   }
+   return static_cast<AudioMonoNode*>(node);
+}
+
+void AudioMonoNode::compute(AudioSampleBlock* block){
+   mFrames = block->getFrames();
+   F32* mono = mMono.reserve<F32>(getMax(mFrames, U32(1)));
+   audioMix(mono, block->getData(), AUDIO_DATA_GAIN, mFrames);
+}
+
+const F32* AudioMonoNode::lock(AudioSampleBlock* block, U32& frames){
+   lockBlock(block);
+   frames = mFrames;
+   return mMono.reserve<F32>(getMax(mFrames, U32(1)));
+}
+
+// console
+DefineEngineFunction( dumpAudioAnalysisGraph, U32, (),,
+   "Print the shared analysis stages (mono mix, spectra) with how many objects read each one per block.\n"
+   "@param No parameters.\n"
+   "@return Number of stages.\n"
+   "@ingroup AudioLoopBack" )
+{
+   AudioAnalysisGraph::dump();
+   return AudioAnalysisGraph::getNodeCount();
+}
@@ -0,0 +1,109 @@
+#ifndef _AUDIO_ANALYSIS_GRAPH_H_
+#define _AUDIO_ANALYSIS_GRAPH_H_
+
+#include "platform/platform.h"
+#include "platform/threads/mutex.h"
+#include <core/util/tVector.h>
+#include "core/util/str.h"
+
+#include "audioFFT.h"
+#include "audioSampleRing.h"
+
+/*
+Memoized analysis stages shared by every LoopBackObject.
+The upstream part of most analyses is the same: mix the block to mono, frame it, window it,
+FFT it.  Each distinct stage and setting is one node in the graph, identified by a key
+such as "mono" or "spectrum 4096 2048 hann".  A node computes its output at most once per
+block, whichever object asks first does the work and every other object with the same
+settings reads the result, so another visualizer only costs its final reduction (band
+sums, mel filters, chroma folding ...).
+
+Nodes are created on first use and counted per object that looked them up.  Objects keep
+the node pointer, release it when their settings change or they are deleted and look it up
+again, the last release deletes the node.
+
+Usage, once per block from process_unique:
+   const F32* data = node->lock(block, ...);
+   ... read the node output ...
+   node->unlock();
+*/
+
+class AudioAnalysisNode
+{
+private:
+   Mutex mMutex;
+   String mKey;
+   // block the output was computed for, held so the pointer cannot be reused
+   AudioSampleBlockRef mBlock;
+   // objects asking for the output and blocks actually computed
+   U32 mRequests;
+   U32 mComputes;
+   // objects holding the node, changed by AudioAnalysisGraph with its mutex held
+   U32 mUsers;
+
+   friend class AudioAnalysisGraph;
+
+protected:
+   // compute the output for a new block, called with the node locked
+   virtual void compute(AudioSampleBlock* block) = 0;
+   // lock the node, computing the output for block unless it is already there
+   //    unlock must always be called afterwards
+   void lockBlock(AudioSampleBlock* block);
+
+public:
+   AudioAnalysisNode(const String& key);
+   virtual ~AudioAnalysisNode(){}
+
+   void unlock(){ mMutex.unlock(); }
+
+   const String& getKey(){ return mKey; }
+   U32 getRequests(){ return mRequests; }
+   U32 getComputes(){ return mComputes; }
+};
+
+class AudioAnalysisGraph
+{
+private:
+   static Mutex smMutex;
+   static Vector<AudioAnalysisNode*> smNodes;
+
+public:
+   // hold while looking up and adding nodes so two objects cannot add the same one
+   static Mutex& getMutex(){ return smMutex; }
+   // node with key, NULL if there is none yet
+   static AudioAnalysisNode* findNode(const String& key);
+   // node with key with one more user, NULL if there is none yet
+   static AudioAnalysisNode* acquireNode(const String& key);
+   // add a new node with one user
+   static void addNode(AudioAnalysisNode* node);
+   // drop one user of node, the last one removes and deletes it, NULL is ignored
+   //    takes the mutex itself
+   static void releaseNode(AudioAnalysisNode* node);
+
+   static U32 getNodeCount();
+   // print every node with how often it was requested and computed
+   static void dump();
+};
+
+// block mixed to mono with AUDIO_DATA_GAIN applied, one value per frame
+class AudioMonoNode : public AudioAnalysisNode
+{
+private:
+   AudioScratchBuffer mMono;
+   U32 mFrames;
+
+   AudioMonoNode();
+
+protected:
+   virtual void compute(AudioSampleBlock* block);
+
+public:
+   // get the mono node with one more user, created on first use
+   //    release with AudioAnalysisGraph::releaseNode
+   static AudioMonoNode* find();
+
+   // lock the mono mix of block, returns frames values
+   const F32* lock(AudioSampleBlock* block, U32& frames);
+};
+
+#endif // _AUDIO_ANALYSIS_GRAPH_H_
@@ -0,0 +1,412 @@
+#include "audioBeatObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(BeatObject);
+
+IMPLEMENT_CALLBACK( BeatObject, onBeat, void, ( F32 bpm, U32 beat ), ( bpm, beat ),
+   "Called on the main thread for every predicted beat.\n"
+   "@param bpm Current tempo estimate.\n"
+   "@param beat Beat count, same as getBeatCount().\n"
+   "@ingroup AudioLoopBack" );
+
+// beats are found on the analysis thread, the callback has to run on the main thread
+class BeatObjectEvent : public SimEvent
+{
+   F32 mBPM;
+   U32 mBeat;
+
+public:
+   BeatObjectEvent(F32 bpm, U32 beat){ mBPM = bpm; mBeat = beat; }
+   virtual void process(SimObject* object){
+      static_cast<BeatObject*>(object)->onBeat_callback(mBPM, mBeat);
+   }
+};
+
+BeatObject::BeatObject(){
+   objectSpectrum = NULL;
+   objectFramerRate = 0;
+   objectRequestedMinBPM = AUDIO_BEAT_MIN_BPM;
+   objectRequestedMaxBPM = AUDIO_BEAT_MAX_BPM;
+   objectMinBPM = AUDIO_BEAT_MIN_BPM;
+   objectMaxBPM = AUDIO_BEAT_MAX_BPM;
+   resetTracking();
+}
+BeatObject::~BeatObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+}
+
+void BeatObject::resetTracking(){
+   dMemset(objectOnsetCurve, 0, sizeof(objectOnsetCurve));
+   objectHopCount = 0;
+   dMemset(objectOnsetHops, 0, sizeof(objectOnsetHops));
+   objectNextTempoHop = AUDIO_BEAT_HISTORY/2;
+   objectLastLogPower.clear();
+
+   objectOnsetCount = 0;
+   objectOnsetStrength = 0.0f;
+   objectBPM = 0.0f;
+   objectTempoConfidence = 0.0f;
+   objectBeatPeriod = 0.0;
+   objectNextBeat = 0.0;
+   objectBeatCount = 0;
+}
+
+F32 BeatObject::getLowestBPM(U32 rate){
+   // estimateTempo needs three periods of the slowest tempo in the history, and the last
+   //    AUDIO_BEAT_MIN_ONSETS onsets, which take up to that many periods
+   F32 hopsPerSecond = (F32)rate/(getFrameSize(rate)/2);
+   U32 periods = getMax(U32(AUDIO_BEAT_MIN_ONSETS), U32(3));
+   return mCeil(60.0f*hopsPerSecond*periods/AUDIO_BEAT_HISTORY);
+}
+
+void BeatObject::applyTempoRange(U32 rate){
+   F32 lowest = getLowestBPM(rate);
+   if(objectRequestedMinBPM < lowest){
+      Con::warnf("BeatObject::setTempoRange - %.0f BPM is slower than the tempo history holds at %d Hz, using %.0f BPM",
+         objectRequestedMinBPM, rate, lowest);
+   }
+   objectMinBPM = mClampF(objectRequestedMinBPM, lowest, 400.0f);
+   objectMaxBPM = mClampF(objectRequestedMaxBPM, objectMinBPM + 1.0f, 400.0f);
+}
+
+void BeatObject::setTempoRange(F32 minBPM, F32 maxBPM){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+
+   objectRequestedMinBPM = minBPM;
+   objectRequestedMaxBPM = maxBPM;
+   // checked again when a stream at another rate arrives, 48 kHz until then
+   applyTempoRange(objectFramerRate ? objectFramerRate : 48000);
+}
+
+F32 BeatObject::getBPM(){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+   return objectBPM;
+}
+F32 BeatObject::getBeatPhaseLocked(){
+   if(objectBeatPeriod <= 0.0)
+      return 0.0f;
+   return mClampF(1.0f - F32((objectNextBeat - objectHopCount)/objectBeatPeriod), 0.0f, 1.0f);
+}
+F32 BeatObject::getBeatPhase(){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+   return getBeatPhaseLocked();
+}
+U32 BeatObject::getBeatCount(){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+   return objectBeatCount;
+}
+U32 BeatObject::getOnsetCount(){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+   return objectOnsetCount;
+}
+F32 BeatObject::getOnsetStrength(){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+   return objectOnsetStrength;
+}
+F32 BeatObject::getTempoConfidence(){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+   return objectTempoConfidence;
+}
+
+U32 BeatObject::getProcessedOutput(Vector<F32>& retoutput){
+   // one lock so all values are from the same hop
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+
+   retoutput.clear();
+   retoutput.push_back(objectBPM);
+   retoutput.push_back(getBeatPhaseLocked());
+   retoutput.push_back((F32)objectBeatCount);
+   retoutput.push_back((F32)objectOnsetCount);
+   mutex.unlock();
+
+   return getDataChanged();
+}
+
+void BeatObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectBeatDataMutex, true );
+
+   const F32* samples = getSampleData();
+   U32 samplesize = objectSampleBufferSamples;
+   if(!samples || !samplesize)
+      return;
+
+   // new stream, tempo and phase have to be found again
+   if(objectSamplesPerSecond != objectFramerRate){
+      U32 size = getFrameSize(objectSamplesPerSecond);
+      AudioAnalysisGraph::releaseNode(objectSpectrum);
+      objectSpectrum = AudioSharedSpectrum::find(size, size/2, AudioWindow::WindowHann);
+      applyTempoRange(objectSamplesPerSecond);
+      objectFramerRate = objectSamplesPerSecond;
+      resetTracking();
+   }
+
+   U32 frames;
+   const F32* power = objectSpectrum->lock(objectSampleBlock, frames);
+   for(U32 count=0; count<frames; count++){
+      processSpectrum(power + count*objectSpectrum->getBins());
+   }
+   objectSpectrum->unlock();
+}
+
+void BeatObject::processSpectrum(const F32* power){
+   // the nyquist bin is left out
+   U32 bins = objectSpectrum->getFrameSize()/2;
+
+   // log(1 + power) compresses loud bins so quiet instruments still register
+   objectLogPower.setSize(bins);
+   F32* logPower = objectLogPower.address();
+   for(U32 count=0; count<bins; count++)
+      logPower[count] = power[count] + 1.0f;
+   audioLog(logPower, logPower, 1.0f, bins);
+
+   // spectral flux, only increases count
+   F32 flux = 0.0f;
+   if(objectHopCount && objectLastLogPower.size() == bins){
+      const F32* lastPower = objectLastLogPower.address();
+      for(U32 count=0; count<bins; count++)
+         flux += getMax(logPower[count] - lastPower[count], 0.0f);
+      flux /= bins;
+   }
+   objectLastLogPower.setSize(bins);
+   dMemcpy(objectLastLogPower.address(), logPower, sizeof(F32)*bins);
+
+   objectOnsetCurve[objectHopCount & (AUDIO_BEAT_HISTORY-1)] = flux;
+   objectHopCount++;
+
+   detectOnset();
+   if(objectHopCount >= objectNextTempoHop){
+      estimateTempo();
+      objectNextTempoHop = objectHopCount + getMax(U32(getHopsPerSecond()*AUDIO_BEAT_TEMPO_INTERVAL_MS/1000.0f), U32(1));
+   }
+   updateBeats();
+}
+
+void BeatObject::detectOnset(){
+   F32 hopsPerSecond = getHopsPerSecond();
+   U32 meanHops = mClamp(U32(hopsPerSecond*AUDIO_BEAT_ONSET_MEAN_MS/1000.0f), 4, AUDIO_BEAT_HISTORY/2);
+   if(objectHopCount < meanHops + 2)
+      return;
+
+   // the previous value is an onset if it is a local peak well above the recent mean
+   F32 peak = getCurve(1);
+   if(peak <= getCurve(2) || peak < getCurve(0))
+      return;
+
+   F32 mean = 0.0f;
+   for(U32 count=1; count<=meanHops; count++)
+      mean += getCurve(count);
+   mean /= meanHops;
+
+   F32 threshold = mean*AUDIO_BEAT_ONSET_RATIO + AUDIO_BEAT_ONSET_FLOOR;
+   U32 gap = U32(hopsPerSecond*AUDIO_BEAT_ONSET_GAP_MS/1000.0f);
+   U32 lastOnset = objectOnsetHops[(objectOnsetCount - 1) % AUDIO_BEAT_MIN_ONSETS];
+   if(peak > threshold && (!objectOnsetCount || objectHopCount - lastOnset > gap)){
+      objectOnsetHops[objectOnsetCount % AUDIO_BEAT_MIN_ONSETS] = objectHopCount;
+      objectOnsetCount++;
+      objectOnsetStrength = peak/threshold;
+   }
+}
+
+void BeatObject::estimateTempo(){
+   F32 hopsPerSecond = getHopsPerSecond();
+   U32 length = getMin(objectHopCount, U32(AUDIO_BEAT_HISTORY));
+   U32 minLag = getMax(U32(mFloor(60.0f*hopsPerSecond/objectMaxBPM)), U32(2));
+   U32 maxLag = U32(mCeil(60.0f*hopsPerSecond/objectMinBPM));
+   // need a few periods of the slowest tempo
+   if(maxLag*3 > length)
+      return;
+   // and some onsets in them, a steady tone or silence has no tempo
+   U32 oldestOnset = objectOnsetHops[objectOnsetCount % AUDIO_BEAT_MIN_ONSETS];
+   if(objectOnsetCount < AUDIO_BEAT_MIN_ONSETS || objectHopCount - oldestOnset >= length){
+      objectTempoConfidence = 0.0f;
+      objectBeatPeriod = 0.0;
+      objectNextBeat = 0.0;
+      objectBPM = 0.0f;
+      return;
+   }
+   U32 lastLag = maxLag*2 + 2;
+
+   // mean removed copy, oldest first
+   F32 curve[AUDIO_BEAT_HISTORY];
+   F32 mean = 0.0f;
+   for(U32 count=0; count<length; count++){
+      curve[count] = getCurve(length - 1 - count);
+      mean += curve[count];
+   }
+   mean /= length;
+   F32 energy = 0.0f;
+   for(U32 count=0; count<length; count++){
+      curve[count] -= mean;
+      energy += curve[count]*curve[count];
+   }
+   if(energy <= 0.0f)
+      return;
+
+   F32 acf[AUDIO_BEAT_HISTORY];
+   for(U32 lag=minLag-1; lag<=lastLag; lag++){
+      F32 sum = 0.0f;
+      for(U32 count=lag; count<length; count++)
+         sum += curve[count]*curve[count-lag];
+      acf[lag] = sum/(length - lag);
+   }
+
+   // a lag scores its own autocorrelation plus half of the one at twice the lag, otherwise
+   //    an onset that straddles two hops makes the period look weaker than twice the period
+   // then a log gaussian weight an octave wide around 120 BPM, listeners pick the tempo
+   //    nearest 120 when the music fits two
+   F32 preferredLag = 60.0f*hopsPerSecond/120.0f;
+   U32 bestLag = 0;
+   F32 bestScore = 0.0f;
+   for(U32 lag=minLag; lag<=maxLag; lag++){
+      U32 twice = lag*2;
+      F32 harmonic = getMax(acf[twice], getMax(acf[twice-1], acf[twice+1]));
+      F32 octaves = mLog((F32)lag/preferredLag)/mLog(2.0f);
+      F32 score = (acf[lag] + 0.5f*harmonic)*mExp(-0.5f*octaves*octaves);
+      if(score > bestScore){
+         bestScore = score;
+         bestLag = lag;
+      }
+   }
+   if(!bestLag)
+      return;
+
+   // parabolic peak interpolation for a fractional period
+   F32 left = acf[bestLag-1], center = acf[bestLag], right = acf[bestLag+1];
+   F32 denom = left - 2.0f*center + right;
+   F32 offset = denom < 0.0f ? mClampF(0.5f*(left - right)/denom, -0.5f, 0.5f) : 0.0f;
+   F64 period = bestLag + offset;
+
+   // noise and music without a steady pulse, stop predicting beats
+   objectTempoConfidence = mClampF(center*length/energy, 0.0f, 1.0f);
+   if(objectTempoConfidence < AUDIO_BEAT_MIN_CONFIDENCE){
+      objectBeatPeriod = 0.0;
+      objectNextBeat = 0.0;
+      objectBPM = 0.0f;
+      return;
+   }
+   objectBeatPeriod = period;
+   objectBPM = F32(60.0*hopsPerSecond/period);
+
+   // phase, the offset where the curve sampled every period has the most energy
+   U32 periodHops = U32(period + 0.5);
+   U32 combs = getMin(U32(4), (length - 1)/periodHops);
+   U32 bestPhase = 0;
+   F32 bestSum = -1.0f;
+   for(U32 phase=0; phase<periodHops; phase++){
+      F32 sum = 0.0f;
+      for(U32 comb=0; comb<combs; comb++){
+         U32 hopsAgo = U32(phase + comb*period + 0.5);
+         if(hopsAgo < length)
+            sum += getCurve(hopsAgo);
+      }
+      if(sum > bestSum){
+         bestSum = sum;
+         bestPhase = phase;
+      }
+   }
+
+   // the last beat was bestPhase hops ago, the curve lags the audio by the peak picking hop
+   F64 predicted = F64(objectHopCount - 1) - bestPhase + period;
+   if(objectNextBeat <= 0.0){
+      objectNextBeat = predicted;
+   }else{
+      // pull the running prediction half way to the new one so the beat does not jump around
+      F64 error = predicted - objectNextBeat;
+      error -= mFloor(F32(error/period + 0.5))*period;
+      objectNextBeat += error*0.5;
+   }
+}
+
+void BeatObject::updateBeats(){
+   if(objectBeatPeriod <= 0.0)
+      return;
+
+   while(objectNextBeat <= objectHopCount){
+      objectBeatCount++;
+      objectNextBeat += objectBeatPeriod;
+
+      if(isProperlyAdded())
+         Sim::postEvent(this, new BeatObjectEvent(objectBPM, objectBeatCount), Sim::getCurrentTime());
+   }
+}
+
+// console
+DefineEngineMethod(BeatObject, setTempoRange, void, (F32 minBPM, F32 maxBPM), (AUDIO_BEAT_MIN_BPM, AUDIO_BEAT_MAX_BPM),
+   "Set the range of tempos the tracker looks for.\n"
+   "A range under an octave (eg: 90 to 170) stops it settling on half or double time.\n"
+   "@param minBPM Slowest tempo, clamped to about 44 BPM at 48 kHz with a warning.\n"
+   "@param maxBPM Fastest tempo.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setTempoRange(minBPM, maxBPM);
+}
+
+DefineEngineMethod(BeatObject, getBPM, F32, (),,
+   "Get the current tempo estimate.\n"
+   "@param Nothing.\n"
+   "@return Beats per minute, 0 until a tempo has been found.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getBPM();
+}
+
+DefineEngineMethod(BeatObject, getBeatPhase, F32, (),,
+   "Get the position in the current beat.\n"
+   "@param Nothing.\n"
+   "@return 0 on the beat rising to 1 just before the next beat.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getBeatPhase();
+}
+
+DefineEngineMethod(BeatObject, getBeatCount, S32, (),,
+   "Get the number of beats so far, compare with the last value to see if a beat happened.\n"
+   "@param Nothing.\n"
+   "@return Beat count.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getBeatCount();
+}
+
+DefineEngineMethod(BeatObject, getOnsetCount, S32, (),,
+   "Get the number of onsets (drum hits, note starts) detected so far.\n"
+   "@param Nothing.\n"
+   "@return Onset count.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getOnsetCount();
+}
+
+DefineEngineMethod(BeatObject, getOnsetStrength, F32, (),,
+   "Get the strength of the last onset.\n"
+   "@param Nothing.\n"
+   "@return Detection value over the threshold, 1 is a marginal onset.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getOnsetStrength();
+}
+
+DefineEngineMethod(BeatObject, getTempoConfidence, F32, (),,
+   "Get how periodic the onsets are at the current tempo.\n"
+   "@param Nothing.\n"
+   "@return 0 to 1, low values mean the tempo is a guess.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getTempoConfidence();
+}
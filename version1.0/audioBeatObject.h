@@ -0,0 +1,125 @@
+#ifndef _AUDIO_BEAT_OBJECT_H_
+#define _AUDIO_BEAT_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Onset and beat tracking.
+Every hop (about 10 mS) the spectral flux of a short frame is added to an onset detection
+function: the sum of the increases in log power over all bins, so a drum hit or a note
+start gives a sharp peak no matter which band it is in.  Peaks above a running mean are
+counted as onsets.
+
+Twice a second the tempo is estimated from the autocorrelation of the last 5 seconds of
+the detection function, weighted towards 120 BPM, and the beat phase is found by summing
+the detection function at the beat period for every possible offset.  Beats are predicted
+from the tempo and phase, so they keep coming through quiet passages and land on the beat
+instead of after the detected onset.
+
+Each beat calls onBeat() on the main thread, scripts can also poll getBeatCount().
+*/
+
+// analysis frame length, the hop is half of it
+#define AUDIO_BEAT_FRAME_MS 20
+// detection function values kept for tempo estimation, power of 2, ~5.5 seconds at 48 kHz
+#define AUDIO_BEAT_HISTORY 512
+#define AUDIO_BEAT_TEMPO_INTERVAL_MS 500
+#define AUDIO_BEAT_MIN_BPM 60.0f
+#define AUDIO_BEAT_MAX_BPM 200.0f
+// beats are only predicted when the autocorrelation at the period is at least this much of
+//    the total, noise gets about 0.15
+#define AUDIO_BEAT_MIN_CONFIDENCE 0.2f
+// onsets are peaks this many times above the running mean of the detection function
+//    plus the floor, the mean log power increase per bin, steady tones ripple under 0.001
+#define AUDIO_BEAT_ONSET_RATIO 1.5f
+#define AUDIO_BEAT_ONSET_FLOOR 0.01f
+// onsets needed in the history before a tempo is estimated
+#define AUDIO_BEAT_MIN_ONSETS 4
+// running mean length and shortest time between onsets
+#define AUDIO_BEAT_ONSET_MEAN_MS 350
+#define AUDIO_BEAT_ONSET_GAP_MS 50
+
+class BeatObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect beat data
+   Mutex objectBeatDataMutex;
+
+   // hann windowed spectra of AUDIO_BEAT_FRAME_MS frames at half frame hops, shared with any
+   //    other object framing the same way, looked up again when the rate changes
+   AudioSharedSpectrum* objectSpectrum;
+   U32 objectFramerRate;
+   // log power of the current and previous frame
+   Vector<F32> objectLogPower;
+   Vector<F32> objectLastLogPower;
+
+   // detection function ring, indexed by hop number
+   F32 objectOnsetCurve[AUDIO_BEAT_HISTORY];
+   U32 objectHopCount;
+   // hops of the last few onsets, newest at objectOnsetCount-1
+   U32 objectOnsetHops[AUDIO_BEAT_MIN_ONSETS];
+   U32 objectNextTempoHop;
+
+   // settings, as asked for and as used at the current rate
+   F32 objectRequestedMinBPM;
+   F32 objectRequestedMaxBPM;
+   F32 objectMinBPM;
+   F32 objectMaxBPM;
+
+   // results
+   U32 objectOnsetCount;
+   F32 objectOnsetStrength;
+   F32 objectBPM;
+   F32 objectTempoConfidence;
+   // beat period and next predicted beat in hops, period 0 until a tempo is found
+   F64 objectBeatPeriod;
+   F64 objectNextBeat;
+   U32 objectBeatCount;
+
+   // objectBeatDataMutex must be held
+   void resetTracking();
+   // clamp the requested tempo range to what the history can hold at rate
+   void applyTempoRange(U32 rate);
+   F32 getBeatPhaseLocked();
+   void processSpectrum(const F32* power);
+   void detectOnset();
+   void estimateTempo();
+   void updateBeats();
+   F32 getCurve(U32 hopsAgo){ return objectOnsetCurve[(objectHopCount - 1 - hopsAgo) & (AUDIO_BEAT_HISTORY-1)]; }
+   F32 getHopsPerSecond(){ return objectFramerRate && objectSpectrum ? (F32)objectFramerRate/objectSpectrum->getHopSize() : 0.0f; }
+   // spectrum frame size at rate
+   static U32 getFrameSize(U32 rate){ return AudioFramer::roundFrameSize(rate*AUDIO_BEAT_FRAME_MS/1000); }
+
+public:
+   BeatObject();
+   virtual ~BeatObject();
+
+   virtual void process_unique();
+
+   // tempo search range, a range under an octave avoids locking onto half or double time
+   //    the history holds four periods of about 44 BPM at 48 kHz, slower tempos are clamped
+   //    to getLowestBPM() with a warning
+   void setTempoRange(F32 minBPM, F32 maxBPM);
+   // slowest tempo the detection function history can track at rate
+   static F32 getLowestBPM(U32 rate);
+
+   F32 getBPM();
+   // 0 at a beat rising to 1 just before the next one
+   F32 getBeatPhase();
+   U32 getBeatCount();
+   U32 getOnsetCount();
+   // detection value of the last onset over the threshold, 1 is a marginal onset
+   F32 getOnsetStrength();
+   // autocorrelation at the beat period over the autocorrelation at lag 0
+   F32 getTempoConfidence();
+
+   // bpm, beat phase, beat count, onset count
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput);
+
+   DECLARE_CALLBACK( void, onBeat, ( F32 bpm, U32 beat ) );
+   DECLARE_CONOBJECT(BeatObject);
+};
+
+#endif // _AUDIO_BEAT_OBJECT_H_
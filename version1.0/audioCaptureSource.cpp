@@ -0,0 +1,626 @@
+#include "audioCaptureSource.h"
+
+#include "core/stream/fileStream.h"
+#include "math/mMath.h"
+
+#ifdef TORQUE_OS_WIN
+#include "platformWin32/platformWin32.h"
+#include <mmsystem.h>
+#define INITGUID
+#include <mmdeviceapi.h>
+#undef INITGUID
+#include <Audioclient.h>
+#include <Audiopolicy.h>
+#include <Mmreg.h>
+#endif
+
+AudioCaptureSource* AudioCaptureSource::create(const char* type, const char* params, bool realtime){
+   if(!type || !type[0] || !dStricmp(type, "wasapi")){
+#ifdef TORQUE_OS_WIN
+      return new AudioCaptureSourceWASAPI();
+#else
+      Con::warnf("AudioCaptureSource::create - wasapi loopback is only available on Windows.");
+      return NULL;
+#endif
+   }
+   if(!dStricmp(type, "wav")){
+      if(!params || !params[0]){
+         Con::warnf("AudioCaptureSource::create - wav source requires a file name.");
+         return NULL;
+      }
+      return new AudioCaptureSourceWAV(params, realtime);
+   }
+   if(!dStricmp(type, "synth")){
+      AudioCaptureSourceSynth* synth = new AudioCaptureSourceSynth(params, realtime);
+      if(!synth->parseSpec(params)){
+         delete synth;
+         return NULL;
+      }
+      return synth;
+   }
+
+   Con::warnf("AudioCaptureSource::create - unknown source type: %s", type);
+   return NULL;
+}
+
+#ifdef TORQUE_OS_WIN
+
+// WASAPI loopback capture
+//    this is the capture code that used to live in AudioLoopbackThread::run
+
+#define AUDIOLB_EXIT_ON_ERROR(hres)  \
+      if (FAILED(hres)) { goto Exit; }
+#define AUDIOLB_SAFE_RELEASE(punk)  \
+      if ((punk) != NULL)  \
+         { (punk)->Release(); (punk) = NULL; }
+
+struct AudioCaptureSourceWASAPI::WASAPIState
+{
+   HRESULT hr;
+   REFERENCE_TIME hnsRequestedDuration;
+   REFERENCE_TIME hnsActualDuration;
+   UINT32 bufferFrameCount;
+   UINT32 numFramesAvailable;
+   IMMDeviceEnumerator *pEnumerator;
+   IMMDevice *pDevice;
+   IAudioClient *pAudioClient;
+   IAudioCaptureClient *pCaptureClient;
+   WAVEFORMATEX *pwfx;
+   UINT32 packetLength;
+   BYTE *pData;
+   DWORD flags;
+   bool started;
+};
+
+AudioCaptureSourceWASAPI::AudioCaptureSourceWASAPI(){
+   mState = new WASAPIState;
+   mState->hr = S_OK;
+   mState->hnsRequestedDuration = REFTIMES_PER_SEC;
+   mState->hnsActualDuration = 0;
+   mState->pEnumerator = NULL;
+   mState->pDevice = NULL;
+   mState->pAudioClient = NULL;
+   mState->pCaptureClient = NULL;
+   mState->pwfx = NULL;
+   mState->packetLength = 0;
+   mState->started = false;
+}
+AudioCaptureSourceWASAPI::~AudioCaptureSourceWASAPI(){
+   close();
+   delete mState;
+}
+
+bool AudioCaptureSourceWASAPI::open(){
+   WASAPIState& s = *mState;
+
+   // init audio device
+   s.hr = CoCreateInstance(
+      __uuidof(MMDeviceEnumerator),
+      NULL, CLSCTX_ALL,
+      __uuidof(IMMDeviceEnumerator),
+      (void**)&s.pEnumerator);
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   s.hr = s.pEnumerator->GetDefaultAudioEndpoint(
+      eRender, eConsole, &s.pDevice); // eCapture changed to eRender for loopback
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   s.hr = s.pDevice->Activate(
+      __uuidof(IAudioClient),
+      CLSCTX_ALL, NULL,
+      (void**)&s.pAudioClient);
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   s.hr = s.pAudioClient->GetMixFormat(&s.pwfx);
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   // ensure format is something we can use
+   if(s.pwfx->wFormatTag == WAVE_FORMAT_IEEE_FLOAT){
+      if(s.pwfx->nChannels < AUDIO_NUM_CHANNELS) // need stereo
+         s.hr = -1;
+   }else if(s.pwfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE){
+      PWAVEFORMATEXTENSIBLE pEx = reinterpret_cast<PWAVEFORMATEXTENSIBLE>(s.pwfx);
+      if(IsEqualGUID(KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, pEx->SubFormat)){
+         if(s.pwfx->nChannels < AUDIO_NUM_CHANNELS) // need stereo
+            s.hr = -1;
+      }else{
+         s.hr = -1;
+      }
+   }else{
+      s.hr = -1;
+   }
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   s.hr = s.pAudioClient->Initialize(
+      AUDCLNT_SHAREMODE_SHARED,
+      AUDCLNT_STREAMFLAGS_LOOPBACK, // 0 changed to AUDCLNT_STREAMFLAGS_LOOPBACK for loopback
+      s.hnsRequestedDuration,
+      0,
+      s.pwfx,
+      NULL);
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   // Get the size of the allocated buffer.
+   s.hr = s.pAudioClient->GetBufferSize(&s.bufferFrameCount);
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   s.hr = s.pAudioClient->GetService(
+      __uuidof(IAudioCaptureClient),
+      (void**)&s.pCaptureClient);
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   // Calculate the actual duration of the allocated buffer.
+   s.hnsActualDuration = (double)REFTIMES_PER_SEC * s.bufferFrameCount / s.pwfx->nSamplesPerSec;
+   mSamplesPerSecond = s.pwfx->nSamplesPerSec;
+
+   s.hr = s.pAudioClient->Start();  // Start recording.
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+   s.started = true;
+
+   return true;
+
+Exit:
+   Con::warnf("AudioCaptureSourceWASAPI::open - loopback error: %X", s.hr);
+   close();
+   return false;
+}
+
+void AudioCaptureSourceWASAPI::close(){
+   WASAPIState& s = *mState;
+
+   if(s.started && s.pAudioClient){
+      s.pAudioClient->Stop();  // Stop recording.
+      s.started = false;
+   }
+
+   // clean up init
+   if(s.pwfx){
+      CoTaskMemFree(s.pwfx);
+      s.pwfx = NULL;
+   }
+   AUDIOLB_SAFE_RELEASE(s.pEnumerator)
+   AUDIOLB_SAFE_RELEASE(s.pDevice)
+   AUDIOLB_SAFE_RELEASE(s.pAudioClient)
+   AUDIOLB_SAFE_RELEASE(s.pCaptureClient)
+}
+
+void AudioCaptureSourceWASAPI::waitForData(){
+   Sleep(mState->hnsActualDuration/REFTIMES_PER_MILLISEC/2);
+}
+
+bool AudioCaptureSourceWASAPI::read(AudioSampleRing& ring){
+   WASAPIState& s = *mState;
+
+   s.hr = s.pCaptureClient->GetNextPacketSize(&s.packetLength);
+   AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+   while(s.packetLength != 0)
+   {
+      // Get the available data in the shared buffer.
+      s.hr = s.pCaptureClient->GetBuffer(
+         &s.pData,
+         &s.numFramesAvailable,
+         &s.flags, NULL, NULL);
+      AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+      // capture was not serviced in time and the device dropped data
+      if (s.flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY)
+         mDiscontinuities++;
+
+      if (s.flags & AUDCLNT_BUFFERFLAGS_SILENT)
+      {
+          s.pData = NULL;  // Tell CopyData to write silence.
+      }
+
+      if(s.pData != NULL){
+         F32 *pFloatData = reinterpret_cast<F32*>(s.pData);
+         U32 channels = s.pwfx->nChannels;
+         U32 frames = s.numFramesAvailable;
+         // copy the first two channels straight into the ring
+         while(frames){
+            F32 *dest;
+            U32 span = ring.reserve(frames, dest);
+            for(U32 count=0; count<span; count++){
+               dest[count*AUDIO_NUM_CHANNELS+0] = pFloatData[count*channels+0];
+               dest[count*AUDIO_NUM_CHANNELS+1] = pFloatData[count*channels+1];
+            }
+            ring.commit(span);
+            pFloatData += span*channels;
+            frames -= span;
+         }
+      }else{
+         // do calcs with zero for values
+         // not needed, the value will zero out after audio source is removed
+      }
+
+      // release data
+      s.hr = s.pCaptureClient->ReleaseBuffer(s.numFramesAvailable);
+      AUDIOLB_EXIT_ON_ERROR(s.hr)
+
+      // start next capture
+      s.hr = s.pCaptureClient->GetNextPacketSize(&s.packetLength);
+      AUDIOLB_EXIT_ON_ERROR(s.hr)
+   }
+
+   return true;
+
+Exit:
+   // debug, not really thread safe
+   Con::warnf("AudioCaptureSourceWASAPI::read - loopback error: %X", s.hr);
+   return false;
+}
+
+#endif // TORQUE_OS_WIN
+
+// timed sources
+AudioCaptureSourceTimed::AudioCaptureSourceTimed(bool realtime){
+   mRealtime = realtime;
+   mHopFrames = 0;
+   mStartTime = 0;
+   mFramesDelivered = 0;
+   mFramesDue = 0;
+}
+
+void AudioCaptureSourceTimed::waitForData(){
+   if(!mHopFrames)
+      mHopFrames = (mSamplesPerSecond*AUDIO_CAPTURE_HOP_MS)/1000;
+
+   if(!mRealtime){
+      // deliver a full hop every cycle as fast as the consumer can take it
+      mFramesDue = mHopFrames;
+      return;
+   }
+
+   // sleep for one hop then deliver whatever frames are due based on elapsed time
+   //    keeps the average rate exact even if the sleep is not
+   if(!mStartTime){
+      mStartTime = Platform::getRealMilliseconds();
+      mFramesDelivered = 0;
+   }
+   Platform::sleep((mHopFrames*1000)/mSamplesPerSecond);
+
+   U32 elapsed = Platform::getRealMilliseconds() - mStartTime;
+   U64 target = ((U64)elapsed*mSamplesPerSecond)/1000;
+   mFramesDue = target > mFramesDelivered ? U32(target - mFramesDelivered) : 0;
+}
+
+bool AudioCaptureSourceTimed::read(AudioSampleRing& ring){
+   U32 frames = mFramesDue;
+   while(frames){
+      F32* dest;
+      U32 span = ring.reserve(frames, dest);
+      generate(dest, span);
+      ring.commit(span);
+      frames -= span;
+   }
+
+   mFramesDelivered += mFramesDue;
+   mFramesDue = 0;
+
+   return true;
+}
+
+// wav file replay
+AudioCaptureSourceWAV::AudioCaptureSourceWAV(const char* filename, bool realtime, bool loop)
+:Parent(realtime)
+{
+   mFileName = filename;
+   mLoop = loop;
+   mPosition = 0;
+}
+
+bool AudioCaptureSourceWAV::open(){
+   FileStream stream;
+   if(!stream.open(mFileName, Torque::FS::File::Read)){
+      Con::warnf("AudioCaptureSourceWAV::open - could not open: %s", mFileName.c_str());
+      return false;
+   }
+
+   char tag[4];
+   U32 chunkSize;
+   stream.read(4, tag);
+   stream.read(&chunkSize);
+   if(dStrncmp(tag, "RIFF", 4)){
+      Con::warnf("AudioCaptureSourceWAV::open - not a RIFF file: %s", mFileName.c_str());
+      return false;
+   }
+   stream.read(4, tag);
+   if(dStrncmp(tag, "WAVE", 4)){
+      Con::warnf("AudioCaptureSourceWAV::open - not a WAVE file: %s", mFileName.c_str());
+      return false;
+   }
+
+   U16 formatTag = 0;
+   U16 channels = 0;
+   U32 samplesPerSecond = 0;
+   U16 bitsPerSample = 0;
+   bool haveFormat = false;
+
+   // walk the chunks looking for fmt and data
+   U32 streamSize = stream.getStreamSize();
+   while(stream.getPosition() + 8 <= streamSize){
+      stream.read(4, tag);
+      stream.read(&chunkSize);
+      U32 chunkStart = stream.getPosition();
+
+      if(!dStrncmp(tag, "fmt ", 4)){
+         U32 byteRate;
+         U16 blockAlign;
+         stream.read(&formatTag);
+         stream.read(&channels);
+         stream.read(&samplesPerSecond);
+         stream.read(&byteRate);
+         stream.read(&blockAlign);
+         stream.read(&bitsPerSample);
+         // WAVE_FORMAT_EXTENSIBLE, the real format is the first 2 bytes of the sub format guid
+         if(formatTag == 0xFFFE && chunkSize >= 26){
+            U16 extSize, validBits;
+            U32 channelMask;
+            stream.read(&extSize);
+            stream.read(&validBits);
+            stream.read(&channelMask);
+            stream.read(&formatTag);
+         }
+         haveFormat = true;
+      }else if(!dStrncmp(tag, "data", 4)){
+         if(!haveFormat)
+            break;
+
+         bool isFloat = formatTag == 3 && bitsPerSample == 32;
+         bool isPCM = formatTag == 1 && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+         if((!isFloat && !isPCM) || !channels){
+            Con::warnf("AudioCaptureSourceWAV::open - unsupported format %d (%d bits): %s", formatTag, bitsPerSample, mFileName.c_str());
+            return false;
+         }
+
+         U32 bytesPerSample = bitsPerSample/8;
+         // clamp to what is actually in the file, some writers leave the size at zero or max
+         if(chunkSize > streamSize - chunkStart)
+            chunkSize = streamSize - chunkStart;
+         U32 frames = chunkSize/(bytesPerSample*channels);
+
+         Vector<U8> raw;
+         raw.setSize(frames*bytesPerSample*channels);
+         stream.read(raw.size(), raw.address());
+
+         // convert to stereo float, mono is copied to both channels and extra channels are dropped
+         mData.setSize(frames*AUDIO_NUM_CHANNELS);
+         const U8* src = raw.address();
+         for(U32 count=0; count<frames; count++){
+            for(U32 ch=0; ch<AUDIO_NUM_CHANNELS; ch++){
+               U32 srcch = ch < channels ? ch : 0;
+               const U8* p = src + (count*channels + srcch)*bytesPerSample;
+               F32 value;
+               if(isFloat){
+                  dMemcpy(&value, p, sizeof(F32));
+               }else if(bitsPerSample == 16){
+                  S16 v = S16(p[0] | (p[1] << 8));
+                  value = F32(v)/32768.0f;
+               }else if(bitsPerSample == 24){
+                  S32 v = S32((p[0] << 8) | (p[1] << 16) | (p[2] << 24)) >> 8;
+                  value = F32(v)/8388608.0f;
+               }else{
+                  S32 v = S32(p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24));
+                  value = F32(F64(v)/2147483648.0);
+               }
+               mData[count*AUDIO_NUM_CHANNELS+ch] = value;
+            }
+         }
+
+         mSamplesPerSecond = samplesPerSecond;
+         mPosition = 0;
+         mStartTime = 0;
+         mFramesDelivered = 0;
+         return frames != 0;
+      }
+
+      // chunks are word aligned
+      stream.setPosition(chunkStart + chunkSize + (chunkSize & 0x1));
+   }
+
+   Con::warnf("AudioCaptureSourceWAV::open - no usable fmt/data chunks in: %s", mFileName.c_str());
+   return false;
+}
+
+void AudioCaptureSourceWAV::close(){
+   mData.clear();
+   mData.compact();
+}
+
+void AudioCaptureSourceWAV::generate(F32* dest, U32 count){
+   U32 frames = mData.size()/AUDIO_NUM_CHANNELS;
+   while(count){
+      if(mPosition >= frames){
+         if(mLoop && frames){
+            mPosition = 0;
+         }else{
+            // pad with silence at the end of the file
+            dMemset(dest, 0, sizeof(F32)*count*AUDIO_NUM_CHANNELS);
+            return;
+         }
+      }
+      U32 chunk = getMin(count, frames - mPosition);
+      dMemcpy(dest, mData.address() + mPosition*AUDIO_NUM_CHANNELS, sizeof(F32)*chunk*AUDIO_NUM_CHANNELS);
+      dest += chunk*AUDIO_NUM_CHANNELS;
+      mPosition += chunk;
+      count -= chunk;
+   }
+}
+
+// synthetic signals
+AudioCaptureSourceSynth::AudioCaptureSourceSynth(const char* spec, bool realtime, U32 samplesPerSecond)
+:Parent(realtime)
+{
+   mSpec = spec;
+   mSamplesPerSecond = samplesPerSecond;
+}
+
+bool AudioCaptureSourceSynth::parseSpec(const char* spec){
+   mComponents.clear();
+   if(!spec || !spec[0])
+      spec = "sine 440 0.5";
+
+   U32 len = dStrlen(spec);
+   char *buff = new char[len+1];
+   dStrcpy(buff, spec);
+
+   // split on ';' by hand since each component is then tokenized with dStrtok
+   char *comp = buff;
+   while(comp){
+      char *next = dStrchr(comp, ';');
+      if(next)
+         *next++ = '\0';
+
+      F64 args[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      U32 numargs = 0;
+      char *name = dStrtok(comp, " \t");
+      char *value = dStrtok(NULL, " \t");
+      while(value != NULL && numargs < 6){
+         args[numargs++] = dAtof(value);
+         value = dStrtok(NULL, " \t");
+      }
+
+      if(name && !dStricmp(name, "rate")){
+         // not a component, sample rate of the whole signal
+         if(numargs < 1 || args[0] < 8000.0 || args[0] > 192000.0){
+            Con::warnf("AudioCaptureSourceSynth::parseSpec - rate must be 8000 to 192000 Hz");
+            delete [] buff;
+            return false;
+         }
+         mSamplesPerSecond = U32(args[0]);
+      }else if(name){
+         Component c;
+         c.amplitude = 0.5f;
+         c.freqStart = 0.0;
+         c.freqEnd = 0.0;
+         c.duration = 0.0;
+         c.pan = 0.0f;
+         c.phase = 0.0;
+         c.frame = 0;
+         c.startSeed = 0x12345678;
+
+         bool valid = true;
+         if(!dStricmp(name, "sine")){
+            c.type = SignalSine;
+            c.freqStart = args[0];
+            if(numargs > 1) c.amplitude = F32(args[1]);
+            if(numargs > 2) c.pan = F32(args[2]);
+            valid = numargs >= 1;
+         }else if(!dStricmp(name, "sweep")){
+            c.type = SignalSweep;
+            c.freqStart = args[0];
+            c.freqEnd = args[1];
+            c.duration = args[2];
+            if(numargs > 3) c.amplitude = F32(args[3]);
+            if(numargs > 4) c.pan = F32(args[4]);
+            valid = numargs >= 3 && c.freqStart > 0.0 && c.freqEnd > 0.0 && c.duration > 0.0;
+         }else if(!dStricmp(name, "noise")){
+            c.type = SignalNoise;
+            if(numargs > 0) c.amplitude = F32(args[0]);
+            if(numargs > 1) c.startSeed = U32(args[1]) | 0x1;
+         }else if(!dStricmp(name, "impulse")){
+            c.type = SignalImpulse;
+            c.freqStart = args[0];
+            c.amplitude = numargs > 1 ? F32(args[1]) : 1.0f;
+            valid = numargs >= 1 && c.freqStart > 0.0;
+         }else{
+            valid = false;
+         }
+
+         if(valid){
+            c.seed = c.startSeed;
+            mComponents.push_back(c);
+         }else{
+            Con::warnf("AudioCaptureSourceSynth::parseSpec - bad component: %s", name);
+            delete [] buff;
+            return false;
+         }
+      }
+
+      comp = next;
+   }
+
+   delete [] buff;
+   return mComponents.size() != 0;
+}
+
+bool AudioCaptureSourceSynth::open(){
+   // reset state so every run produces the same data
+   for(U32 i=0; i<mComponents.size(); i++){
+      mComponents[i].phase = 0.0;
+      mComponents[i].frame = 0;
+      mComponents[i].seed = mComponents[i].startSeed;
+   }
+   mStartTime = 0;
+   mFramesDelivered = 0;
+   return mComponents.size() != 0;
+}
+
+void AudioCaptureSourceSynth::generate(F32* dest, U32 count){
+   dMemset(dest, 0, sizeof(F32)*count*AUDIO_NUM_CHANNELS);
+
+   const F64 rate = F64(mSamplesPerSecond);
+   for(U32 i=0; i<mComponents.size(); i++){
+      Component& c = mComponents[i];
+      // constant power pan, unity gain on both channels at center
+      F32 gainL = c.amplitude*mCos((c.pan+1.0f)*M_PI_F*0.25f)*1.41421356f;
+      F32 gainR = c.amplitude*mSin((c.pan+1.0f)*M_PI_F*0.25f)*1.41421356f;
+
+      switch(c.type){
+      case SignalSine:{
+         F64 inc = M_2PI*c.freqStart/rate;
+         for(U32 n=0; n<count; n++){
+            F32 v = (F32)mSin(c.phase);
+            dest[n*AUDIO_NUM_CHANNELS+0] += v*gainL;
+            dest[n*AUDIO_NUM_CHANNELS+1] += v*gainR;
+            c.phase += inc;
+            if(c.phase >= M_2PI)
+               c.phase -= M_2PI;
+         }
+         break;
+      }
+      case SignalSweep:{
+         // exponential sweep from freqStart to freqEnd over duration, then restart
+         // at least one frame for sweeps shorter than a sample
+         U64 sweepFrames = getMax(U64(c.duration*rate), U64(1));
+         F64 ratio = mLog(c.freqEnd/c.freqStart);
+         for(U32 n=0; n<count; n++){
+            F64 t = F64(c.frame)/F64(sweepFrames);
+            F64 freq = c.freqStart*mExp(ratio*t);
+            F32 v = (F32)mSin(c.phase);
+            dest[n*AUDIO_NUM_CHANNELS+0] += v*gainL;
+            dest[n*AUDIO_NUM_CHANNELS+1] += v*gainR;
+            c.phase += M_2PI*freq/rate;
+            if(c.phase >= M_2PI)
+               c.phase -= M_2PI;
+            if(++c.frame >= sweepFrames){
+               c.frame = 0;
+               c.phase = 0.0;
+            }
+         }
+         break;
+      }
+      case SignalNoise:{
+         // white noise from a fixed seed LCG, independent per channel
+         for(U32 n=0; n<count*AUDIO_NUM_CHANNELS; n++){
+            c.seed = c.seed*1664525 + 1013904223;
+            F32 v = F32(S32(c.seed))/2147483648.0f;
+            dest[n] += v*c.amplitude;
+         }
+         break;
+      }
+      case SignalImpulse:{
+         // single sample clicks at a fixed rate
+         U64 period = getMax(U64(rate/c.freqStart), U64(1));
+         for(U32 n=0; n<count; n++){
+            if(c.frame % period == 0){
+               dest[n*AUDIO_NUM_CHANNELS+0] += gainL;
+               dest[n*AUDIO_NUM_CHANNELS+1] += gainR;
+            }
+            c.frame++;
+         }
+         break;
+      }
+      }
+   }
+}
@@ -0,0 +1,184 @@
+#ifndef _AUDIO_CAPTURE_SOURCE_H_
+#define _AUDIO_CAPTURE_SOURCE_H_
+
+#include "platform/platform.h"
+#include <core/util/tVector.h>
+#include "core/util/str.h"
+#include "console/console.h"
+
+#include "audioSampleRing.h"
+
+/*
+Capture sources feed interleaved stereo float data to the AudioLoopbackThread.
+The thread calls waitForData() then read() once per cycle, read() writes straight into
+the sample ring and the thread publishes the packet afterwards.  Realtime sources pace
+themselves in waitForData(), non realtime sources return immediately so the
+analysis pipeline can be driven faster than realtime for testing and benchmarks.
+
+Available sources:
+   AudioCaptureSourceWASAPI - default render device loopback (Windows only)
+   AudioCaptureSourceWAV    - replay of a wav file (16/24/32 bit pcm or 32 bit float)
+   AudioCaptureSourceSynth  - deterministic generated signal (sines, sweeps, noise, impulses)
+*/
+
+#define AUDIO_NUM_CHANNELS 2
+
+//#define REFTIMES_PER_SEC  10000000
+//#define REFTIMES_PER_SEC  (10000000/20) // run every 50 mS
+#define REFTIMES_PER_SEC  (10000000/10) // run every 100 mS - much better freq delineation at the low end
+//#define REFTIMES_PER_SEC  (10000000/5) // run every 200 mS
+//#define REFTIMES_PER_SEC  (10000000/50) // run every 20 mS
+#define REFTIMES_PER_MILLISEC  (REFTIMES_PER_SEC/1000)
+
+// amount of data delivered per cycle by the file and synthetic sources, same as the WASAPI request
+//    REFERENCE_TIME is in 100 nS units
+#define AUDIO_CAPTURE_HOP_MS (REFTIMES_PER_SEC/10000)
+
+class AudioCaptureSource
+{
+protected:
+   // samples per second of the data returned by read()
+   U32 mSamplesPerSecond;
+   // number of times the source lost data before read() got to it
+   U32 mDiscontinuities;
+
+public:
+   AudioCaptureSource(){ mSamplesPerSecond = 0; mDiscontinuities = 0; }
+   virtual ~AudioCaptureSource(){}
+
+   // acquire device or data, returns false if the source cannot be used
+   virtual bool open() = 0;
+   // release device or data, called from the thread that called open()
+   virtual void close() = 0;
+   // block until the next packet of data is expected
+   virtual void waitForData() = 0;
+   // commit captured frames to the ring as interleaved stereo (AUDIO_NUM_CHANNELS)
+   //    the frames are not visible to readers until the ring is published
+   // returns false on an unrecoverable error
+   virtual bool read(AudioSampleRing& ring) = 0;
+
+   U32 getSamplesPerSecond(){ return mSamplesPerSecond; }
+   U32 getDiscontinuities(){ return mDiscontinuities; }
+   virtual const char* getSourceName() = 0;
+
+   // create a source from script parameters
+   //    type: "wasapi", "wav" or "synth"
+   //    params: file name for "wav", signal description for "synth"
+   //    realtime: pace the file and synthetic sources at the sample rate
+   static AudioCaptureSource* create(const char* type, const char* params, bool realtime);
+};
+
+#ifdef TORQUE_OS_WIN
+class AudioCaptureSourceWASAPI : public AudioCaptureSource
+{
+private:
+   struct WASAPIState;
+   WASAPIState* mState;
+
+public:
+   AudioCaptureSourceWASAPI();
+   virtual ~AudioCaptureSourceWASAPI();
+
+   virtual bool open();
+   virtual void close();
+   virtual void waitForData();
+   virtual bool read(AudioSampleRing& ring);
+   virtual const char* getSourceName(){ return "wasapi"; }
+};
+#endif
+
+// base for sources that generate or replay data at a fixed hop size
+class AudioCaptureSourceTimed : public AudioCaptureSource
+{
+protected:
+   bool mRealtime;
+   U32 mHopFrames;
+   // realtime pacing
+   U32 mStartTime;
+   U64 mFramesDelivered;
+   U32 mFramesDue;
+
+public:
+   AudioCaptureSourceTimed(bool realtime);
+
+   virtual void waitForData();
+   virtual bool read(AudioSampleRing& ring);
+
+   // generate count stereo frames into dest
+   virtual void generate(F32* dest, U32 count) = 0;
+
+   void setHopFrames(U32 frames){ mHopFrames = frames; }
+   U32 getHopFrames(){ return mHopFrames; }
+};
+
+class AudioCaptureSourceWAV : public AudioCaptureSourceTimed
+{
+   typedef AudioCaptureSourceTimed Parent;
+
+private:
+   String mFileName;
+   bool mLoop;
+   // whole file converted to interleaved stereo float
+   Vector<F32> mData;
+   U32 mPosition;
+
+public:
+   AudioCaptureSourceWAV(const char* filename, bool realtime, bool loop = true);
+
+   virtual bool open();
+   virtual void close();
+   virtual void generate(F32* dest, U32 count);
+   virtual const char* getSourceName(){ return "wav"; }
+};
+
+class AudioCaptureSourceSynth : public AudioCaptureSourceTimed
+{
+   typedef AudioCaptureSourceTimed Parent;
+
+public:
+   enum SignalType {
+      SignalSine = 0,
+      SignalSweep,
+      SignalNoise,
+      SignalImpulse,
+   };
+
+   // one component of the generated signal, components are summed
+   struct Component {
+      SignalType type;
+      F32 amplitude;
+      F64 freqStart;  // sine freq, sweep start freq, impulse rate in Hz
+      F64 freqEnd;    // sweep end freq
+      F64 duration;   // sweep length in seconds, sweep repeats
+      F32 pan;        // -1 left, 0 center, 1 right
+      U32 startSeed;  // noise seed
+      // running state
+      F64 phase;
+      U64 frame;
+      U32 seed;
+   };
+
+private:
+   String mSpec;
+   Vector<Component> mComponents;
+
+public:
+   AudioCaptureSourceSynth(const char* spec, bool realtime, U32 samplesPerSecond = 48000);
+
+   // spec is a semicolon separated list of components:
+   //    "sine <freq> [amp] [pan]"
+   //    "sweep <startfreq> <endfreq> <seconds> [amp] [pan]"  (logarithmic)
+   //    "noise [amp] [seed]"
+   //    "impulse <rate hz> [amp]"
+   //    "rate <hz>"  (sample rate of the whole signal, 48000 when not given)
+   // eg: "sine 440 0.5; sweep 20 20000 10 0.25; noise 0.05"
+   //     "rate 44100; sine 1000 0.5"
+   bool parseSpec(const char* spec);
+
+   virtual bool open();
+   virtual void close(){}
+   virtual void generate(F32* dest, U32 count);
+   virtual const char* getSourceName(){ return "synth"; }
+};
+
+#endif // _AUDIO_CAPTURE_SOURCE_H_
@@ -0,0 +1,461 @@
+#include "audioChromaObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(ChromaObject);
+
+// Krumhansl-Kessler probe tone ratings, from the tonic up in semitones
+static const F32 sMajorProfile[AUDIO_CHROMA_CLASSES] = {
+   6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f
+};
+static const F32 sMinorProfile[AUDIO_CHROMA_CLASSES] = {
+   6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f
+};
+
+static const char* sKeyNames[AUDIO_CHROMA_KEYS] = {
+   "C major", "C# major", "D major", "Eb major", "E major", "F major",
+   "F# major", "G major", "Ab major", "A major", "Bb major", "B major",
+   "C minor", "C# minor", "D minor", "Eb minor", "E minor", "F minor",
+   "F# minor", "G minor", "G# minor", "A minor", "Bb minor", "B minor"
+};
+
+// spectra whose loudest pitch class is below this are silence and leave the key alone
+#define AUDIO_CHROMA_MIN_POWER 1e-10f
+
+ChromaObject::ChromaObject(){
+   objectFrameSize = AUDIO_CHROMA_FRAME_SIZE;
+   objectHopSize = U32(AUDIO_CHROMA_FRAME_SIZE*(1.0f - AUDIO_CHROMA_OVERLAP));
+   objectWindowType = AUDIO_FFT_WINDOW;
+   objectSpectrum = NULL;
+
+   objectMinFreq = AUDIO_CHROMA_MIN_FREQ;
+   objectMaxFreq = AUDIO_CHROMA_MAX_FREQ;
+   objectTuning = AUDIO_CHROMA_TUNING;
+   objectKeyTime = AUDIO_CHROMA_KEY_TIME;
+
+   objectTableDirty = true;
+   objectTableRate = 0;
+   objectSmoothing = AUDIO_FFT_SMOOTHING;
+   objectKeySmoothing = 0.0f;
+   objectFirstBin = 0;
+
+   // profiles rotated to every tonic, zero mean and unit length so a dot product is the correlation
+   for(U32 key=0; key<AUDIO_CHROMA_KEYS; key++){
+      const F32* profile = key < AUDIO_CHROMA_CLASSES ? sMajorProfile : sMinorProfile;
+      U32 tonic = key%AUDIO_CHROMA_CLASSES;
+      F32 mean = 0.0f;
+      for(U32 count=0; count<AUDIO_CHROMA_CLASSES; count++)
+         mean += profile[count];
+      mean /= AUDIO_CHROMA_CLASSES;
+      F32 length = 0.0f;
+      for(U32 count=0; count<AUDIO_CHROMA_CLASSES; count++){
+         F32 value = profile[(count + AUDIO_CHROMA_CLASSES - tonic)%AUDIO_CHROMA_CLASSES] - mean;
+         objectKeyProfiles[key][count] = value;
+         length += value*value;
+      }
+      for(U32 count=0; count<AUDIO_CHROMA_CLASSES; count++)
+         objectKeyProfiles[key][count] /= mSqrt(length);
+   }
+
+   dMemset(objectChromaBuffer, 0, sizeof(objectChromaBuffer));
+   dMemset(objectKeyChroma, 0, sizeof(objectKeyChroma));
+   dMemset(objectKeyCorrelations, 0, sizeof(objectKeyCorrelations));
+   AudioChromaOutput.setSize(AUDIO_CHROMA_CLASSES);
+   AudioChromaOutput.fill(0.0f);
+   objectKey = -1;
+   objectKeyConfidence = 0.0f;
+}
+ChromaObject::~ChromaObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+}
+
+void ChromaObject::setFrameSize(U32 size, F32 overlap){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   objectFrameSize = AudioFramer::roundFrameSize(size);
+   objectHopSize = getMax(U32(objectFrameSize*(1.0f - mClampF(overlap, 0.0f, 0.9f))), U32(1));
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+   objectSpectrum = NULL;
+   objectTableDirty = true;
+}
+
+void ChromaObject::setWindowType(AudioWindow::WindowType type){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   objectWindowType = type;
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+   objectSpectrum = NULL;
+}
+
+void ChromaObject::setPitchRange(F32 minFreq, F32 maxFreq){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   objectMinFreq = getMax(minFreq, 1.0f);
+   objectMaxFreq = getMax(maxFreq, objectMinFreq + 1.0f);
+   objectTableDirty = true;
+}
+
+void ChromaObject::setTuning(F32 freq){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   objectTuning = mClampF(freq, 400.0f, 480.0f);
+   objectTableDirty = true;
+}
+
+void ChromaObject::setKeyTime(F32 seconds){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   objectKeyTime = getMax(seconds, 0.1f);
+   objectTableDirty = true;
+}
+
+void ChromaObject::buildTable(){
+   U32 bins = objectFrameSize/2 + 1;
+   F32 binHz = (F32)objectSamplesPerSecond/objectFrameSize;
+   U32 first = getMax(U32(mCeil(objectMinFreq/binHz)), U32(1));
+   U32 end = getMin(U32(mFloor(getMin(objectMaxFreq, objectSamplesPerSecond*0.5f)/binHz)) + 1, bins);
+   end = getMax(end, first);
+
+   objectFirstBin = first;
+   objectBinClasses.setSize(end - first);
+   objectBinWeights.setSize(end - first);
+   for(U32 bin=first; bin<end; bin++){
+      // semitones above C0, A4 is 57
+      F32 semitone = 12.0f*mLog(bin*binHz/objectTuning)/mLog(2.0f) + 57.0f;
+      F32 nearest = mFloor(semitone + 0.5f);
+      F32 offset = semitone - nearest;
+      // raised cosine, 1 on the semitone and 0 half way between
+      F32 weight = mCos(M_PI_F*offset);
+      objectBinClasses[bin - first] = U32(S32(nearest) % AUDIO_CHROMA_CLASSES + AUDIO_CHROMA_CLASSES) % AUDIO_CHROMA_CLASSES;
+      objectBinWeights[bin - first] = weight*weight;
+   }
+
+   objectSmoothing = getHopSmoothing(AUDIO_FFT_SMOOTHING, objectHopSize, objectSamplesPerSecond);
+   objectKeySmoothing = 1.0f - mExp(-(F32)objectHopSize/(objectSamplesPerSecond*objectKeyTime));
+   objectTableRate = objectSamplesPerSecond;
+   objectTableDirty = false;
+}
+
+void ChromaObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   if(!getSampleData() || !objectSampleBufferSamples)
+      return;
+
+   if(objectTableDirty || objectTableRate != objectSamplesPerSecond)
+      buildTable();
+   if(!objectSpectrum)
+      objectSpectrum = AudioSharedSpectrum::find(objectFrameSize, objectHopSize, objectWindowType);
+
+   U32 frames;
+   const F32* power = objectSpectrum->lock(objectSampleBlock, frames);
+   for(U32 count=0; count<frames; count++){
+      processSpectrum(power + count*objectSpectrum->getBins());
+   }
+   objectSpectrum->unlock();
+}
+
+void ChromaObject::processSpectrum(const F32* power){
+   // fold the bins into pitch classes
+   F32* chroma = objectChromaBuffer;
+   dMemset(chroma, 0, sizeof(objectChromaBuffer));
+   const F32* src = power + objectFirstBin;
+   const U32* classes = objectBinClasses.address();
+   const F32* weights = objectBinWeights.address();
+   U32 count = objectBinClasses.size();
+   for(U32 bin=0; bin<count; bin++)
+      chroma[classes[bin]] += src[bin]*weights[bin];
+
+   F32 loudest = 0.0f;
+   for(U32 pitch=0; pitch<AUDIO_CHROMA_CLASSES; pitch++)
+      loudest = getMax(loudest, chroma[pitch]);
+   if(loudest < AUDIO_CHROMA_MIN_POWER){
+      // let the display fall back to 0, the key keeps its last estimate
+      dMemset(chroma, 0, sizeof(objectChromaBuffer));
+      audioSmooth(AudioChromaOutput.address(), chroma, objectSmoothing, AUDIO_CHROMA_CLASSES);
+      return;
+   }
+   for(U32 pitch=0; pitch<AUDIO_CHROMA_CLASSES; pitch++)
+      chroma[pitch] /= loudest;
+
+   audioSmooth(AudioChromaOutput.address(), chroma, objectSmoothing, AUDIO_CHROMA_CLASSES);
+   audioSmooth(objectKeyChroma, chroma, objectKeySmoothing, AUDIO_CHROMA_CLASSES);
+   updateKey();
+}
+
+void ChromaObject::updateKey(){
+   // correlation of the running chroma with each profile, the profiles are already zero
+   //    mean and unit length
+   F32 mean = 0.0f;
+   for(U32 pitch=0; pitch<AUDIO_CHROMA_CLASSES; pitch++)
+      mean += objectKeyChroma[pitch];
+   mean /= AUDIO_CHROMA_CLASSES;
+   F32 centered[AUDIO_CHROMA_CLASSES];
+   F32 length = 0.0f;
+   for(U32 pitch=0; pitch<AUDIO_CHROMA_CLASSES; pitch++){
+      centered[pitch] = objectKeyChroma[pitch] - mean;
+      length += centered[pitch]*centered[pitch];
+   }
+   if(length <= 0.0f)
+      return;
+   length = 1.0f/mSqrt(length);
+
+   S32 best = 0;
+   for(U32 key=0; key<AUDIO_CHROMA_KEYS; key++){
+      F32 sum = 0.0f;
+      for(U32 pitch=0; pitch<AUDIO_CHROMA_CLASSES; pitch++)
+         sum += centered[pitch]*objectKeyProfiles[key][pitch];
+      objectKeyCorrelations[key] = sum*length;
+      if(objectKeyCorrelations[key] > objectKeyCorrelations[best])
+         best = key;
+   }
+   objectKey = best;
+   objectKeyConfidence = getMax(objectKeyCorrelations[best], 0.0f);
+}
+
+void ChromaObject::getChromaOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioChromaOutput);
+}
+S32 ChromaObject::getKey(){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+   return objectKey;
+}
+F32 ChromaObject::getKeyConfidence(){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+   return objectKeyConfidence;
+}
+void ChromaObject::getKeyCorrelations(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   retoutput.clear();
+   for(U32 key=0; key<AUDIO_CHROMA_KEYS; key++)
+      retoutput.push_back(objectKeyCorrelations[key]);
+}
+
+const char* ChromaObject::getKeyName(S32 key){
+   if(key < 0 || key >= AUDIO_CHROMA_KEYS)
+      return "";
+   return sKeyNames[key];
+}
+
+U32 ChromaObject::getProcessedOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectChromaDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioChromaOutput);
+   retoutput.push_back((F32)objectKey);
+   retoutput.push_back(objectKeyConfidence);
+   mutex.unlock();
+
+   return getDataChanged();
+}
+
+// console
+DefineEngineMethod(ChromaObject, setFrameSize, void, (U32 size, F32 overlap), (AUDIO_CHROMA_FRAME_SIZE, AUDIO_CHROMA_OVERLAP),
+   "Set the FFT frame size and overlap, same as FFTObject.  Longer frames separate low notes better.\n"
+   "@param size Frame size in samples, rounded up to a power of 2 (64 to 32768).\n"
+   "@param overlap Fraction of each frame shared with the next (0 to 0.9).\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setFrameSize(size, overlap);
+}
+
+DefineEngineMethod(ChromaObject, setWindow, void, (const char* window), ("hann"),
+   "Set the window applied to each FFT frame, same as FFTObject.\n"
+   "@param window \"hann\" (default), \"hamming\", \"blackmanharris\" or \"flattop\".\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   AudioWindow::WindowType type = AudioWindow::getTypeFromName(window);
+   if(type == AudioWindow::WindowTypeCount){
+      Con::warnf("ChromaObject::setWindow - unknown window: %s", window);
+      return;
+   }
+   object->setWindowType(type);
+}
+
+DefineEngineMethod(ChromaObject, setPitchRange, void, (F32 minFreq, F32 maxFreq), (AUDIO_CHROMA_MIN_FREQ, AUDIO_CHROMA_MAX_FREQ),
+   "Set the part of the spectrum folded into the chroma.\n"
+   "@param minFreq Lowest frequency in Hz, below about 12 bins per octave notes blur together.\n"
+   "@param maxFreq Highest frequency in Hz, limited to half the sample rate.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setPitchRange(minFreq, maxFreq);
+}
+
+DefineEngineMethod(ChromaObject, setTuning, void, (F32 freq), (AUDIO_CHROMA_TUNING),
+   "Set the reference pitch the semitones are measured from.\n"
+   "@param freq Frequency of A4 in Hz (400 to 480).\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setTuning(freq);
+}
+
+DefineEngineMethod(ChromaObject, setKeyTime, void, (F32 seconds), (AUDIO_CHROMA_KEY_TIME),
+   "Set how long the key estimate averages over.  Shorter follows modulations faster but "
+   "jumps around on single chords.\n"
+   "@param seconds Time constant in seconds.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setKeyTime(seconds);
+}
+
+DefineEngineMethod(ChromaObject, getChromaOutput, const char*, (),,
+   "Get the energy of each pitch class.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of 12 floats from C to B, the strongest is 1.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getChromaOutput(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+DefineEngineMethod(ChromaObject, getKey, S32, (),,
+   "Get the estimated key as a number.\n"
+   "@param Nothing.\n"
+   "@return 0 to 11 for C major to B major, 12 to 23 for C minor to B minor, -1 if unknown.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getKey();
+}
+
+DefineEngineMethod(ChromaObject, getKeyName, const char*, (),,
+   "Get the estimated key as text.\n"
+   "@param Nothing.\n"
+   "@return Key name such as \"A minor\", empty if unknown.\n"
+   "@ingroup AudioLoopBack")
+{
+   return ChromaObject::getKeyName(object->getKey());
+}
+
+DefineEngineMethod(ChromaObject, getKeyConfidence, F32, (),,
+   "Get how well the music fits the estimated key.\n"
+   "@param Nothing.\n"
+   "@return Correlation with the key profile, 0 to 1, tonal music is usually above 0.6.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getKeyConfidence();
+}
+
+DefineEngineMethod(ChromaObject, getKeyCorrelations, const char*, (),,
+   "Get the correlation of the music with every key.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of 24 floats, C major to B major then C minor to B minor.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getKeyCorrelations(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.3f");
+}
+
+// self test
+//    synthetic triads through a ChromaObject, outside of the capture thread
+DefineEngineFunction( testAudioChroma, bool, (),,
+   "Feed ChromaObject 4 seconds each of C major, A minor and D major triads from the synth capture "
+   "source and check that the three strongest pitch classes are the notes of the chord and the key "
+   "is the chord's own.\n"
+   "@param Nothing.\n"
+   "@return True if every chord passed, false on a mismatch or if the audio loopback thread is running.\n"
+   "@ingroup AudioLoopBack" )
+{
+   // the object shares the analysis graph nodes with the live ones
+   if(_activeLoopbackThread != NULL){
+      Con::warnf("testAudioChroma: Stop the active audio loopback thread first.");
+      return false;
+   }
+
+   // root position triads around middle C, their pitch classes and key
+   struct ChordTest { const char* spec; U32 classes[3]; S32 key; };
+   static const ChordTest sChords[] = {
+      { "sine 261.63 0.2; sine 329.63 0.2; sine 392.00 0.2", { 0, 4, 7 }, 0 },
+      { "sine 220.00 0.2; sine 261.63 0.2; sine 329.63 0.2", { 0, 4, 9 }, 21 },
+      { "sine 293.66 0.2; sine 369.99 0.2; sine 440.00 0.2", { 2, 6, 9 }, 2 },
+   };
+   static const char* sClassNames[AUDIO_CHROMA_CLASSES] = {
+      "C", "C#", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B"
+   };
+   const U32 hops = 4000/AUDIO_CAPTURE_HOP_MS;
+
+   bool passed = true;
+   AudioSampleRing ring;
+   for(U32 test=0; test<sizeof(sChords)/sizeof(sChords[0]); test++){
+      const ChordTest& chord = sChords[test];
+      AudioCaptureSource* synth = AudioCaptureSource::create("synth", chord.spec, false);
+      if(!synth || !synth->open()){
+         Con::warnf("testAudioChroma: Could not create synth source: %s", chord.spec);
+         delete synth;
+         return false;
+      }
+      U32 rate = synth->getSamplesPerSecond();
+      if(!ring.isAllocated())
+         ring.allocate(rate*AUDIO_CAPTURE_HOP_MS/1000*4, AUDIO_NUM_CHANNELS);
+      ring.reset(rate);
+
+      ChromaObject* chroma = new ChromaObject();
+      for(U32 count=0; count<hops; count++){
+         synth->waitForData();
+         synth->read(ring);
+         U32 frames = ring.getPendingFrames();
+         U32 index = ring.publish() - frames;
+         AudioSampleBlockRef block = AudioSampleBlock::create(ring, index, frames, count);
+         chroma->process(block);
+      }
+      synth->close();
+      delete synth;
+
+      // three strongest classes, strongest first
+      Vector<F32> output;
+      chroma->getChromaOutput(output);
+      U32 top[3] = { 0, 0, 0 };
+      for(U32 rank=0; rank<3; rank++){
+         F32 best = -1.0f;
+         for(U32 pitch=0; pitch<output.size(); pitch++){
+            if(output[pitch] > best && (!rank || pitch != top[0]) && (rank < 2 || pitch != top[1])){
+               best = output[pitch];
+               top[rank] = pitch;
+            }
+         }
+      }
+
+      S32 key = chroma->getKey();
+      bool match = key == chord.key;
+      for(U32 note=0; note<3; note++){
+         U32 pitch = chord.classes[note];
+         match = match && (top[0] == pitch || top[1] == pitch || top[2] == pitch);
+      }
+      passed = passed && match;
+
+      Con::printf("testAudioChroma: %s  notes %s %s %s  key %s (%.2f)  %s", chord.spec,
+         sClassNames[top[0]], sClassNames[top[1]], sClassNames[top[2]],
+         ChromaObject::getKeyName(key), chroma->getKeyConfidence(), match ? "ok" : "FAILED");
+      delete chroma;
+   }
+
+   return passed;
+}
@@ -0,0 +1,111 @@
+#ifndef _AUDIO_CHROMA_OBJECT_H_
+#define _AUDIO_CHROMA_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Harmony: chroma (energy per pitch class C, C#, D ... B whatever the octave) and an estimate
+of the musical key.
+Every bin of the power spectrum between the pitch range limits belongs to the nearest
+semitone, the bin to pitch class table and the weights (highest on the semitone, 0 half way
+to the next) are built once per frame size and sample rate so each hop is one pass over
+the bins.  The chroma is normalised so the strongest class is 1.
+
+The key is found by correlating a long running average of the chroma with the
+Krumhansl-Kessler major and minor key profiles in all 12 transpositions.  The average is
+exponential, each hop moves it towards the new chroma by the share of the setKeyTime()
+time constant the hop covers, so only one chroma of running state is kept.
+
+The spectrum comes from the AudioSharedSpectrum.  The default frame is longer than the
+FFTObject one, 8192 samples keeps neighbouring semitones apart down to about 100 Hz at
+48 kHz.
+*/
+
+#define AUDIO_CHROMA_CLASSES 12
+#define AUDIO_CHROMA_KEYS 24
+#define AUDIO_CHROMA_FRAME_SIZE 8192
+#define AUDIO_CHROMA_OVERLAP 0.5f
+#define AUDIO_CHROMA_MIN_FREQ 100.0f
+#define AUDIO_CHROMA_MAX_FREQ 5000.0f
+// frequency of A4
+#define AUDIO_CHROMA_TUNING 440.0f
+// time constant of the key average in seconds
+#define AUDIO_CHROMA_KEY_TIME 8.0f
+
+class ChromaObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect chroma data
+   Mutex objectChromaDataMutex;
+
+   U32 objectFrameSize;
+   U32 objectHopSize;
+   AudioWindow::WindowType objectWindowType;
+   // looked up again when NULL
+   AudioSharedSpectrum* objectSpectrum;
+
+   F32 objectMinFreq;
+   F32 objectMaxFreq;
+   F32 objectTuning;
+   F32 objectKeyTime;
+
+   // bin table and smoothing are set up for objectTableRate, rebuilt when dirty
+   bool objectTableDirty;
+   U32 objectTableRate;
+   F32 objectSmoothing;
+   F32 objectKeySmoothing;
+   // bin objectFirstBin+n adds objectBinWeights[n] of its power to class objectBinClasses[n]
+   U32 objectFirstBin;
+   Vector<U32> objectBinClasses;
+   Vector<F32> objectBinWeights;
+   // zero mean, unit length key profiles, 12 major keys from C then 12 minor keys
+   F32 objectKeyProfiles[AUDIO_CHROMA_KEYS][AUDIO_CHROMA_CLASSES];
+
+   F32 objectChromaBuffer[AUDIO_CHROMA_CLASSES];
+   F32 objectKeyChroma[AUDIO_CHROMA_CLASSES];
+   F32 objectKeyCorrelations[AUDIO_CHROMA_KEYS];
+   Vector<F32> AudioChromaOutput;
+   S32 objectKey;
+   F32 objectKeyConfidence;
+
+   // objectChromaDataMutex must be held
+   void buildTable();
+   void processSpectrum(const F32* power);
+   void updateKey();
+
+public:
+   ChromaObject();
+   virtual ~ChromaObject();
+
+   virtual void process_unique();
+
+   // same as FFTObject
+   void setFrameSize(U32 size, F32 overlap);
+   void setWindowType(AudioWindow::WindowType type);
+   // range of the spectrum folded into the chroma in Hz
+   void setPitchRange(F32 minFreq, F32 maxFreq);
+   // frequency of A4 in Hz
+   void setTuning(F32 freq);
+   // time constant of the key estimate in seconds
+   void setKeyTime(F32 seconds);
+
+   // 12 values from C, the strongest is 1
+   void getChromaOutput(Vector<F32>& retoutput);
+   // 0 to 11 major keys from C, 12 to 23 minor keys from C, -1 before any pitched audio
+   S32 getKey();
+   // correlation of the chroma average with the key profile, 0 to 1
+   F32 getKeyConfidence();
+   // correlation with all 24 keys
+   void getKeyCorrelations(Vector<F32>& retoutput);
+
+   static const char* getKeyName(S32 key);
+
+   // chroma followed by the key and the key confidence
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput);
+
+   DECLARE_CONOBJECT(ChromaObject);
+};
+
+#endif // _AUDIO_CHROMA_OBJECT_H_
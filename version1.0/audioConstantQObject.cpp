@@ -0,0 +1,257 @@
+#include "audioConstantQObject.h"
+
+#include "console/engineAPI.h"
+
+IMPLEMENT_CONOBJECT(ConstantQObject);
+
+ConstantQObject::ConstantQObject(){
+   objectMinFreq = AUDIO_CQ_MIN_FREQ;
+   objectMaxFreq = AUDIO_CQ_MAX_FREQ;
+   objectBinsPerOctave = AUDIO_CQ_BINS_PER_OCTAVE;
+   objectHopSize = AUDIO_CQ_HOP_SIZE;
+
+   objectKernelDirty = true;
+   objectKernelRate = 0;
+   objectFFTSize = 0;
+   objectSmoothing = AUDIO_FFT_SMOOTHING;
+
+   objectMono = AudioMonoNode::find();
+}
+ConstantQObject::~ConstantQObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectCQDataMutex, true );
+
+   AudioAnalysisGraph::releaseNode(objectMono);
+}
+
+void ConstantQObject::setRange(F32 minFreq, F32 maxFreq, U32 binsPerOctave){
+   MutexHandle mutex;
+   mutex.lock( &objectCQDataMutex, true );
+
+   objectMinFreq = getMax(minFreq, 1.0f);
+   objectMaxFreq = getMax(maxFreq, objectMinFreq);
+   objectBinsPerOctave = mClamp(binsPerOctave, 1, 96);
+   objectKernelDirty = true;
+}
+
+void ConstantQObject::setHopSize(U32 hop){
+   MutexHandle mutex;
+   mutex.lock( &objectCQDataMutex, true );
+
+   objectHopSize = getMax(hop, U32(1));
+   objectKernelDirty = true;
+}
+
+void ConstantQObject::getBinFrequencies(Vector<F32>& retfreqs){
+   MutexHandle mutex;
+   mutex.lock( &objectCQDataMutex, true );
+
+   retfreqs.clear();
+   retfreqs.merge(objectBinFreqs);
+}
+
+void ConstantQObject::getCQOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectCQDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(objectOutput);
+}
+
+void ConstantQObject::buildKernel(){
+   U32 rate = objectSamplesPerSecond;
+   F32 nyquist = rate*0.5f;
+
+   // Q is the number of cycles in each bin's window
+   F64 q = 1.0/(mPow(2.0f, 1.0f/objectBinsPerOctave) - 1.0);
+
+   // bins stop at maxFreq or a little under nyquist
+   objectBinFreqs.clear();
+   F32 maxFreq = getMin(objectMaxFreq, nyquist*0.95f);
+   for(U32 bin=0; ; bin++){
+      F32 freq = objectMinFreq*mPow(2.0f, (F32)bin/objectBinsPerOctave);
+      if(freq > maxFreq)
+         break;
+      objectBinFreqs.push_back(freq);
+   }
+   U32 bins = objectBinFreqs.size();
+
+   // the lowest bin has the longest window, very low bins are limited to the largest frame
+   //    and lose some of their Q
+   U32 longest = U32(mCeil(F32(q*rate/objectMinFreq)));
+   objectFFTSize = AudioFramer::roundFrameSize(longest);
+   objectFramer.setup(objectFFTSize, getMin(objectHopSize, objectFFTSize));
+
+   objectKernelBins.setSize(bins);
+   objectKernelRe.clear();
+   objectKernelIm.clear();
+
+   U32 size = objectFFTSize;
+   U32 spectrum = size/2 + 1;
+   Vector<F32> temporalRe, temporalIm, spectrumRe, spectrumIm;
+   temporalRe.setSize(size);
+   temporalIm.setSize(size);
+   spectrumRe.setSize(size + 2);
+   spectrumIm.setSize(size + 2);
+
+   AudioFFTPlan* plan = AudioFFTPlanCache::acquire(size);
+   for(U32 bin=0; bin<bins; bin++){
+      F32 freq = objectBinFreqs[bin];
+      U32 length = getMin(U32(q*rate/freq), size);
+
+      // hann windowed complex exponential centered in the frame, scaled so the sum is normalised
+      temporalRe.fill(0.0f);
+      temporalIm.fill(0.0f);
+      U32 start = (size - length)/2;
+      F64 step = M_2PI*freq/rate;
+      for(U32 count=0; count<length; count++){
+         F64 window = (0.5 - 0.5*mCos(M_2PI*count/(F64)length))/(F64)length;
+         temporalRe[start+count] = F32(window*mCos(step*count));
+         temporalIm[start+count] = F32(window*mSin(step*count));
+      }
+
+      // complex kernel spectrum from two real transforms, positive frequencies only
+      //    K = FFT(re) + i*FFT(im), then divided by size for the inverse relation
+      plan->forward(temporalRe.address(), spectrumRe.address());
+      plan->forward(temporalIm.address(), spectrumIm.address());
+      F32 peak = 0.0f;
+      for(U32 count=0; count<spectrum; count++){
+         F32 kr = spectrumRe[count*2+0] - spectrumIm[count*2+1];
+         F32 ki = spectrumRe[count*2+1] + spectrumIm[count*2+0];
+         spectrumRe[count*2+0] = kr/size;
+         spectrumRe[count*2+1] = ki/size;
+         peak = getMax(peak, mSqrt(kr*kr + ki*ki)/size);
+      }
+
+      // keep the run of bins around the peak that are above the threshold
+      F32 threshold = peak*AUDIO_CQ_KERNEL_THRESHOLD;
+      U32 first = 0, last = 0;
+      bool found = false;
+      for(U32 count=0; count<spectrum; count++){
+         F32 kr = spectrumRe[count*2+0];
+         F32 ki = spectrumRe[count*2+1];
+         if(mSqrt(kr*kr + ki*ki) >= threshold){
+            if(!found)
+               first = count;
+            last = count;
+            found = true;
+         }
+      }
+
+      KernelBin& kernel = objectKernelBins[bin];
+      kernel.firstBin = first;
+      kernel.count = found ? last - first + 1 : 0;
+      kernel.offset = objectKernelRe.size();
+      for(U32 count=0; count<kernel.count; count++){
+         objectKernelRe.push_back(spectrumRe[(first+count)*2+0]);
+         objectKernelIm.push_back(spectrumRe[(first+count)*2+1]);
+      }
+   }
+   AudioFFTPlanCache::release(plan);
+
+   objectPower.setSize(bins);
+   if(objectOutput.size() != bins){
+      objectOutput.setSize(bins);
+      objectOutput.fill(0.0f);
+   }
+   objectSmoothing = getHopSmoothing(AUDIO_FFT_SMOOTHING, objectFramer.getHopSize(), rate);
+
+   objectKernelRate = rate;
+   objectKernelDirty = false;
+}
+
+void ConstantQObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectCQDataMutex, true );
+
+   const F32* samples = getSampleData();
+   U32 samplesize = objectSampleBufferSamples;
+   if(!samples || !samplesize)
+      return;
+
+   // also resets the framer
+   if(objectKernelDirty || objectKernelRate != objectSamplesPerSecond)
+      buildKernel();
+
+   // the kernels carry the windows, frames are only mixed
+   U32 frames;
+   const F32* mono = objectMono->lock(objectSampleBlock, frames);
+   objectFramer.write(mono, frames);
+   objectMono->unlock();
+
+   const F32* frame;
+   while((frame = objectFramer.nextFrame()) != NULL){
+      processFrame(frame);
+   }
+}
+
+void ConstantQObject::processFrame(const F32* frame){
+   AudioFFTPlan* plan = AudioFFTPlanCache::acquire(objectFFTSize);
+   F32* out = objectFFTOutput.reserve<F32>(objectFFTSize+2);
+   plan->forward(frame, out);
+   AudioFFTPlanCache::release(plan);
+
+   // each bin is the spectrum times the conjugate of its kernel
+   const F32* kernelRe = objectKernelRe.address();
+   const F32* kernelIm = objectKernelIm.address();
+   for(U32 bin=0; bin<objectKernelBins.size(); bin++){
+      const KernelBin& kernel = objectKernelBins[bin];
+      const F32* x = out + kernel.firstBin*2;
+      const F32* kr = kernelRe + kernel.offset;
+      const F32* ki = kernelIm + kernel.offset;
+      F32 re = 0.0f, im = 0.0f;
+      for(U32 count=0; count<kernel.count; count++){
+         re += x[count*2+0]*kr[count] + x[count*2+1]*ki[count];
+         im += x[count*2+1]*kr[count] - x[count*2+0]*ki[count];
+      }
+      objectPower[bin] = re*re + im*im;
+   }
+
+   audioLog(objectPower.address(), objectPower.address(), 1.0f, objectPower.size());
+   audioSmooth(objectOutput.address(), objectPower.address(), objectSmoothing, objectOutput.size());
+}
+
+// console
+DefineEngineMethod(ConstantQObject, setRange, void, (F32 minFreq, F32 maxFreq, U32 binsPerOctave), (AUDIO_CQ_MIN_FREQ, AUDIO_CQ_MAX_FREQ, AUDIO_CQ_BINS_PER_OCTAVE),
+   "Set the frequency range and resolution.\n"
+   "The lowest frequency sets the FFT size, 30 Hz at 12 bins per octave needs a 32768 sample frame.\n"
+   "@param minFreq Center of the lowest bin in Hz.\n"
+   "@param maxFreq Highest bin center in Hz, limited to just under nyquist.\n"
+   "@param binsPerOctave Bins per octave, 12 is one per semitone.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setRange(minFreq, maxFreq, binsPerOctave);
+}
+
+DefineEngineMethod(ConstantQObject, setHopSize, void, (U32 hop), (AUDIO_CQ_HOP_SIZE),
+   "Set the number of samples between spectra.\n"
+   "@param hop Hop size in samples.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setHopSize(hop);
+}
+
+DefineEngineMethod(ConstantQObject, getBinFrequencies, const char*, (),,
+   "Get the center frequency of each bin.  Empty until audio has been processed.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> freqs;
+   object->getBinFrequencies(freqs);
+   return formatAudioFloatList(freqs, "%.2f");
+}
+
+DefineEngineMethod(ConstantQObject, getCQOutput, const char*, (),,
+   "Get the smoothed log power of each bin.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> output;
+   object->getCQOutput(output);
+   return formatAudioFloatList(output, "%.4f");
+}
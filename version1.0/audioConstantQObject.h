@@ -0,0 +1,89 @@
+#ifndef _AUDIO_CONSTANT_Q_OBJECT_H_
+#define _AUDIO_CONSTANT_Q_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Constant-Q spectrum: log spaced bins with the same number of bins per octave everywhere,
+so the bass gets as many bins as the treble.  Each bin's analysis window is Q cycles
+of its own frequency, long for low bins and short for high ones.
+
+Uses the sparse spectral kernel method (Brown and Puckette 1992).  The windowed complex
+exponential for every bin is transformed once when the settings or sample rate change,
+only the few FFT bins around each kernel's peak are kept.  Each frame then needs one FFT
+of the longest window plus a short dot product per bin.
+*/
+
+#define AUDIO_CQ_MIN_FREQ 30.0f
+#define AUDIO_CQ_MAX_FREQ 16000.0f
+#define AUDIO_CQ_BINS_PER_OCTAVE 12
+// frames between spectra, ~21 mS at 48 kHz
+#define AUDIO_CQ_HOP_SIZE 1024
+// kernel values smaller than this fraction of the kernel peak are dropped
+#define AUDIO_CQ_KERNEL_THRESHOLD 0.0054f
+
+class ConstantQObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect CQ data
+   Mutex objectCQDataMutex;
+
+   // settings
+   F32 objectMinFreq;
+   F32 objectMaxFreq;
+   U32 objectBinsPerOctave;
+   U32 objectHopSize;
+
+   // kernel for objectKernelRate, rebuilt when dirty
+   bool objectKernelDirty;
+   U32 objectKernelRate;
+   U32 objectFFTSize;
+   // contiguous run of FFT bins for each CQ bin, coefficients start at offset
+   struct KernelBin {
+      U32 firstBin;
+      U32 count;
+      U32 offset;
+   };
+   Vector<KernelBin> objectKernelBins;
+   Vector<F32> objectKernelRe;
+   Vector<F32> objectKernelIm;
+   Vector<F32> objectBinFreqs;
+
+   // shared mono mix of each block, cut into FFT size frames
+   AudioMonoNode* objectMono;
+   AudioFramer objectFramer;
+   AudioScratchBuffer objectFFTOutput;
+   Vector<F32> objectPower;
+   Vector<F32> objectOutput;
+   F32 objectSmoothing;
+
+   // objectCQDataMutex must be held
+   void buildKernel();
+   void processFrame(const F32* frame);
+
+public:
+   ConstantQObject();
+   virtual ~ConstantQObject();
+
+   virtual void process_unique();
+
+   // bins run from minFreq up to maxFreq (or nyquist) with binsPerOctave per octave
+   void setRange(F32 minFreq, F32 maxFreq, U32 binsPerOctave);
+   // frames between spectra
+   void setHopSize(U32 hop);
+
+   // center frequency of each bin, empty until the first block has been processed
+   void getBinFrequencies(Vector<F32>& retfreqs);
+   // smoothed log power per bin
+   void getCQOutput(Vector<F32>& retoutput);
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput){
+      getCQOutput(retoutput);
+      return getDataChanged();
+   }
+
+   DECLARE_CONOBJECT(ConstantQObject);
+};
+
+#endif // _AUDIO_CONSTANT_Q_OBJECT_H_
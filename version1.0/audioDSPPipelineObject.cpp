@@ -0,0 +1,735 @@
+#include "audioDSPPipelineObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(DSPPipelineObject);
+
+static const char* sFilterNames[] = { "lowpass", "highpass", "bandpass" };
+
+DSPPipelineObject::DSPPipelineObject(){
+   objectScheduleDirty = true;
+   objectScheduleRate = 0;
+   objectSpectralStart = 0;
+   objectHasSpectrum = false;
+   objectFrameSize = AUDIO_DSP_FFT_SIZE;
+   objectHopSize = U32(AUDIO_DSP_FFT_SIZE*(1.0f - AUDIO_DSP_OVERLAP));
+   objectWindowType = AUDIO_FFT_WINDOW;
+   objectSpectrum = NULL;
+   objectWindow = NULL;
+
+   objectMono = AudioMonoNode::find();
+
+   objectOutput.setSize(1);
+   objectOutput[0] = 0.0f;
+}
+DSPPipelineObject::~DSPPipelineObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectPipelineDataMutex, true );
+
+   AudioAnalysisGraph::releaseNode(objectMono);
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+}
+
+bool DSPPipelineObject::parseStages(const char* spec, Vector<Stage>& stages, Vector<F32>& bandEdges){
+   stages.clear();
+   bandEdges.clear();
+   // an empty pipeline passes the mono mix straight through
+   if(!spec || !spec[0])
+      return true;
+
+   U32 len = dStrlen(spec);
+   char *buff = new char[len+1];
+   dStrcpy(buff, spec);
+
+   bool spectral = false;
+   bool windowPending = false;
+   const char* error = NULL;
+   const char* errorStage = "";
+
+   // split on ';' by hand since each stage is then tokenized with dStrtok
+   char *comp = buff;
+   while(comp && !error){
+      char *next = dStrchr(comp, ';');
+      if(next)
+         *next++ = '\0';
+
+      char *name = dStrtok(comp, " \t");
+      if(!name){
+         comp = next;
+         continue;
+      }
+      errorStage = name;
+
+      // filter and window take a name before the numbers
+      const char* word = NULL;
+      if(!dStricmp(name, "filter") || !dStricmp(name, "window"))
+         word = dStrtok(NULL, " \t");
+      Vector<F32> args;
+      char *value;
+      while((value = dStrtok(NULL, " \t")) != NULL)
+         args.push_back(dAtof(value));
+
+      Stage s;
+      s.mode = 0;
+      s.args[0] = s.args[1] = 0.0f;
+
+      if(windowPending && dStricmp(name, "fft"))
+         error = "window must be followed by fft";
+
+      if(error){
+      }else if(!dStricmp(name, "gain")){
+         s.type = StageGain;
+         if(args.size() < 1)
+            error = "gain needs a value";
+         else
+            s.args[0] = args[0];
+      }else if(!dStricmp(name, "filter")){
+         s.type = StageFilter;
+         s.mode = 0;
+         while(word && s.mode <= FilterBandpass && dStricmp(word, sFilterNames[s.mode]))
+            s.mode++;
+         if(spectral)
+            error = "filter must come before fft";
+         else if(!word || s.mode > FilterBandpass)
+            error = "filter type must be lowpass, highpass or bandpass";
+         else if(args.size() < 1 || args[0] <= 0.0f)
+            error = "filter needs a frequency";
+         else{
+            s.args[0] = args[0];
+            s.args[1] = args.size() > 1 ? getMax(args[1], 0.1f) : AUDIO_DSP_FILTER_Q;
+         }
+      }else if(!dStricmp(name, "window")){
+         s.type = StageWindow;
+         s.mode = word ? AudioWindow::getTypeFromName(word) : AudioWindow::WindowTypeCount;
+         if(spectral)
+            error = "window must come before fft";
+         else if(s.mode == AudioWindow::WindowTypeCount)
+            error = "unknown window";
+         windowPending = true;
+      }else if(!dStricmp(name, "fft")){
+         s.type = StageFFT;
+         s.args[0] = args.size() > 0 ? args[0] : AUDIO_DSP_FFT_SIZE;
+         s.args[1] = args.size() > 1 ? args[1] : AUDIO_DSP_OVERLAP;
+         if(spectral)
+            error = "only one fft is allowed";
+         spectral = true;
+         windowPending = false;
+      }else if(!dStricmp(name, "bands")){
+         s.type = StageBands;
+         if(!spectral)
+            error = "bands must come after fft";
+         else if(bandEdges.size())
+            error = "only one bands stage is allowed";
+         else if(args.size() < 2)
+            error = "bands needs at least two edges";
+         for(U32 count=1; count<args.size() && !error; count++){
+            if(args[count] <= args[count-1])
+               error = "band edges must go up";
+         }
+         if(!error)
+            bandEdges = args;
+      }else if(!dStricmp(name, "log")){
+         s.type = StageLog;
+      }else if(!dStricmp(name, "envelope")){
+         s.type = StageEnvelope;
+         if(args.size() < 2 || args[0] < 0.0f || args[1] < 0.0f)
+            error = "envelope needs attack and release times in mS";
+         else{
+            s.args[0] = args[0];
+            s.args[1] = args[1];
+         }
+      }else if(!dStricmp(name, "threshold")){
+         s.type = StageThreshold;
+         if(args.size() < 1)
+            error = "threshold needs a level";
+         else
+            s.args[0] = args[0];
+      }else{
+         error = "unknown stage";
+      }
+
+      if(!error)
+         stages.push_back(s);
+      comp = next;
+   }
+   if(!error && windowPending)
+      error = "window must be followed by fft";
+
+   if(error)
+      Con::warnf("DSPPipelineObject::setPipeline - %s: %s", error, errorStage);
+
+   delete [] buff;
+   return error == NULL;
+}
+
+bool DSPPipelineObject::setPipeline(const char* spec){
+   Vector<Stage> stages;
+   Vector<F32> bandEdges;
+   if(!parseStages(spec, stages, bandEdges))
+      return false;
+
+   MutexHandle mutex;
+   mutex.lock( &objectPipelineDataMutex, true );
+
+   objectPipelineSpec = spec;
+   objectStages = stages;
+   objectBandEdges = bandEdges;
+   objectScheduleDirty = true;
+   return true;
+}
+
+String DSPPipelineObject::getPipeline(){
+   MutexHandle mutex;
+   mutex.lock( &objectPipelineDataMutex, true );
+   return objectPipelineSpec;
+}
+
+DSPPipelineObject::Step& DSPPipelineObject::addMapStep(bool spectral, U32 count, StepType type, F32 value){
+   // extend the map at the end of the schedule so adjacent element wise stages share one pass
+   if(!objectSchedule.size() || objectSchedule.last().type != OpMap || objectSchedule.last().spectral != spectral){
+      Op op;
+      dMemset(&op, 0, sizeof(op));
+      op.type = OpMap;
+      op.spectral = spectral;
+      op.count = op.outCount = count;
+      op.firstStep = objectSteps.size();
+      objectSchedule.push_back(op);
+   }
+   objectSchedule.last().numSteps++;
+
+   Step step;
+   step.type = type;
+   step.value = value;
+   step.offset = 0;
+   objectSteps.push_back(step);
+   return objectSteps.last();
+}
+
+void DSPPipelineObject::compile(U32 rate){
+   objectSchedule.clear();
+   objectSteps.clear();
+   objectBandBins.clear();
+   objectStatePool.clear();
+   objectSpectralStart = 0;
+   objectHasSpectrum = false;
+   objectFrameSize = AUDIO_DSP_FFT_SIZE;
+   objectHopSize = U32(AUDIO_DSP_FFT_SIZE*(1.0f - AUDIO_DSP_OVERLAP));
+   objectWindowType = AUDIO_FFT_WINDOW;
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+   objectSpectrum = NULL;
+   objectWindow = NULL;
+   objectFramer.reset();
+
+   bool spectral = false;
+   // values per spectrum, the time domain length is the block size
+   U32 count = 0;
+   // gain not applied yet, carried forward until a stage it cannot pass through
+   F32 gain = 1.0f;
+
+   for(U32 stage=0; stage<objectStages.size(); stage++){
+      const Stage& s = objectStages[stage];
+      switch(s.type){
+      case StageGain:
+         gain *= s.args[0];
+         break;
+
+      case StageFilter:{
+         // RBJ cookbook biquad with the pending gain in the feed forward coefficients
+         F64 w0 = M_2PI*mClampF(s.args[0], 1.0f, rate*0.49f)/rate;
+         F64 alpha = mSin(w0)/(2.0*s.args[1]);
+         F64 cosw = mCos(w0);
+         F64 b[3];
+         if(s.mode == FilterLowpass){
+            b[0] = b[2] = (1.0 - cosw)*0.5;
+            b[1] = 1.0 - cosw;
+         }else if(s.mode == FilterHighpass){
+            b[0] = b[2] = (1.0 + cosw)*0.5;
+            b[1] = -(1.0 + cosw);
+         }else{
+            b[0] = alpha;
+            b[1] = 0.0;
+            b[2] = -alpha;
+         }
+         F64 a0 = 1.0 + alpha;
+         Op op;
+         dMemset(&op, 0, sizeof(op));
+         op.type = OpBiquad;
+         for(U32 n=0; n<3; n++)
+            op.coef[n] = F32(b[n]*gain/a0);
+         op.coef[3] = F32(-2.0*cosw/a0);
+         op.coef[4] = F32((1.0 - alpha)/a0);
+         objectSchedule.push_back(op);
+         gain = 1.0f;
+         break;
+      }
+
+      case StageWindow:
+         objectWindowType = (AudioWindow::WindowType)s.mode;
+         break;
+
+      case StageFFT:
+         objectFrameSize = AudioFramer::roundFrameSize(U32(s.args[0]));
+         objectHopSize = getMax(U32(objectFrameSize*(1.0f - mClampF(s.args[1], 0.0f, 0.9f))), U32(1));
+         objectSpectralStart = objectSchedule.size();
+         objectHasSpectrum = true;
+         if(!objectSpectralStart){
+            // nothing to do on the samples, the shared spectrum has the same data
+            objectSpectrum = AudioSharedSpectrum::find(objectFrameSize, objectHopSize, objectWindowType);
+         }else{
+            objectWindow = AudioWindow::getTable(objectWindowType, objectFrameSize);
+            objectFramer.setup(objectFrameSize, objectHopSize);
+            objectFrameBuffer.reserve<F32>(objectFrameSize);
+            objectFFTOutput.reserve<F32>(objectFrameSize+2);
+            objectPowerBuffer.reserve<F32>(objectFrameSize/2+1);
+         }
+         spectral = true;
+         count = objectFrameSize/2 + 1;
+         objectSpectralA.reserve<F32>(count);
+         objectSpectralB.reserve<F32>(count);
+         gain *= gain;
+         break;
+
+      case StageBands:{
+         Op op;
+         dMemset(&op, 0, sizeof(op));
+         op.type = OpBands;
+         op.spectral = true;
+         op.count = count;
+         op.outCount = objectBandEdges.size() - 1;
+         F32 binHz = (F32)rate/objectFrameSize;
+         U32 last = 0;
+         for(U32 edge=0; edge<objectBandEdges.size(); edge++){
+            // every band gets at least one bin where the spectrum allows
+            U32 bin = mClamp(S32(objectBandEdges[edge]/binHz + 0.5f), 0, S32(count));
+            if(edge)
+               bin = getMin(getMax(bin, last + 1), count);
+            objectBandBins.push_back(bin);
+            last = bin;
+         }
+         objectSchedule.push_back(op);
+         count = op.outCount;
+         break;
+      }
+
+      case StageLog:
+         // log(g*x) is not a scaled log, the gain has to be applied first
+         if(gain != 1.0f)
+            addMapStep(spectral, count, StepGain, gain);
+         gain = 1.0f;
+         addMapStep(spectral, count, StepLog, 0.0f);
+         break;
+
+      case StageEnvelope:
+         if(!spectral){
+            // follower of the rectified stream, |g*x| = |g|*|x|
+            Op op;
+            dMemset(&op, 0, sizeof(op));
+            op.type = OpFollower;
+            op.coef[0] = mFabs(gain);
+            op.coef[1] = getHopCoefficient(s.args[0], 1, rate);
+            op.coef[2] = getHopCoefficient(s.args[1], 1, rate);
+            objectSchedule.push_back(op);
+            gain = 1.0f;
+         }else{
+            // the envelope of g*x is g times the envelope of x for positive g
+            if(gain <= 0.0f){
+               addMapStep(spectral, count, StepGain, gain);
+               gain = 1.0f;
+            }
+            Step& step = addMapStep(spectral, count, StepEnvelope, 0.0f);
+            step.offset = objectStatePool.size();
+            objectStatePool.setSize(step.offset + count*3);
+            F32* state = objectStatePool.address() + step.offset;
+            F32 attack = getHopCoefficient(s.args[0], objectHopSize, rate);
+            F32 release = getHopCoefficient(s.args[1], objectHopSize, rate);
+            for(U32 n=0; n<count; n++){
+               state[n] = 0.0f;
+               state[count + n] = attack;
+               state[count*2 + n] = release;
+            }
+         }
+         break;
+
+      case StageThreshold:
+         // g*x > level is x > level/g for positive g
+         if(gain > 0.0f){
+            addMapStep(spectral, count, StepThreshold, s.args[0]/gain);
+         }else{
+            addMapStep(spectral, count, StepGain, gain);
+            addMapStep(spectral, count, StepThreshold, s.args[0]);
+         }
+         gain = 1.0f;
+         break;
+      }
+   }
+   if(gain != 1.0f)
+      addMapStep(spectral, count, StepGain, gain);
+   if(!objectHasSpectrum)
+      objectSpectralStart = objectSchedule.size();
+
+   // time domain output for the largest block the analysis thread will deliver
+   if(objectSpectralStart)
+      objectTimeBuffer.reserve<F32>(rate*AUDIO_ANALYSIS_MAX_BACKLOG_MS/1000 + 1);
+
+   objectOutput.setSize(objectHasSpectrum ? count : 1);
+   objectOutput.fill(0.0f);
+
+   objectScheduleRate = rate;
+   objectScheduleDirty = false;
+}
+
+void DSPPipelineObject::runMap(const Op& op, const F32* src, F32* dest, U32 count){
+   const Step* steps = objectSteps.address() + op.firstStep;
+   for(U32 start=0; start<count; start+=AUDIO_DSP_TILE){
+      U32 tile = getMin(count - start, U32(AUDIO_DSP_TILE));
+      const F32* in = src + start;
+      F32* out = dest + start;
+      // every step over the tile while it is in the cache, after the first step the
+      //    tile is worked on in place
+      for(U32 s=0; s<op.numSteps; s++){
+         const Step& step = steps[s];
+         switch(step.type){
+         case StepGain:
+            for(U32 n=0; n<tile; n++)
+               out[n] = in[n]*step.value;
+            break;
+         case StepLog:
+            audioLog(out, in, 1.0f, tile);
+            break;
+         case StepEnvelope:{
+            F32* state = objectStatePool.address() + step.offset;
+            audioSmoothAttackRelease(state + start, in, state + op.count + start, state + op.count*2 + start, tile);
+            dMemcpy(out, state + start, sizeof(F32)*tile);
+            break;
+         }
+         case StepThreshold:
+            for(U32 n=0; n<tile; n++)
+               out[n] = in[n] > step.value ? 1.0f : 0.0f;
+            break;
+         }
+         in = out;
+      }
+   }
+}
+
+void DSPPipelineObject::runBiquad(Op& op, const F32* src, F32* dest, U32 count){
+   // transposed direct form II
+   const F32 b0 = op.coef[0], b1 = op.coef[1], b2 = op.coef[2], a1 = op.coef[3], a2 = op.coef[4];
+   F32 z1 = op.state[0], z2 = op.state[1];
+   for(U32 n=0; n<count; n++){
+      F32 x = src[n];
+      F32 y = b0*x + z1;
+      z1 = b1*x - a1*y + z2;
+      z2 = b2*x - a2*y;
+      dest[n] = y;
+   }
+   op.state[0] = z1;
+   op.state[1] = z2;
+}
+
+void DSPPipelineObject::runFollower(Op& op, const F32* src, F32* dest, U32 count){
+   const F32 gain = op.coef[0], attack = op.coef[1], release = op.coef[2];
+   F32 level = op.state[0];
+   for(U32 n=0; n<count; n++){
+      F32 x = mFabs(src[n])*gain;
+      level += (x > level ? attack : release)*(x - level);
+      dest[n] = level;
+   }
+   op.state[0] = level;
+}
+
+void DSPPipelineObject::runTimeOp(Op& op, const F32* src, F32* dest, U32 count){
+   switch(op.type){
+   case OpMap:
+      runMap(op, src, dest, count);
+      break;
+   case OpBiquad:
+      runBiquad(op, src, dest, count);
+      break;
+   case OpFollower:
+      runFollower(op, src, dest, count);
+      break;
+   default:
+      break;
+   }
+}
+
+void DSPPipelineObject::runBands(const Op& op, const F32* src, F32* dest){
+   const U32* bins = objectBandBins.address();
+   for(U32 band=0; band<op.outCount; band++){
+      F32 sum = 0.0f;
+      for(U32 bin=bins[band]; bin<bins[band+1]; bin++)
+         sum += src[bin];
+      dest[band] = sum;
+   }
+}
+
+void DSPPipelineObject::processSpectrum(const F32* power){
+   // ping pong between the two spectral buffers, the first op reads the spectrum itself
+   F32* buffers[2] = { objectSpectralA.reserve<F32>(objectFrameSize/2+1), objectSpectralB.reserve<F32>(objectFrameSize/2+1) };
+   const F32* src = power;
+   U32 count = objectFrameSize/2 + 1;
+   for(U32 index=objectSpectralStart; index<objectSchedule.size(); index++){
+      const Op& op = objectSchedule[index];
+      F32* dest = src == buffers[0] ? buffers[1] : buffers[0];
+      if(op.type == OpBands)
+         runBands(op, src, dest);
+      else
+         runMap(op, src, dest, op.count);
+      src = dest;
+      count = op.outCount;
+   }
+   dMemcpy(objectOutput.address(), src, sizeof(F32)*count);
+}
+
+void DSPPipelineObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectPipelineDataMutex, true );
+
+   if(!getSampleData() || !objectSampleBufferSamples)
+      return;
+
+   if(objectScheduleDirty || objectScheduleRate != objectSamplesPerSecond)
+      compile(objectSamplesPerSecond);
+
+   if(objectSpectrum){
+      U32 frames;
+      const F32* power = objectSpectrum->lock(objectSampleBlock, frames);
+      for(U32 count=0; count<frames; count++)
+         processSpectrum(power + count*objectSpectrum->getBins());
+      objectSpectrum->unlock();
+      return;
+   }
+
+   // time domain ops, the first reads the shared mono mix into the time buffer and the mix is
+   //    released before the rest work in place, other objects only wait for the one copy
+   U32 frames;
+   const F32* data = objectMono->lock(objectSampleBlock, frames);
+   bool monoLocked = true;
+   if(objectSpectralStart){
+      F32* buffer = objectTimeBuffer.reserve<F32>(getMax(frames, U32(1)));
+      runTimeOp(objectSchedule[0], data, buffer, frames);
+      objectMono->unlock();
+      monoLocked = false;
+      for(U32 index=1; index<objectSpectralStart; index++)
+         runTimeOp(objectSchedule[index], buffer, buffer, frames);
+      data = buffer;
+   }
+
+   if(!objectHasSpectrum){
+      if(frames)
+         objectOutput[0] = data[frames-1];
+      if(monoLocked)
+         objectMono->unlock();
+      return;
+   }
+   objectFramer.write(data, frames);
+   if(monoLocked)
+      objectMono->unlock();
+
+   const F32* frame;
+   while((frame = objectFramer.nextFrame()) != NULL){
+      F32* windowed = objectFrameBuffer.reserve<F32>(objectFrameSize);
+      for(U32 count=0; count<objectFrameSize; count++)
+         windowed[count] = frame[count]*objectWindow[count];
+
+      AudioFFTPlan* plan = AudioFFTPlanCache::acquire(objectFrameSize);
+      F32* out = objectFFTOutput.reserve<F32>(objectFrameSize+2);
+      plan->forward(windowed, out);
+      AudioFFTPlanCache::release(plan);
+
+      F32* power = objectPowerBuffer.reserve<F32>(objectFrameSize/2+1);
+      audioPowerSpectrum(power, out, objectFrameSize/2+1);
+      processSpectrum(power);
+   }
+}
+
+String DSPPipelineObject::getSchedule(){
+   MutexHandle mutex;
+   mutex.lock( &objectPipelineDataMutex, true );
+
+   if(objectScheduleDirty || !objectScheduleRate)
+      compile(objectScheduleRate ? objectScheduleRate : 48000);
+
+   String text = objectSpectrum ? "" : "mono";
+   for(U32 index=0; index<=objectSchedule.size(); index++){
+      if(index == objectSpectralStart && objectHasSpectrum){
+         text += String::ToString("%sspectrum %d %d %s%s", text.isEmpty() ? "" : "; ", objectFrameSize, objectHopSize,
+            AudioWindow::getTypeName(objectWindowType), objectSpectrum ? " shared" : "");
+      }
+      if(index == objectSchedule.size())
+         break;
+
+      const Op& op = objectSchedule[index];
+      text += text.isEmpty() ? "" : "; ";
+      switch(op.type){
+      case OpMap:{
+         text += "map";
+         for(U32 s=0; s<op.numSteps; s++){
+            const Step& step = objectSteps[op.firstStep + s];
+            if(step.type == StepGain)
+               text += String::ToString(" gain %g", step.value);
+            else if(step.type == StepLog)
+               text += " log";
+            else if(step.type == StepEnvelope)
+               text += " envelope";
+            else
+               text += String::ToString(" threshold %g", step.value);
+         }
+         break;
+      }
+      case OpBiquad:
+         text += "biquad";
+         break;
+      case OpFollower:
+         text += String::ToString("follower gain %g", op.coef[0]);
+         break;
+      case OpBands:
+         text += String::ToString("bands %d to %d", op.count, op.outCount);
+         break;
+      }
+   }
+   return text;
+}
+
+void DSPPipelineObject::getPipelineOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectPipelineDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(objectOutput);
+}
+
+U32 DSPPipelineObject::getProcessedOutput(Vector<F32>& retoutput){
+   getPipelineOutput(retoutput);
+
+   return getDataChanged();
+}
+
+// console
+DefineEngineMethod(DSPPipelineObject, setPipeline, bool, (const char* spec), (""),
+   "Set the stages run on the audio, separated by ';'.\n"
+   "   \"gain <g>\", \"filter <lowpass|highpass|bandpass> <freq> [q]\", \"window <name>\", "
+   "\"fft <size> [overlap]\", \"bands <f0> <f1> ... <fn>\", \"log\", \"envelope <attackMs> <releaseMs>\", "
+   "\"threshold <level>\"\n"
+   "eg: \"filter lowpass 150; fft 2048 0.5; bands 30 60 120; log; envelope 10 200\"\n"
+   "@param spec Stage list, empty passes the mono mix through.\n"
+   "@return False if spec has an error, the old pipeline is kept.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->setPipeline(spec);
+}
+
+DefineEngineMethod(DSPPipelineObject, addStage, bool, (const char* stage),,
+   "Add a stage to the end of the pipeline, see setPipeline.\n"
+   "@param stage One stage such as \"threshold 0.5\".\n"
+   "@return False if the stage does not fit, the old pipeline is kept.\n"
+   "@ingroup AudioLoopBack")
+{
+   String spec = object->getPipeline();
+   if(!spec.isEmpty())
+      spec += "; ";
+   spec += stage;
+   return object->setPipeline(spec.c_str());
+}
+
+DefineEngineMethod(DSPPipelineObject, getPipeline, const char*, (),,
+   "Get the stage list.\n"
+   "@param Nothing.\n"
+   "@return The spec given to setPipeline.\n"
+   "@ingroup AudioLoopBack")
+{
+   String spec = object->getPipeline();
+   char* ret = Con::getReturnBuffer(spec.length() + 1);
+   dStrcpy(ret, spec.c_str());
+   return ret;
+}
+
+DefineEngineMethod(DSPPipelineObject, getSchedule, const char*, (),,
+   "Get the compiled schedule after folding gains and fusing element wise stages, for checking "
+   "what a pipeline costs.\n"
+   "@param Nothing.\n"
+   "@return One entry per pass over the data separated by ';'.\n"
+   "@ingroup AudioLoopBack")
+{
+   String text = object->getSchedule();
+   char* ret = Con::getReturnBuffer(text.length() + 1);
+   dStrcpy(ret, text.c_str());
+   return ret;
+}
+
+DefineEngineMethod(DSPPipelineObject, getPipelineOutput, const char*, (),,
+   "Get the output of the last stage.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats, one per bin or band, one value without an fft.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getPipelineOutput(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+// benchmark
+DefineEngineFunction( benchmarkAudioDSPPipeline, F32, (const char* spec, U32 seconds),
+   ("filter highpass 40; gain 2; window hann; fft 2048 0.5; bands 30 60 120 250 500 1000 2000 4000 8000 16000; log; envelope 10 200; threshold -4", 10),
+   "Time a DSPPipelineObject on noise at 48 kHz and print the cost of each 100 mS block.\n"
+   "@param spec Pipeline to time, see DSPPipelineObject::setPipeline.\n"
+   "@param seconds Seconds of audio to process.\n"
+   "@return Milliseconds of one core used per block, -1 if spec has an error or the audio "
+   "loopback thread is running.\n"
+   "@ingroup AudioLoopBack" )
+{
+   // the pipeline shares the analysis graph nodes with the live objects
+   if(_activeLoopbackThread != NULL){
+      Con::warnf("benchmarkAudioDSPPipeline: Stop the active audio loopback thread first.");
+      return -1.0f;
+   }
+
+   const U32 rate = 48000;
+   const U32 frames = rate/10;
+   const U32 blocks = getMax(seconds, U32(1))*10;
+
+   AudioSampleRing ring;
+   ring.allocate(frames*4, AUDIO_NUM_CHANNELS);
+   ring.reset(rate);
+   Vector<F32> data;
+   data.setSize(frames*AUDIO_NUM_CHANNELS);
+   U32 seed = 1;
+   for(U32 count=0; count<frames*AUDIO_NUM_CHANNELS; count++){
+      seed = seed*1664525 + 1013904223;
+      data[count] = 0.5f*(F32(seed >> 8)/F32(1 << 24) - 0.5f);
+   }
+   ring.write(data.address(), frames);
+   U32 index = ring.publish() - frames;
+   // the mono mix and shared spectrum are only computed for a block they have not seen,
+   //    alternate between two copies so every timed call pays for them as it would live
+   AudioSampleBlockRef block[2];
+   block[0] = AudioSampleBlock::create(ring, index, frames, 0);
+   block[1] = AudioSampleBlock::create(ring, index, frames, 1);
+
+   DSPPipelineObject* pipeline = new DSPPipelineObject();
+   if(!pipeline->setPipeline(spec)){
+      delete pipeline;
+      return -1.0f;
+   }
+   // first block compiles the schedule and sets up the buffers
+   pipeline->process(block[0]);
+
+   U32 allocs = AudioScratchBuffer::getAllocCount();
+   U32 start = Platform::getRealMilliseconds();
+   for(U32 count=0; count<blocks; count++)
+      pipeline->process(block[(count+1)&1]);
+   U32 elapsed = Platform::getRealMilliseconds() - start;
+   allocs = AudioScratchBuffer::getAllocCount() - allocs;
+
+   F32 blockMs = F32(elapsed)/blocks;
+   Con::printf("benchmarkAudioDSPPipeline: %.1f uS per 100 mS block (%.2f%% of one core), %d allocations, %s kernels",
+      blockMs*1000.0f, blockMs, allocs, getAudioKernelSetName());
+   Con::printf("benchmarkAudioDSPPipeline: schedule %s", pipeline->getSchedule().c_str());
+
+   delete pipeline;
+   return blockMs;
+}
@@ -0,0 +1,186 @@
+#ifndef _AUDIO_DSP_PIPELINE_OBJECT_H_
+#define _AUDIO_DSP_PIPELINE_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Analysis put together from script out of simple stages instead of a new C++ object.
+The pipeline is a semicolon separated list of stages run in order on the mono mix:
+   "gain <g>"                          - multiply by g
+   "filter <type> <freq> [q]"          - biquad, type is lowpass, highpass or bandpass
+   "window <name>"                     - window for the following fft (hann by default)
+   "fft <size> [overlap]"              - power spectrum of overlapping frames
+   "bands <f0> <f1> ... <fn>"          - sum the spectrum into n bands between the edges in Hz
+   "log"                               - natural log, values <= 0 count as FLT_MIN
+   "envelope <attackMs> <releaseMs>"   - follow rising and falling values at separate speeds
+   "threshold <level>"                 - 1 where the value is above level, 0 elsewhere
+eg: "filter lowpass 150; window hann; fft 2048 0.5; bands 30 60 120; log; envelope 10 200"
+
+Stages before the fft work on samples, filter and envelope run along the stream.  Stages
+after it work on each spectrum (or the bands), envelope then smooths every value from one
+frame to the next.  The output is the last spectrum through the pipeline, or the last sample
+of the block when there is no fft (eg: the level of an envelope follower).
+
+The stage list is compiled into a flat schedule when the pipeline or the sample rate
+changes:
+   - gains are carried forward through linear stages (filter, fft as g^2, bands, envelope)
+     and folded into the next filter, threshold or into each other, a gain only costs a
+     pass of its own in front of a log or at the very end
+   - runs of element wise stages (gain, log, threshold, spectral envelope) are fused into
+     one map step that runs every stage over a tile of AUDIO_DSP_TILE values while it is
+     in the cache, instead of one pass over the whole buffer per stage
+   - a pipeline that starts with window and fft reads the AudioSharedSpectrum so it costs
+     nothing extra next to an FFTObject on the same settings
+   - all intermediate buffers and state are allocated by the compile, running the schedule
+     does not allocate
+*/
+
+// values processed per stage before moving on to the next stage of a fused map
+#define AUDIO_DSP_TILE 256
+#define AUDIO_DSP_FFT_SIZE 2048
+#define AUDIO_DSP_OVERLAP 0.5f
+#define AUDIO_DSP_FILTER_Q 0.7071f
+
+class DSPPipelineObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+public:
+   enum StageType {
+      StageGain = 0,
+      StageFilter,
+      StageWindow,
+      StageFFT,
+      StageBands,
+      StageLog,
+      StageEnvelope,
+      StageThreshold,
+   };
+   enum FilterType {
+      FilterLowpass = 0,
+      FilterHighpass,
+      FilterBandpass,
+   };
+
+   // one stage as written in the pipeline
+   struct Stage {
+      StageType type;
+      // filter type or window type
+      U32 mode;
+      F32 args[2];
+   };
+
+private:
+   enum OpType {
+      OpMap = 0,    // fused element wise steps
+      OpBiquad,     // filter along the stream
+      OpFollower,   // envelope along the stream
+      OpBands,      // sum bins into bands
+   };
+   enum StepType {
+      StepGain = 0,
+      StepLog,
+      StepEnvelope,
+      StepThreshold,
+   };
+
+   // element wise stage of a map
+   struct Step {
+      StepType type;
+      // gain or threshold level
+      F32 value;
+      // envelope state, attack and release coefficients, count values each in objectStatePool
+      U32 offset;
+   };
+
+   // one entry of the compiled schedule
+   struct Op {
+      OpType type;
+      // runs once per spectrum rather than once per block
+      bool spectral;
+      // values per spectrum going in and coming out
+      U32 count;
+      U32 outCount;
+      // map steps in objectSteps
+      U32 firstStep;
+      U32 numSteps;
+      // biquad b0 b1 b2 a1 a2, follower input gain attack release
+      F32 coef[5];
+      F32 state[2];
+   };
+
+   // protect pipeline data
+   Mutex objectPipelineDataMutex;
+
+   String objectPipelineSpec;
+   Vector<Stage> objectStages;
+   Vector<F32> objectBandEdges;
+
+   // schedule is compiled for objectScheduleRate, rebuilt when dirty
+   bool objectScheduleDirty;
+   U32 objectScheduleRate;
+   Vector<Op> objectSchedule;
+   Vector<Step> objectSteps;
+   // ops before objectSpectralStart are time domain, the rest spectral
+   U32 objectSpectralStart;
+   bool objectHasSpectrum;
+   U32 objectFrameSize;
+   U32 objectHopSize;
+   AudioWindow::WindowType objectWindowType;
+   // spectrum read from the graph when no time domain op comes before the fft
+   AudioSharedSpectrum* objectSpectrum;
+   const F32* objectWindow;
+   AudioFramer objectFramer;
+   // first bin of each band and the end of the last band
+   Vector<U32> objectBandBins;
+   // envelope state and coefficients of every map step
+   Vector<F32> objectStatePool;
+
+   // mono source and intermediate buffers
+   AudioMonoNode* objectMono;
+   AudioScratchBuffer objectTimeBuffer;
+   AudioScratchBuffer objectFrameBuffer;
+   AudioScratchBuffer objectFFTOutput;
+   AudioScratchBuffer objectPowerBuffer;
+   AudioScratchBuffer objectSpectralA;
+   AudioScratchBuffer objectSpectralB;
+
+   Vector<F32> objectOutput;
+
+   // objectPipelineDataMutex must be held
+   void compile(U32 rate);
+   // add a step to the map at the end of the schedule, starting a new map if needed
+   Step& addMapStep(bool spectral, U32 count, StepType type, F32 value);
+   void runMap(const Op& op, const F32* src, F32* dest, U32 count);
+   void runBiquad(Op& op, const F32* src, F32* dest, U32 count);
+   void runFollower(Op& op, const F32* src, F32* dest, U32 count);
+   // run one op before the fft, src may be dest
+   void runTimeOp(Op& op, const F32* src, F32* dest, U32 count);
+   void runBands(const Op& op, const F32* src, F32* dest);
+   // run the spectral ops on one spectrum and copy the result to the output
+   void processSpectrum(const F32* power);
+
+public:
+   DSPPipelineObject();
+   virtual ~DSPPipelineObject();
+
+   virtual void process_unique();
+
+   // replace the pipeline, see the stage list above
+   //    returns false and keeps the old pipeline if spec has an error
+   bool setPipeline(const char* spec);
+   String getPipeline();
+   // parse spec into stages and band edges, returns false on an error
+   static bool parseStages(const char* spec, Vector<Stage>& stages, Vector<F32>& bandEdges);
+
+   // compiled schedule as text, one op per ';' separated entry
+   String getSchedule();
+   // values of the last output
+   void getPipelineOutput(Vector<F32>& retoutput);
+
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput);
+
+   DECLARE_CONOBJECT(DSPPipelineObject);
+};
+
+#endif // _AUDIO_DSP_PIPELINE_OBJECT_H_
@@ -0,0 +1,214 @@
+#include "audioDecimator.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+#include "audioFramer.h"
+#include "audioWindow.h"
+
+F32 AudioDecimator::smCoef[AUDIO_HALFBAND_TAPS];
+bool AudioDecimator::smCoefBuilt = AudioDecimator::buildCoefficients();
+
+bool AudioDecimator::buildCoefficients(){
+   const S32 length = AUDIO_HALFBAND_TAPS*4 - 1;
+   const S32 center = length/2;
+   for(S32 tap=0; tap<AUDIO_HALFBAND_TAPS; tap++){
+      // odd distances from the center, sinc at half the input nyquist times a blackman window
+      S32 index = center + tap*2 + 1;
+      F64 x = (index - center)*0.5;
+      F64 phase = M_2PI*index/(length - 1);
+      F64 window = 0.42 - 0.5*mCos(phase) + 0.08*mCos(2.0*phase);
+      smCoef[tap] = F32(0.5*mSin(M_PI*x)/(M_PI*x)*window);
+   }
+   return true;
+}
+
+AudioDecimator::AudioDecimator(){
+   reset();
+}
+
+void AudioDecimator::reset(){
+   const U32 history = AUDIO_HALFBAND_TAPS*2 - 1;
+   mEven.setSize(history);
+   mEven.fill(0.0f);
+   mOdd.setSize(history);
+   mOdd.fill(0.0f);
+   mPending = 0.0f;
+   mHasPending = false;
+}
+
+U32 AudioDecimator::process(const F32* in, U32 count, F32* out){
+   const U32 history = AUDIO_HALFBAND_TAPS*2 - 1;
+   U32 pairs = (count + (mHasPending ? 1 : 0))/2;
+   if(!pairs){
+      if(count){
+         mPending = in[0];
+         mHasPending = true;
+      }
+      return 0;
+   }
+
+   // split into the polyphase branches
+   mEven.setSize(history + pairs);
+   mOdd.setSize(history + pairs);
+   F32* even = mEven.address() + history;
+   F32* odd = mOdd.address() + history;
+   U32 index = 0;
+   U32 pair = 0;
+   if(mHasPending){
+      even[0] = mPending;
+      odd[0] = in[0];
+      index = 1;
+      pair = 1;
+   }
+   for(; pair<pairs; pair++, index+=2){
+      even[pair] = in[index];
+      odd[pair] = in[index+1];
+   }
+   mHasPending = index < count;
+   if(mHasPending)
+      mPending = in[index];
+
+   audioHalfband(out, mEven.address(), mOdd.address(), smCoef, pairs);
+
+   // keep the newest samples for the next block
+   dMemmove(mEven.address(), mEven.address() + pairs, sizeof(F32)*history);
+   dMemmove(mOdd.address(), mOdd.address() + pairs, sizeof(F32)*history);
+   mEven.setSize(history);
+   mOdd.setSize(history);
+   return pairs;
+}
+
+// chain
+AudioHalfbandChain::AudioHalfbandChain(){
+   mStageCount = 1;
+   for(U32 stage=0; stage<AUDIO_DECIMATOR_MAX_STAGES; stage++)
+      mOutputCount[stage] = 0;
+}
+
+void AudioHalfbandChain::setup(U32 stages){
+   mStageCount = mClamp(stages, 1, AUDIO_DECIMATOR_MAX_STAGES);
+   reset();
+}
+
+void AudioHalfbandChain::reset(){
+   for(U32 stage=0; stage<AUDIO_DECIMATOR_MAX_STAGES; stage++){
+      mStages[stage].reset();
+      mOutputCount[stage] = 0;
+   }
+}
+
+void AudioHalfbandChain::process(const F32* in, U32 count){
+   for(U32 stage=0; stage<mStageCount; stage++){
+      F32* out = mOutput[stage].reserve<F32>(AudioDecimator::getMaxOutput(count));
+      count = mStages[stage].process(in, count, out);
+      mOutputCount[stage] = count;
+      in = out;
+   }
+}
+
+// benchmark
+//    bass bands at the FFTObject default resolution (11.7 Hz bins, a hop every 43 mS) two ways,
+//    a 4096 FFT at the full rate or a 512 FFT on the stream decimated to 6 kHz
+DefineEngineFunction( benchmarkAudioDecimation, F32, (U32 seconds), (60),
+   "Time the halfband decimation kernels of every kernel set the processor supports, then compare "
+   "the cost of the low bands from a 4096 FFT at 48 kHz against a 512 FFT at 6 kHz, which gives "
+   "the same frequency resolution and update rate.\n"
+   "@param seconds Seconds of audio to process per measurement.\n"
+   "@return Full rate time divided by decimated time.\n"
+   "@ingroup AudioLoopBack" )
+{
+   static const char* sSetNames[] = { "C", "SSE", "AVX" };
+   const U32 rate = 48000;
+   const U32 block = rate/10;
+   const U32 blocks = getMax(seconds, U32(1))*10;
+
+   Vector<F32> input;
+   input.setSize(block);
+   U32 seed = 1;
+   for(U32 count=0; count<block; count++){
+      seed = seed*1664525 + 1013904223;
+      input[count] = 0.5f*mSin(M_2PI_F*55.0f*count/rate) + 0.1f*(F32(seed >> 8)/F32(1 << 24) - 0.5f);
+   }
+
+   // kernels, output checked against the C set
+   const U32 pairs = block/2;
+   const U32 history = AUDIO_HALFBAND_TAPS*2 - 1;
+   Vector<F32> even, odd, reference, output;
+   even.setSize(history + pairs);
+   odd.setSize(history + pairs);
+   reference.setSize(pairs);
+   output.setSize(pairs);
+   for(U32 count=0; count<history + pairs; count++){
+      even[count] = input[(count*2) % block];
+      odd[count] = input[(count*2 + 1) % block];
+   }
+   getAudioKernelSet("C")->halfband(reference.address(), even.address(), odd.address(), AudioDecimator::getCoefficients(), pairs);
+
+   Con::printf("benchmarkAudioDecimation: ns per input sample, installed set is %s", getAudioKernelSetName());
+   for(U32 setIndex=0; setIndex<sizeof(sSetNames)/sizeof(sSetNames[0]); setIndex++){
+      const AudioKernelSet* set = getAudioKernelSet(sSetNames[setIndex]);
+      if(!set)
+         continue;
+
+      U32 start = Platform::getRealMilliseconds();
+      for(U32 count=0; count<blocks; count++)
+         set->halfband(output.address(), even.address(), odd.address(), AudioDecimator::getCoefficients(), pairs);
+      U32 ms = Platform::getRealMilliseconds() - start;
+
+      F32 maxError = 0.0f;
+      for(U32 count=0; count<pairs; count++)
+         maxError = getMax(maxError, mFabs(output[count] - reference[count]));
+      Con::printf("   %-3s  %.3f  (error %g)", set->name, ms*1000000.0f/(F32(blocks)*block), maxError);
+   }
+
+   // full rate
+   AudioFramer framer;
+   Vector<F32> windowed, spectrum, power;
+   framer.setup(4096, 2048);
+   windowed.setSize(4096);
+   spectrum.setSize(4096 + 2);
+   power.setSize(2048);
+   const F32* window = AudioWindow::getTable(AudioWindow::WindowHann, 4096);
+   AudioFFTPlan* plan = AudioFFTPlanCache::acquire(4096);
+   U32 start = Platform::getRealMilliseconds();
+   for(U32 count=0; count<blocks; count++){
+      framer.write(input.address(), block);
+      const F32* frame;
+      while((frame = framer.nextFrame()) != NULL){
+         for(U32 index=0; index<4096; index++)
+            windowed[index] = frame[index]*window[index];
+         plan->forward(windowed.address(), spectrum.address());
+         audioPowerSpectrum(power.address(), spectrum.address(), 2048);
+      }
+   }
+   U32 fullMs = Platform::getRealMilliseconds() - start;
+   AudioFFTPlanCache::release(plan);
+
+   // decimated to 6 kHz
+   AudioHalfbandChain chain;
+   chain.setup(3);
+   framer.setup(512, 256);
+   window = AudioWindow::getTable(AudioWindow::WindowHann, 512);
+   plan = AudioFFTPlanCache::acquire(512);
+   start = Platform::getRealMilliseconds();
+   for(U32 count=0; count<blocks; count++){
+      chain.process(input.address(), block);
+      U32 decimated;
+      const F32* low = chain.getOutput(3, decimated);
+      framer.write(low, decimated);
+      const F32* frame;
+      while((frame = framer.nextFrame()) != NULL){
+         for(U32 index=0; index<512; index++)
+            windowed[index] = frame[index]*window[index];
+         plan->forward(windowed.address(), spectrum.address());
+         audioPowerSpectrum(power.address(), spectrum.address(), 256);
+      }
+   }
+   U32 lowMs = Platform::getRealMilliseconds() - start;
+   AudioFFTPlanCache::release(plan);
+
+   Con::printf("   low bands for %d seconds of audio: full rate 4096 FFT %d mS, 6 kHz 512 FFT %d mS",
+      blocks/10, fullMs, lowMs);
+
+   return F32(fullMs)/getMax(F32(lowMs), 1.0f);
+}
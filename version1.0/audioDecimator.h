@@ -0,0 +1,83 @@
+#ifndef _AUDIO_DECIMATOR_H_
+#define _AUDIO_DECIMATOR_H_
+
+#include "platform/platform.h"
+#include <core/util/tVector.h>
+
+#include "audioFFT.h"
+#include "audioKernels.h"
+
+/*
+Halves the sample rate of a mono stream.
+63 tap halfband low pass (windowed sinc at a quarter of the input rate) with every other
+sample kept.  In a halfband filter every second tap is zero apart from the center one, so
+the input is split into its even and odd samples (the two polyphase branches): the odd
+branch only meets the center tap, the even branch meets the 32 nonzero taps, which are
+symmetric and need 16 multiplies.  The inner loop is the audioHalfband kernel.
+
+Flat to 0.4 of the output rate, everything that would alias into that range is at least
+60 dB down.  Blocks of any size can be processed, an odd sample is held for the next block.
+*/
+
+// fraction of the output rate that is usable after decimation
+#define AUDIO_DECIMATOR_PASSBAND 0.4f
+#define AUDIO_DECIMATOR_MAX_STAGES 8
+
+class AudioDecimator
+{
+private:
+   static F32 smCoef[AUDIO_HALFBAND_TAPS];
+   // fills smCoef during static initialization, before any thread can create a decimator
+   static bool smCoefBuilt;
+   static bool buildCoefficients();
+
+   // polyphase branches, 2*AUDIO_HALFBAND_TAPS-1 samples of history then the current block
+   Vector<F32> mEven;
+   Vector<F32> mOdd;
+   // odd sample left over from the last block
+   F32 mPending;
+   bool mHasPending;
+
+public:
+   AudioDecimator();
+
+   // clear the history, eg: when the sample rate changes
+   void reset();
+   // filter and decimate count samples into out
+   //    returns the number of samples written, at most getMaxOutput(count)
+   U32 process(const F32* in, U32 count, F32* out);
+   static U32 getMaxOutput(U32 count){ return count/2 + 1; }
+
+   // nonzero taps on one side of the center, for benchmarks and tests
+   static const F32* getCoefficients(){ return smCoef; }
+};
+
+/*
+Decimators in series, stage n delivers the input at 1/2^n of its rate.
+*/
+class AudioHalfbandChain
+{
+private:
+   U32 mStageCount;
+   AudioDecimator mStages[AUDIO_DECIMATOR_MAX_STAGES];
+   AudioScratchBuffer mOutput[AUDIO_DECIMATOR_MAX_STAGES];
+   U32 mOutputCount[AUDIO_DECIMATOR_MAX_STAGES];
+
+public:
+   AudioHalfbandChain();
+
+   // number of halvings, 1 to AUDIO_DECIMATOR_MAX_STAGES
+   void setup(U32 stages);
+   void reset();
+   U32 getStageCount(){ return mStageCount; }
+
+   // run a block through every stage
+   void process(const F32* in, U32 count);
+   // output of the last process() call for stage 1 to getStageCount()
+   const F32* getOutput(U32 stage, U32& count){
+      count = mOutputCount[stage-1];
+      return mOutput[stage-1].reserve<F32>(count);
+   }
+};
+
+#endif // _AUDIO_DECIMATOR_H_
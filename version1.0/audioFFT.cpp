@@ -0,0 +1,290 @@
+#include "audioFFT.h"
+
+#include "math/mMath.h"
+#include "console/engineAPI.h"
+
+#include "kiss_fft/kiss_fft.h"
+#include "kiss_fft/kiss_fftr.h"
+
+// kiss backend
+class AudioFFTPlanKiss : public AudioFFTPlan
+{
+   typedef AudioFFTPlan Parent;
+
+   kiss_fftr_cfg mCfg;
+   kiss_fftr_cfg mInverseCfg;
+
+public:
+   AudioFFTPlanKiss(AudioFFTBackend* backend, U32 size)
+   :Parent(backend, size)
+   {
+      mCfg = kiss_fftr_alloc(size,0,0,0);
+      mInverseCfg = kiss_fftr_alloc(size,1,0,0);
+   }
+   virtual ~AudioFFTPlanKiss(){
+      if(mCfg)
+         kiss_fft_free(mCfg);
+      if(mInverseCfg)
+         kiss_fft_free(mInverseCfg);
+   }
+
+   virtual void forward(const F32* input, F32* output){
+      kiss_fftr(mCfg, input, (kiss_fft_cpx*)output);
+   }
+   virtual void inverse(const F32* input, F32* output){
+      kiss_fftri(mInverseCfg, (const kiss_fft_cpx*)input, output);
+   }
+};
+
+class AudioFFTBackendKiss : public AudioFFTBackend
+{
+public:
+   virtual const char* getName(){ return "kiss"; }
+   virtual bool isSupported(){ return true; }
+   virtual bool supportsSize(U32 size){ return size >= 2 && !(size & 1); }
+   virtual AudioFFTPlan* createPlan(U32 size){ return new AudioFFTPlanKiss(this, size); }
+};
+
+AudioFFTBackend* getAudioFFTBackendKiss(){
+   static AudioFFTBackendKiss sBackend;
+   return &sBackend;
+}
+
+// backend registry
+U32 AudioFFTBackend::getBackendCount(){
+#if defined(TORQUE_CPU_X86) || defined(TORQUE_CPU_X64)
+   return 2;
+#else
+   return 1;
+#endif
+}
+
+AudioFFTBackend* AudioFFTBackend::getBackend(U32 index){
+#if defined(TORQUE_CPU_X86) || defined(TORQUE_CPU_X64)
+   if(index == 0)
+      return getAudioFFTBackendSSE();
+   index--;
+#endif
+   if(index == 0)
+      return getAudioFFTBackendKiss();
+   return NULL;
+}
+
+AudioFFTBackend* AudioFFTBackend::findBackend(const char* name){
+   for(U32 count=0; count<getBackendCount(); count++){
+      AudioFFTBackend* backend = getBackend(count);
+      if(!dStricmp(backend->getName(), name))
+         return backend;
+   }
+   return NULL;
+}
+
+// plan cache
+Mutex AudioFFTPlanCache::smMutex;
+Vector<AudioFFTPlanCache::Entry*> AudioFFTPlanCache::smEntries;
+AudioFFTBackend* AudioFFTPlanCache::smBackend = NULL;
+volatile U32 AudioFFTPlanCache::smAllocCount = 0;
+
+AudioFFTPlanCache::Entry* AudioFFTPlanCache::findEntry(AudioFFTBackend* backend, U32 size, bool create){
+   for(U32 count=0; count<smEntries.size(); count++){
+      if(smEntries[count]->backend == backend && smEntries[count]->size == size)
+         return smEntries[count];
+   }
+   if(!create)
+      return NULL;
+
+   Entry* entry = new Entry;
+   entry->backend = backend;
+   entry->size = size;
+   entry->created = 0;
+   smEntries.push_back(entry);
+   return entry;
+}
+
+bool AudioFFTPlanCache::selectBackend(const char* name){
+   AudioFFTBackend* backend = NULL;
+   if(!name || !name[0]){
+      for(U32 count=0; count<AudioFFTBackend::getBackendCount() && !backend; count++){
+         if(AudioFFTBackend::getBackend(count)->isSupported())
+            backend = AudioFFTBackend::getBackend(count);
+      }
+   }else{
+      backend = AudioFFTBackend::findBackend(name);
+      if(!backend || !backend->isSupported())
+         return false;
+   }
+
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+   smBackend = backend;
+   return true;
+}
+
+AudioFFTBackend* AudioFFTPlanCache::getSelectedBackend(){
+   if(!smBackend)
+      selectBackend(NULL);
+   return smBackend;
+}
+
+AudioFFTPlan* AudioFFTPlanCache::acquire(U32 size){
+   AudioFFTBackend* backend = getSelectedBackend();
+   if(!backend->supportsSize(size))
+      backend = getAudioFFTBackendKiss();
+
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+
+   Entry* entry = findEntry(backend, size, true);
+   if(entry->free.size()){
+      AudioFFTPlan* plan = entry->free.last();
+      entry->free.pop_back();
+      return plan;
+   }
+
+   // every plan of this size is busy on another thread
+   entry->created++;
+   dFetchAndAdd(smAllocCount, 1);
+   // reserve room so releasing never grows the free list
+   entry->free.reserve(entry->created);
+   return backend->createPlan(size);
+}
+
+void AudioFFTPlanCache::release(AudioFFTPlan* plan){
+   if(!plan)
+      return;
+
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+
+   Entry* entry = findEntry(plan->getBackend(), plan->getSize(), false);
+   if(!entry){
+      // cache was purged while the plan was out
+      delete plan;
+      return;
+   }
+   entry->free.push_back(plan);
+}
+
+void AudioFFTPlanCache::purge(){
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+
+   for(U32 count=0; count<smEntries.size();){
+      Entry* entry = smEntries[count];
+      for(U32 index=0; index<entry->free.size(); index++){
+         delete entry->free[index];
+      }
+      entry->created -= entry->free.size();
+      entry->free.clear();
+
+      // keep entries with plans still out so their release finds them
+      if(!entry->created){
+         delete entry;
+         smEntries.erase(count);
+      }else{
+         count++;
+      }
+   }
+}
+
+// scratch buffers
+volatile U32 AudioScratchBuffer::smAllocCount = 0;
+
+AudioScratchBuffer::~AudioScratchBuffer(){
+   if(mData)
+      dFree_aligned(mData);
+}
+
+void AudioScratchBuffer::grow(U32 bytes){
+   if(mData)
+      dFree_aligned(mData);
+
+   // round up so slowly growing requests settle quickly
+   mBytes = getNextPow2(bytes);
+   mData = dMalloc_aligned(mBytes, AUDIO_SCRATCH_ALIGN);
+   dFetchAndAdd(smAllocCount, 1);
+}
+
+// console
+DefineEngineFunction( setAudioFFTBackend, bool, (const char* backend), (""),
+   "Select the FFT engine used by the analysis objects.\n"
+   "@param backend \"sse\", \"kiss\" or \"\" for the fastest one this processor supports.\n"
+   "@return False if the backend is unknown or not supported.\n"
+   "@ingroup AudioLoopBack" )
+{
+   if(!AudioFFTPlanCache::selectBackend(backend)){
+      Con::warnf("setAudioFFTBackend: Backend not available: %s", backend);
+      return false;
+   }
+   return true;
+}
+
+DefineEngineFunction( getAudioFFTBackend, const char*, (),,
+   "Get the FFT engine used by the analysis objects.\n"
+   "@param No parameters.\n"
+   "@return Backend name.\n"
+   "@ingroup AudioLoopBack" )
+{
+   return AudioFFTPlanCache::getSelectedBackend()->getName();
+}
+
+DefineEngineFunction( benchmarkAudioFFT, void, (U32 points), (1 << 24),
+   "Time a forward real FFT on every supported backend at sizes from 256 to 16384.\n"
+   "Prints nanoseconds per point, the largest difference from the kiss reference and the "
+   "largest error of an inverse transform back to the input.\n"
+   "@param points Number of samples to transform per measurement, larger is more accurate.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack" )
+{
+   const U32 maxSize = 16384;
+   F32* input = (F32*)dMalloc_aligned(sizeof(F32)*maxSize, AUDIO_SCRATCH_ALIGN);
+   F32* output = (F32*)dMalloc_aligned(sizeof(F32)*(maxSize+2), AUDIO_SCRATCH_ALIGN);
+   F32* reference = (F32*)dMalloc_aligned(sizeof(F32)*(maxSize+2), AUDIO_SCRATCH_ALIGN);
+   F32* roundtrip = (F32*)dMalloc_aligned(sizeof(F32)*maxSize, AUDIO_SCRATCH_ALIGN);
+
+   U32 seed = 1;
+   for(U32 count=0; count<maxSize; count++){
+      seed = seed*1664525 + 1013904223;
+      input[count] = F32(seed >> 8)/F32(1 << 24) - 0.5f;
+   }
+
+   Con::printf("benchmarkAudioFFT: ns per point, selected backend is %s", AudioFFTPlanCache::getSelectedBackend()->getName());
+   for(U32 size=256; size<=maxSize; size*=2){
+      U32 iterations = getMax(points/size, U32(1));
+
+      AudioFFTPlan* kiss = getAudioFFTBackendKiss()->createPlan(size);
+      kiss->forward(input, reference);
+      delete kiss;
+
+      for(U32 index=0; index<AudioFFTBackend::getBackendCount(); index++){
+         AudioFFTBackend* backend = AudioFFTBackend::getBackend(index);
+         if(!backend->isSupported() || !backend->supportsSize(size))
+            continue;
+
+         AudioFFTPlan* plan = backend->createPlan(size);
+         U32 start = Platform::getRealMilliseconds();
+         for(U32 count=0; count<iterations; count++)
+            plan->forward(input, output);
+         U32 elapsed = Platform::getRealMilliseconds() - start;
+
+         F32 maxError = 0.0f;
+         for(U32 count=0; count<size+2; count++)
+            maxError = getMax(maxError, mFabs(output[count] - reference[count]));
+
+         // round trip, the inverse is not normalised
+         plan->inverse(output, roundtrip);
+         F32 inverseError = 0.0f;
+         for(U32 count=0; count<size; count++)
+            inverseError = getMax(inverseError, mFabs(roundtrip[count]/size - input[count]));
+         delete plan;
+
+         F32 ns = F32(elapsed)*1000000.0f/(F32(iterations)*F32(size));
+         Con::printf("   %5d %-4s  %.3f ns  (max difference %g, inverse error %g)", size, backend->getName(), ns, maxError, inverseError);
+      }
+   }
+
+   dFree_aligned(input);
+   dFree_aligned(output);
+   dFree_aligned(reference);
+   dFree_aligned(roundtrip);
+}
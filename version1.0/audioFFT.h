@@ -0,0 +1,145 @@
+#ifndef _AUDIO_FFT_H_
+#define _AUDIO_FFT_H_
+
+#include "platform/platform.h"
+#include "platform/platformIntrinsics.h"
+#include "platform/threads/mutex.h"
+#include <core/util/tVector.h>
+
+/*
+FFT engines and reusable FFT resources so the per hop processing does not touch the heap.
+
+An AudioFFTBackend creates AudioFFTPlans, a plan does forward and inverse real transforms
+of one size.
+   kiss - kiss_fftr, any even size, the portable reference
+   sse  - split radix-2 Stockham on SSE, power of 2 sizes from 16 up
+The fastest backend the processor supports is selected at startup, sizes a backend cannot
+do fall back to kiss.
+
+AudioFFTPlanCache keeps plans per backend and size, shared by every object that uses
+that size.  Plans carry their own scratch space so one plan cannot be used by two
+threads at once; objects acquire a plan for the duration of one transform and release it
+afterwards.  Once every worker has a plan for a size no new plans are created.
+
+AudioScratchBuffer is an aligned buffer that only ever grows, used for per object
+working memory.
+
+Both count their heap allocations so benchmarks can show the steady state is allocation free.
+*/
+
+// alignment of scratch memory, enough for SSE/AVX loads
+#define AUDIO_SCRATCH_ALIGN 32
+
+class AudioFFTBackend;
+
+class AudioFFTPlan
+{
+protected:
+   U32 mSize;
+   AudioFFTBackend* mBackend;
+
+public:
+   AudioFFTPlan(AudioFFTBackend* backend, U32 size){ mBackend = backend; mSize = size; }
+   virtual ~AudioFFTPlan(){}
+
+   U32 getSize(){ return mSize; }
+   AudioFFTBackend* getBackend(){ return mBackend; }
+
+   // forward transform of getSize() real samples
+   //    output is getSize()/2+1 complex values as interleaved real/imaginary pairs, same as kiss_fft_cpx
+   //    output must not overlap input
+   virtual void forward(const F32* input, F32* output) = 0;
+   // inverse of forward, getSize()/2+1 complex values to getSize() real samples
+   //    not normalised, forward followed by inverse scales by getSize()
+   //    output must not overlap input
+   virtual void inverse(const F32* input, F32* output) = 0;
+};
+
+class AudioFFTBackend
+{
+public:
+   virtual ~AudioFFTBackend(){}
+
+   // script name
+   virtual const char* getName() = 0;
+   // processor can run this backend
+   virtual bool isSupported() = 0;
+   // backend can do transforms of size
+   virtual bool supportsSize(U32 size) = 0;
+   virtual AudioFFTPlan* createPlan(U32 size) = 0;
+
+   // registered backends, fastest first
+   static U32 getBackendCount();
+   static AudioFFTBackend* getBackend(U32 index);
+   static AudioFFTBackend* findBackend(const char* name);
+};
+
+class AudioFFTPlanCache
+{
+private:
+   struct Entry {
+      AudioFFTBackend* backend;
+      U32 size;
+      Vector<AudioFFTPlan*> free;
+      U32 created;
+   };
+
+   static Mutex smMutex;
+   static Vector<Entry*> smEntries;
+   static AudioFFTBackend* smBackend;
+   static volatile U32 smAllocCount;
+
+   static Entry* findEntry(AudioFFTBackend* backend, U32 size, bool create);
+
+public:
+   // get a forward real FFT plan for size, creates one if all existing plans are in use
+   //    size must be even
+   static AudioFFTPlan* acquire(U32 size);
+   // give a plan back to the cache
+   static void release(AudioFFTPlan* plan);
+   // free all unused plans, plans that are in use are freed when released
+   static void purge();
+
+   // use the named backend for new acquires, NULL or "" picks the fastest supported one
+   //    returns false if the backend is unknown or not supported
+   static bool selectBackend(const char* name);
+   static AudioFFTBackend* getSelectedBackend();
+
+   // number of plans created since startup
+   static U32 getAllocCount(){ return dAtomicRead(smAllocCount); }
+};
+
+class AudioScratchBuffer
+{
+private:
+   void* mData;
+   U32 mBytes;
+
+   static volatile U32 smAllocCount;
+
+   void grow(U32 bytes);
+
+public:
+   AudioScratchBuffer(){ mData = NULL; mBytes = 0; }
+   ~AudioScratchBuffer();
+
+   // get at least count elements, contents are undefined after a grow
+   template<class T> T* reserve(U32 count){
+      U32 bytes = count*sizeof(T);
+      if(bytes > mBytes)
+         grow(bytes);
+      return (T*)mData;
+   }
+   U32 getBytes(){ return mBytes; }
+
+   // number of scratch allocations since startup
+   static U32 getAllocCount(){ return dAtomicRead(smAllocCount); }
+};
+
+// backends in audioFFT.cpp and audioFFTSSE.cpp
+AudioFFTBackend* getAudioFFTBackendKiss();
+#if defined(TORQUE_CPU_X86) || defined(TORQUE_CPU_X64)
+AudioFFTBackend* getAudioFFTBackendSSE();
+#endif
+
+#endif // _AUDIO_FFT_H_
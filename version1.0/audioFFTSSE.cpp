@@ -0,0 +1,294 @@
+#include "audioFFT.h"
+
+#if defined(TORQUE_CPU_X86) || defined(TORQUE_CPU_X64)
+
+#include "math/mMath.h"
+#include <xmmintrin.h>
+
+/*
+Real FFT of size N on SSE.
+The N real samples are packed as N/2 complex values (even samples real, odd imaginary),
+transformed with a radix-2 Stockham FFT and split back into the N/2+1 bins of the real
+transform.  The inverse runs the same steps backwards, merging the bins into N/2 complex
+values and using the forward passes on the conjugate.  Stockham ping-pongs between two buffers instead of bit reversing, so every
+pass reads and writes in order.  Data is kept as separate real and imaginary arrays so
+four butterflies run per instruction:
+   stride 1 pass - vectorised over the butterfly index, outputs interleaved with unpack
+   stride 2 pass - pairs of butterflies, outputs rearranged with movelh/movehl
+   stride 4+     - vectorised over the stride with a broadcast twiddle
+*/
+
+// smallest size handled, the first two passes need 4 butterflies
+#define AUDIO_FFT_SSE_MIN_SIZE 16
+
+class AudioFFTPlanSSE : public AudioFFTPlan
+{
+   typedef AudioFFTPlan Parent;
+
+   U32 mHalf;           // complex FFT size, N/2
+   F32* mMemory;
+   F32* mRe[2];
+   F32* mIm[2];
+   F32* mTwRe;          // exp(-2*pi*i*k/mHalf), k < mHalf/2
+   F32* mTwIm;
+   F32* mTw2Re;         // stride 2 pass twiddles, each one twice
+   F32* mTw2Im;
+   F32* mPostRe;        // exp(-2*pi*i*k/N), k < mHalf
+   F32* mPostIm;
+
+   // complex FFT of mHalf values in mRe[0]/mIm[0], re and im point at the result
+   void transform(F32*& re, F32*& im);
+
+public:
+   AudioFFTPlanSSE(AudioFFTBackend* backend, U32 size);
+   virtual ~AudioFFTPlanSSE();
+
+   virtual void forward(const F32* input, F32* output);
+   virtual void inverse(const F32* input, F32* output);
+};
+
+AudioFFTPlanSSE::AudioFFTPlanSSE(AudioFFTBackend* backend, U32 size)
+:Parent(backend, size)
+{
+   mHalf = size/2;
+   U32 quarter = mHalf/2;
+
+   // one block for everything, each array starts on a 16 byte boundary since mHalf is a multiple of 4
+   U32 floats = mHalf*4 + quarter*2 + quarter*2 + mHalf*2;
+   mMemory = (F32*)dMalloc_aligned(sizeof(F32)*floats, AUDIO_SCRATCH_ALIGN);
+   F32* next = mMemory;
+   mRe[0] = next; next += mHalf;
+   mIm[0] = next; next += mHalf;
+   mRe[1] = next; next += mHalf;
+   mIm[1] = next; next += mHalf;
+   mTwRe = next; next += quarter;
+   mTwIm = next; next += quarter;
+   mTw2Re = next; next += quarter;
+   mTw2Im = next; next += quarter;
+   mPostRe = next; next += mHalf;
+   mPostIm = next; next += mHalf;
+
+   for(U32 count=0; count<quarter; count++){
+      F64 angle = -M_2PI*(F64)count/(F64)mHalf;
+      mTwRe[count] = (F32)mCos(angle);
+      mTwIm[count] = (F32)mSin(angle);
+   }
+   // stride 2 pass uses twiddle 2p for butterfly p
+   for(U32 count=0; count<mHalf/8; count++){
+      mTw2Re[count*4+0] = mTw2Re[count*4+1] = mTwRe[count*4];
+      mTw2Im[count*4+0] = mTw2Im[count*4+1] = mTwIm[count*4];
+      mTw2Re[count*4+2] = mTw2Re[count*4+3] = mTwRe[count*4+2];
+      mTw2Im[count*4+2] = mTw2Im[count*4+3] = mTwIm[count*4+2];
+   }
+   for(U32 count=0; count<mHalf; count++){
+      F64 angle = -M_2PI*(F64)count/(F64)size;
+      mPostRe[count] = (F32)mCos(angle);
+      mPostIm[count] = (F32)mSin(angle);
+   }
+}
+
+AudioFFTPlanSSE::~AudioFFTPlanSSE(){
+   dFree_aligned(mMemory);
+}
+
+void AudioFFTPlanSSE::transform(F32*& re, F32*& im){
+   const U32 half = mHalf;
+   F32* xr = mRe[0];
+   F32* xi = mIm[0];
+   F32* yr = mRe[1];
+   F32* yi = mIm[1];
+
+   // stride 1, n = half
+   {
+      U32 m = half/2;
+      for(U32 p=0; p<m; p+=4){
+         __m128 ar = _mm_load_ps(xr + p), ai = _mm_load_ps(xi + p);
+         __m128 br = _mm_load_ps(xr + p + m), bi = _mm_load_ps(xi + p + m);
+         __m128 wr = _mm_load_ps(mTwRe + p), wi = _mm_load_ps(mTwIm + p);
+         __m128 sr = _mm_add_ps(ar, br), si = _mm_add_ps(ai, bi);
+         __m128 dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+         __m128 tr = _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi));
+         __m128 ti = _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr));
+         // y[2p] = sum, y[2p+1] = difference
+         _mm_store_ps(yr + p*2, _mm_unpacklo_ps(sr, tr));
+         _mm_store_ps(yr + p*2 + 4, _mm_unpackhi_ps(sr, tr));
+         _mm_store_ps(yi + p*2, _mm_unpacklo_ps(si, ti));
+         _mm_store_ps(yi + p*2 + 4, _mm_unpackhi_ps(si, ti));
+      }
+      F32* swap;
+      swap = xr; xr = yr; yr = swap;
+      swap = xi; xi = yi; yi = swap;
+   }
+
+   // stride 2, n = half/2, a vector holds butterflies p and p+1 for both strides
+   {
+      U32 m = half/4;
+      for(U32 p=0; p<m; p+=2){
+         __m128 ar = _mm_load_ps(xr + p*2), ai = _mm_load_ps(xi + p*2);
+         __m128 br = _mm_load_ps(xr + (p + m)*2), bi = _mm_load_ps(xi + (p + m)*2);
+         __m128 wr = _mm_load_ps(mTw2Re + p*2), wi = _mm_load_ps(mTw2Im + p*2);
+         __m128 sr = _mm_add_ps(ar, br), si = _mm_add_ps(ai, bi);
+         __m128 dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+         __m128 tr = _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi));
+         __m128 ti = _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr));
+         // y[4p + q] = sum, y[4p + 2 + q] = difference
+         _mm_store_ps(yr + p*4, _mm_movelh_ps(sr, tr));
+         _mm_store_ps(yr + p*4 + 4, _mm_movehl_ps(tr, sr));
+         _mm_store_ps(yi + p*4, _mm_movelh_ps(si, ti));
+         _mm_store_ps(yi + p*4 + 4, _mm_movehl_ps(ti, si));
+      }
+      F32* swap;
+      swap = xr; xr = yr; yr = swap;
+      swap = xi; xi = yi; yi = swap;
+   }
+
+   // remaining passes, vectorised over the stride
+   for(U32 s=4; s<half; s*=2){
+      U32 m = half/(s*2);
+      for(U32 p=0; p<m; p++){
+         __m128 wr = _mm_set1_ps(mTwRe[p*s]);
+         __m128 wi = _mm_set1_ps(mTwIm[p*s]);
+         const F32* ar0 = xr + s*p;
+         const F32* ai0 = xi + s*p;
+         const F32* br0 = xr + s*(p + m);
+         const F32* bi0 = xi + s*(p + m);
+         F32* sr0 = yr + s*(2*p);
+         F32* si0 = yi + s*(2*p);
+         F32* tr0 = yr + s*(2*p + 1);
+         F32* ti0 = yi + s*(2*p + 1);
+         for(U32 q=0; q<s; q+=4){
+            __m128 ar = _mm_load_ps(ar0 + q), ai = _mm_load_ps(ai0 + q);
+            __m128 br = _mm_load_ps(br0 + q), bi = _mm_load_ps(bi0 + q);
+            __m128 dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+            _mm_store_ps(sr0 + q, _mm_add_ps(ar, br));
+            _mm_store_ps(si0 + q, _mm_add_ps(ai, bi));
+            _mm_store_ps(tr0 + q, _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi)));
+            _mm_store_ps(ti0 + q, _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr)));
+         }
+      }
+      F32* swap;
+      swap = xr; xr = yr; yr = swap;
+      swap = xi; xi = yi; yi = swap;
+   }
+
+   re = xr;
+   im = xi;
+}
+
+void AudioFFTPlanSSE::forward(const F32* input, F32* output){
+   const U32 half = mHalf;
+
+   // pack even samples as real, odd as imaginary
+   F32* xr = mRe[0];
+   F32* xi = mIm[0];
+   for(U32 k=0; k<half; k+=4){
+      __m128 a = _mm_loadu_ps(input + k*2);
+      __m128 b = _mm_loadu_ps(input + k*2 + 4);
+      _mm_store_ps(xr + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)));
+      _mm_store_ps(xi + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1)));
+   }
+   transform(xr, xi);
+
+   // split into the real transform
+   //    X[k] = (Z[k] + conj(Z[N/2-k]))/2 - i*W^k*(Z[k] - conj(Z[N/2-k]))/2
+   output[0] = xr[0] + xi[0];
+   output[1] = 0.0f;
+   output[half*2+0] = xr[0] - xi[0];
+   output[half*2+1] = 0.0f;
+
+   __m128 vhalf = _mm_set1_ps(0.5f);
+   U32 k = 1;
+   for(; k+4<=half; k+=4){
+      // Z[k..k+3] and Z[half-k-3..half-k] reversed
+      __m128 zr = _mm_loadu_ps(xr + k), zi = _mm_loadu_ps(xi + k);
+      __m128 nr = _mm_loadu_ps(xr + half - k - 3), ni = _mm_loadu_ps(xi + half - k - 3);
+      nr = _mm_shuffle_ps(nr, nr, _MM_SHUFFLE(0,1,2,3));
+      ni = _mm_shuffle_ps(ni, ni, _MM_SHUFFLE(0,1,2,3));
+      __m128 er = _mm_mul_ps(_mm_add_ps(zr, nr), vhalf);
+      __m128 ei = _mm_mul_ps(_mm_sub_ps(zi, ni), vhalf);
+      __m128 orr = _mm_mul_ps(_mm_add_ps(zi, ni), vhalf);
+      __m128 oi = _mm_mul_ps(_mm_sub_ps(nr, zr), vhalf);
+      __m128 cr = _mm_loadu_ps(mPostRe + k), ci = _mm_loadu_ps(mPostIm + k);
+      __m128 xr4 = _mm_add_ps(er, _mm_sub_ps(_mm_mul_ps(cr, orr), _mm_mul_ps(ci, oi)));
+      __m128 xi4 = _mm_add_ps(ei, _mm_add_ps(_mm_mul_ps(cr, oi), _mm_mul_ps(ci, orr)));
+      _mm_storeu_ps(output + k*2, _mm_unpacklo_ps(xr4, xi4));
+      _mm_storeu_ps(output + k*2 + 4, _mm_unpackhi_ps(xr4, xi4));
+   }
+   for(; k<half; k++){
+      U32 n = half - k;
+      F32 er = (xr[k] + xr[n])*0.5f;
+      F32 ei = (xi[k] - xi[n])*0.5f;
+      F32 orr = (xi[k] + xi[n])*0.5f;
+      F32 oi = (xr[n] - xr[k])*0.5f;
+      output[k*2+0] = er + (mPostRe[k]*orr - mPostIm[k]*oi);
+      output[k*2+1] = ei + (mPostRe[k]*oi + mPostIm[k]*orr);
+   }
+}
+
+void AudioFFTPlanSSE::inverse(const F32* input, F32* output){
+   const U32 half = mHalf;
+
+   // merge into the half size spectrum, conjugated so the forward passes do the inverse
+   //    Z[k] = E[k] + i*O[k], E[k] = X[k] + conj(X[N/2-k]), O[k] = W^-k*(X[k] - conj(X[N/2-k]))
+   F32* xr = mRe[0];
+   F32* xi = mIm[0];
+   xr[0] = input[0] + input[half*2];
+   xi[0] = -(input[0] - input[half*2]);
+
+   U32 k = 1;
+   for(; k+4<=half; k+=4){
+      // X[k..k+3] and X[half-k-3..half-k] reversed
+      __m128 a = _mm_loadu_ps(input + k*2), b = _mm_loadu_ps(input + k*2 + 4);
+      __m128 kr = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)), ki = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+      a = _mm_loadu_ps(input + (half - k - 3)*2);
+      b = _mm_loadu_ps(input + (half - k - 3)*2 + 4);
+      __m128 nr = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)), ni = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+      nr = _mm_shuffle_ps(nr, nr, _MM_SHUFFLE(0,1,2,3));
+      ni = _mm_shuffle_ps(ni, ni, _MM_SHUFFLE(0,1,2,3));
+      __m128 er = _mm_add_ps(kr, nr), ei = _mm_sub_ps(ki, ni);
+      __m128 dr = _mm_sub_ps(kr, nr), di = _mm_add_ps(ki, ni);
+      __m128 cr = _mm_loadu_ps(mPostRe + k), ci = _mm_loadu_ps(mPostIm + k);
+      __m128 orr = _mm_add_ps(_mm_mul_ps(dr, cr), _mm_mul_ps(di, ci));
+      __m128 oi = _mm_sub_ps(_mm_mul_ps(di, cr), _mm_mul_ps(dr, ci));
+      _mm_storeu_ps(xr + k, _mm_sub_ps(er, oi));
+      _mm_storeu_ps(xi + k, _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(ei, orr)));
+   }
+   for(; k<half; k++){
+      U32 n = half - k;
+      F32 er = input[k*2+0] + input[n*2+0];
+      F32 ei = input[k*2+1] - input[n*2+1];
+      F32 dr = input[k*2+0] - input[n*2+0];
+      F32 di = input[k*2+1] + input[n*2+1];
+      F32 orr = dr*mPostRe[k] + di*mPostIm[k];
+      F32 oi = di*mPostRe[k] - dr*mPostIm[k];
+      xr[k] = er - oi;
+      xi[k] = -(ei + orr);
+   }
+
+   transform(xr, xi);
+
+   // conjugate back and unpack, real parts are the even samples
+   __m128 sign = _mm_set1_ps(-0.0f);
+   for(k=0; k<half; k+=4){
+      __m128 r = _mm_load_ps(xr + k);
+      __m128 i = _mm_xor_ps(_mm_load_ps(xi + k), sign);
+      _mm_storeu_ps(output + k*2, _mm_unpacklo_ps(r, i));
+      _mm_storeu_ps(output + k*2 + 4, _mm_unpackhi_ps(r, i));
+   }
+}
+
+class AudioFFTBackendSSE : public AudioFFTBackend
+{
+public:
+   virtual const char* getName(){ return "sse"; }
+   virtual bool isSupported(){ return (Platform::SystemInfo.processor.properties & CPU_PROP_SSE) != 0; }
+   virtual bool supportsSize(U32 size){ return size >= AUDIO_FFT_SSE_MIN_SIZE && isPow2(size); }
+   virtual AudioFFTPlan* createPlan(U32 size){ return new AudioFFTPlanSSE(this, size); }
+};
+
+AudioFFTBackend* getAudioFFTBackendSSE(){
+   static AudioFFTBackendSSE sBackend;
+   return &sBackend;
+}
+
+#endif
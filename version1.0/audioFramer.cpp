@@ -0,0 +1,60 @@
+#include "audioFramer.h"
+
+#include "math/mMathFn.h"
+
+AudioFramer::AudioFramer(){
+   mFrameSize = 0;
+   mHopSize = 0;
+   mChannels = 1;
+   mStart = 0;
+   mCount = 0;
+}
+
+U32 AudioFramer::roundFrameSize(U32 frameSize){
+   return getNextPow2(mClamp(frameSize, AUDIO_FRAMER_MIN_SIZE, AUDIO_FRAMER_MAX_SIZE));
+}
+
+void AudioFramer::setup(U32 frameSize, U32 hopSize, U32 channels){
+   mFrameSize = roundFrameSize(frameSize);
+   mHopSize = mClamp(hopSize, 1, mFrameSize);
+   mChannels = getMax(channels, U32(1));
+   reset();
+}
+
+void AudioFramer::reset(){
+   mStart = 0;
+   mCount = 0;
+}
+
+F32* AudioFramer::getWriteBuffer(U32 frames){
+   // slide the unread part to the front, less than one frame worth of data
+   //    the hop never exceeds the frame size so mStart <= mCount
+   if(mStart){
+      U32 remaining = mCount - mStart;
+      if(remaining)
+         dMemmove(mBuffer.address(), mBuffer.address() + mStart*mChannels, sizeof(F32)*remaining*mChannels);
+      mCount = remaining;
+      mStart = 0;
+   }
+
+   U32 needed = (mCount + frames)*mChannels;
+   if(needed > mBuffer.size())
+      mBuffer.setSize(needed);
+
+   return mBuffer.address() + mCount*mChannels;
+}
+
+void AudioFramer::write(const F32* data, U32 frames){
+   F32* dest = getWriteBuffer(frames);
+   dMemcpy(dest, data, sizeof(F32)*frames*mChannels);
+   commit(frames);
+}
+
+const F32* AudioFramer::nextFrame(){
+   if(mCount < mStart + mFrameSize)
+      return NULL;
+
+   const F32* frame = mBuffer.address() + mStart*mChannels;
+   mStart += mHopSize;
+   return frame;
+}
@@ -0,0 +1,61 @@
+#ifndef _AUDIO_FRAMER_H_
+#define _AUDIO_FRAMER_H_
+
+#include "platform/platform.h"
+#include <core/util/tVector.h>
+
+/*
+Cuts a continuous stream into fixed size overlapping frames for STFT style analysis.
+Blocks of any size are written in, complete frames of mFrameSize are read out every
+mHopSize frames.  With a hop of half the frame size each sample shows up in two frames
+(50% overlap), a quarter gives 75% overlap.
+
+Data is interleaved with mChannels channels.  The buffer only grows, so once the largest
+block size has been seen no more allocations happen.
+*/
+
+// limits for frame sizes set from script
+#define AUDIO_FRAMER_MIN_SIZE 64
+#define AUDIO_FRAMER_MAX_SIZE 32768
+
+class AudioFramer
+{
+private:
+   U32 mFrameSize;
+   U32 mHopSize;
+   U32 mChannels;
+
+   // pending frames, mStart is the first frame of the next output frame
+   Vector<F32> mBuffer;
+   U32 mStart;
+   U32 mCount;
+
+public:
+   AudioFramer();
+
+   // frameSize is rounded with roundFrameSize, hopSize is clamped to 1..frameSize
+   void setup(U32 frameSize, U32 hopSize, U32 channels = 1);
+   // clamp to the size limits and round up to a power of 2
+   static U32 roundFrameSize(U32 frameSize);
+   // drop pending data, eg: when the sample rate changes
+   void reset();
+
+   U32 getFrameSize(){ return mFrameSize; }
+   U32 getHopSize(){ return mHopSize; }
+   U32 getChannels(){ return mChannels; }
+
+   // get room for frames new frames at the end of the buffer, call commit when filled
+   //    pointers returned by nextFrame are invalid after this
+   F32* getWriteBuffer(U32 frames);
+   void commit(U32 frames){ mCount += frames; }
+   // copy frames in
+   void write(const F32* data, U32 frames);
+
+   // get the next complete frame and advance by one hop
+   //    returns NULL when not enough data is pending
+   const F32* nextFrame();
+   // number of complete frames available
+   U32 getFramesReady(){ return mCount - mStart >= mFrameSize ? (mCount - mStart - mFrameSize)/mHopSize + 1 : 0; }
+};
+
+#endif // _AUDIO_FRAMER_H_
@@ -0,0 +1,963 @@
+#include "audioKernels.h"
+
+#include "math/mMath.h"
+#include "console/engineAPI.h"
+#include <float.h>
+
+#if defined(TORQUE_CPU_X86) || defined(TORQUE_CPU_X64)
+#define AUDIO_KERNELS_X86
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// gcc and clang only emit AVX instructions in functions marked for it
+#if defined(AUDIO_KERNELS_X86) && defined(__GNUC__)
+#define AUDIO_TARGET_AVX __attribute__((target("avx")))
+#else
+#define AUDIO_TARGET_AVX
+#endif
+
+// C versions
+static void audioMix_C(F32* dest, const F32* stereo, F32 gain, U32 count){
+   for(U32 index=0; index<count; index++){
+      dest[index] = (stereo[index*2+0] + stereo[index*2+1])*gain;
+   }
+}
+static void audioMixWindow_C(F32* dest, const F32* stereo, const F32* window, F32 gain, U32 count){
+   for(U32 index=0; index<count; index++){
+      dest[index] = (stereo[index*2+0] + stereo[index*2+1])*gain*window[index];
+   }
+}
+static void audioPowerSpectrum_C(F32* dest, const F32* complex, U32 count){
+   for(U32 index=0; index<count; index++){
+      dest[index] = complex[index*2+0]*complex[index*2+0] + complex[index*2+1]*complex[index*2+1];
+   }
+}
+static void audioLog_C(F32* dest, const F32* src, F32 scale, U32 count){
+   for(U32 index=0; index<count; index++){
+      dest[index] = mLog(getMax(src[index], FLT_MIN))*scale;
+   }
+}
+static void audioSmooth_C(F32* state, const F32* input, F32 filter, U32 count){
+   for(U32 index=0; index<count; index++){
+      state[index] += filter*(input[index] - state[index]);
+   }
+}
+static void audioSmoothAttackRelease_C(F32* state, const F32* input, const F32* attack, const F32* release, U32 count){
+   for(U32 index=0; index<count; index++){
+      F32 diff = input[index] - state[index];
+      state[index] += (diff > 0.0f ? attack[index] : release[index])*diff;
+   }
+}
+static void audioResonate_C(F32* state, F32* energy, const F32* coef, const F32* input, U32 frames, U32 bands){
+   for(U32 band=0; band<bands; band++){
+      F32 are = state[band], aim = state[bands+band];
+      F32 bre = state[bands*2+band], bim = state[bands*3+band];
+      F32 cr = coef[band], ci = coef[bands+band];
+      F32 sum = 0.0f;
+      for(U32 count=0; count<frames; count++){
+         F32 nre = are*cr - aim*ci + input[count];
+         aim = are*ci + aim*cr;
+         are = nre;
+         nre = bre*cr - bim*ci + are;
+         bim = bre*ci + bim*cr + aim;
+         bre = nre;
+         sum += bre*bre + bim*bim;
+      }
+      state[band] = are;
+      state[bands+band] = aim;
+      state[bands*2+band] = bre;
+      state[bands*3+band] = bim;
+      energy[band] += sum;
+   }
+}
+static void audioHalfband_C(F32* dest, const F32* even, const F32* odd, const F32* coef, U32 count){
+   const U32 taps = AUDIO_HALFBAND_TAPS;
+   for(U32 index=0; index<count; index++){
+      const F32* e = even + index;
+      F32 sum = 0.5f*odd[index + taps - 1];
+      for(U32 tap=0; tap<taps; tap++)
+         sum += coef[tap]*(e[taps - 1 - tap] + e[taps + tap]);
+      dest[index] = sum;
+   }
+}
+static void audioStereoTruePeak_C(F32* sumSquares, F32* peaks, F32* truePeaks, const F32* stereo, const F32* coef, U32 count){
+   const U32 taps = AUDIO_TRUEPEAK_TAPS;
+   F32 sumLeft = 0.0f, sumRight = 0.0f;
+   F32 peakLeft = peaks[0], peakRight = peaks[1];
+   F32 trueLeft = truePeaks[0], trueRight = truePeaks[1];
+   for(U32 index=0; index<count; index++){
+      const F32* newest = stereo + (taps - 1 + index)*2;
+      F32 left = newest[0], right = newest[1];
+      sumLeft += left*left;
+      sumRight += right*right;
+      peakLeft = getMax(peakLeft, mFabs(left));
+      peakRight = getMax(peakRight, mFabs(right));
+      for(U32 phase=0; phase<4; phase++){
+         const F32* c = coef + phase*taps;
+         F32 sumL = 0.0f, sumR = 0.0f;
+         for(U32 tap=0; tap<taps; tap++){
+            sumL += c[tap]*newest[-(S32)tap*2];
+            sumR += c[tap]*newest[1 - (S32)tap*2];
+         }
+         trueLeft = getMax(trueLeft, mFabs(sumL));
+         trueRight = getMax(trueRight, mFabs(sumR));
+      }
+   }
+   sumSquares[0] += sumLeft;
+   sumSquares[1] += sumRight;
+   peaks[0] = peakLeft;
+   peaks[1] = peakRight;
+   truePeaks[0] = trueLeft;
+   truePeaks[1] = trueRight;
+}
+static void audioStereoBiquadEnergy_C(F32* state, F32* sumSquares, const F32* coef, const F32* stereo, U32 count){
+   for(U32 channel=0; channel<2; channel++){
+      // transposed direct form II
+      F32* s = state + channel*4;
+      F32 s1 = s[0], s2 = s[1], s3 = s[2], s4 = s[3];
+      F32 sum = 0.0f;
+      for(U32 index=0; index<count; index++){
+         F32 x = stereo[index*2+channel];
+         F32 y = coef[0]*x + s1;
+         s1 = coef[1]*x - coef[3]*y + s2;
+         s2 = coef[2]*x - coef[4]*y;
+         F32 z = coef[5]*y + s3;
+         s3 = coef[6]*y - coef[8]*z + s4;
+         s4 = coef[7]*y - coef[9]*z;
+         sum += z*z;
+      }
+      s[0] = s1; s[1] = s2; s[2] = s3; s[3] = s4;
+      sumSquares[channel] += sum;
+   }
+}
+static void audioStereoWindow_C(F32* left, F32* right, const F32* stereo, const F32* window, F32 gain, U32 count){
+   for(U32 index=0; index<count; index++){
+      F32 scale = gain*window[index];
+      left[index] = stereo[index*2+0]*scale;
+      right[index] = stereo[index*2+1]*scale;
+   }
+}
+static void audioCrossSpectrum_C(F32* powerLeft, F32* powerRight, F32* cross, const F32* left, const F32* right, U32 count){
+   for(U32 index=0; index<count; index++){
+      F32 lre = left[index*2+0], lim = left[index*2+1];
+      F32 rre = right[index*2+0], rim = right[index*2+1];
+      powerLeft[index] = lre*lre + lim*lim;
+      powerRight[index] = rre*rre + rim*rim;
+      cross[index] = lre*rre + lim*rim;
+   }
+}
+static void audioStereoProducts_C(F32* sums, const F32* stereo, U32 count){
+   F32 leftSum = 0.0f, rightSum = 0.0f, crossSum = 0.0f;
+   for(U32 index=0; index<count; index++){
+      F32 left = stereo[index*2], right = stereo[index*2+1];
+      leftSum += left*left;
+      rightSum += right*right;
+      crossSum += left*right;
+   }
+   sums[0] += leftSum;
+   sums[1] += rightSum;
+   sums[2] += crossSum;
+}
+static void audioConjMultiply_C(F32* dest, const F32* a, const F32* b, U32 count){
+   for(U32 index=0; index<count; index++){
+      F32 ar = a[index*2+0], ai = a[index*2+1];
+      F32 br = b[index*2+0], bi = b[index*2+1];
+      dest[index*2+0] = ar*br + ai*bi;
+      dest[index*2+1] = ar*bi - ai*br;
+   }
+}
+
+static const AudioKernelSet sKernelsC = {
+   "C",
+   audioMix_C,
+   audioMixWindow_C,
+   audioPowerSpectrum_C,
+   audioLog_C,
+   audioSmooth_C,
+   audioSmoothAttackRelease_C,
+   audioResonate_C,
+   audioHalfband_C,
+   audioStereoTruePeak_C,
+   audioStereoBiquadEnergy_C,
+   audioStereoWindow_C,
+   audioCrossSpectrum_C,
+   audioStereoProducts_C,
+   audioConjMultiply_C,
+};
+
+#ifdef AUDIO_KERNELS_X86
+// SSE versions
+static void audioMix_SSE(F32* dest, const F32* stereo, F32 gain, U32 count){
+   __m128 vgain = _mm_set1_ps(gain);
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 a = _mm_loadu_ps(stereo + index*2);
+      __m128 b = _mm_loadu_ps(stereo + index*2 + 4);
+      __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+      __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+      _mm_storeu_ps(dest + index, _mm_mul_ps(_mm_add_ps(left, right), vgain));
+   }
+   audioMix_C(dest + index, stereo + index*2, gain, count - index);
+}
+
+static void audioMixWindow_SSE(F32* dest, const F32* stereo, const F32* window, F32 gain, U32 count){
+   __m128 vgain = _mm_set1_ps(gain);
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 a = _mm_loadu_ps(stereo + index*2);     // l0 r0 l1 r1
+      __m128 b = _mm_loadu_ps(stereo + index*2 + 4); // l2 r2 l3 r3
+      __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+      __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+      __m128 mono = _mm_mul_ps(_mm_add_ps(left, right), vgain);
+      _mm_storeu_ps(dest + index, _mm_mul_ps(mono, _mm_loadu_ps(window + index)));
+   }
+   audioMixWindow_C(dest + index, stereo + index*2, window + index, gain, count - index);
+}
+
+static void audioPowerSpectrum_SSE(F32* dest, const F32* complex, U32 count){
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 a = _mm_loadu_ps(complex + index*2);     // r0 i0 r1 i1
+      __m128 b = _mm_loadu_ps(complex + index*2 + 4); // r2 i2 r3 i3
+      a = _mm_mul_ps(a, a);
+      b = _mm_mul_ps(b, b);
+      __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+      __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+      _mm_storeu_ps(dest + index, _mm_add_ps(re, im));
+   }
+   audioPowerSpectrum_C(dest + index, complex + index*2, count - index);
+}
+
+// ln(x) for 4 values
+//    x = m * 2^e with m normalised to [sqrt(0.5), sqrt(2)), then
+//    ln(m) = 2*(t + t^3/3 + t^5/5 + t^7/7) with t = (m-1)/(m+1), |t| < 0.172
+static inline __m128 audioLog4_SSE(__m128 x){
+   x = _mm_max_ps(x, _mm_set1_ps(FLT_MIN));
+   __m128i bits = _mm_castps_si128(x);
+   __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+   __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+   __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+   m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))), _mm_andnot_ps(big, m));
+   e = _mm_add_ps(e, _mm_and_ps(big, _mm_set1_ps(1.0f)));
+
+   __m128 one = _mm_set1_ps(1.0f);
+   __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+   __m128 t2 = _mm_mul_ps(t, t);
+   __m128 p = _mm_add_ps(_mm_mul_ps(t2, _mm_set1_ps(1.0f/7.0f)), _mm_set1_ps(1.0f/5.0f));
+   p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f/3.0f));
+   p = _mm_add_ps(_mm_mul_ps(p, t2), one);
+   p = _mm_mul_ps(_mm_mul_ps(p, t), _mm_set1_ps(2.0f));
+
+   return _mm_add_ps(p, _mm_mul_ps(e, _mm_set1_ps(0.693147181f)));
+}
+
+static void audioLog_SSE(F32* dest, const F32* src, F32 scale, U32 count){
+   __m128 vscale = _mm_set1_ps(scale);
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      _mm_storeu_ps(dest + index, _mm_mul_ps(audioLog4_SSE(_mm_loadu_ps(src + index)), vscale));
+   }
+   if(index < count){
+      // pad the tail so the results match the vector path
+      F32 tail[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+      for(U32 count2=0; index+count2<count; count2++)
+         tail[count2] = src[index+count2];
+      _mm_storeu_ps(tail, _mm_mul_ps(audioLog4_SSE(_mm_loadu_ps(tail)), vscale));
+      for(U32 count2=0; index+count2<count; count2++)
+         dest[index+count2] = tail[count2];
+   }
+}
+
+static void audioSmooth_SSE(F32* state, const F32* input, F32 filter, U32 count){
+   __m128 vfilter = _mm_set1_ps(filter);
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 s = _mm_loadu_ps(state + index);
+      __m128 diff = _mm_sub_ps(_mm_loadu_ps(input + index), s);
+      _mm_storeu_ps(state + index, _mm_add_ps(s, _mm_mul_ps(diff, vfilter)));
+   }
+   audioSmooth_C(state + index, input + index, filter, count - index);
+}
+
+// the coefficient is picked with a compare mask rather than a branch
+static void audioSmoothAttackRelease_SSE(F32* state, const F32* input, const F32* attack, const F32* release, U32 count){
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 s = _mm_loadu_ps(state + index);
+      __m128 diff = _mm_sub_ps(_mm_loadu_ps(input + index), s);
+      __m128 rising = _mm_cmpgt_ps(diff, _mm_setzero_ps());
+      __m128 coef = _mm_or_ps(_mm_and_ps(rising, _mm_loadu_ps(attack + index)), _mm_andnot_ps(rising, _mm_loadu_ps(release + index)));
+      _mm_storeu_ps(state + index, _mm_add_ps(s, _mm_mul_ps(diff, coef)));
+   }
+   audioSmoothAttackRelease_C(state + index, input + index, attack + index, release + index, count - index);
+}
+
+// the second resonator of one sample runs alongside the first resonator of the next
+static void audioResonate_SSE(F32* state, F32* energy, const F32* coef, const F32* input, U32 frames, U32 bands){
+   for(U32 band=0; band<bands; band+=4){
+      __m128 are = _mm_loadu_ps(state + band);
+      __m128 aim = _mm_loadu_ps(state + bands + band);
+      __m128 bre = _mm_loadu_ps(state + bands*2 + band);
+      __m128 bim = _mm_loadu_ps(state + bands*3 + band);
+      __m128 cr = _mm_loadu_ps(coef + band);
+      __m128 ci = _mm_loadu_ps(coef + bands + band);
+      __m128 sum = _mm_setzero_ps();
+      for(U32 count=0; count<frames; count++){
+         __m128 nre = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(are, cr), _mm_mul_ps(aim, ci)), _mm_set1_ps(input[count]));
+         aim = _mm_add_ps(_mm_mul_ps(are, ci), _mm_mul_ps(aim, cr));
+         are = nre;
+         nre = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(bre, cr), _mm_mul_ps(bim, ci)), are);
+         bim = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bre, ci), _mm_mul_ps(bim, cr)), aim);
+         bre = nre;
+         sum = _mm_add_ps(sum, _mm_add_ps(_mm_mul_ps(bre, bre), _mm_mul_ps(bim, bim)));
+      }
+      _mm_storeu_ps(state + band, are);
+      _mm_storeu_ps(state + bands + band, aim);
+      _mm_storeu_ps(state + bands*2 + band, bre);
+      _mm_storeu_ps(state + bands*3 + band, bim);
+      _mm_storeu_ps(energy + band, _mm_add_ps(_mm_loadu_ps(energy + band), sum));
+   }
+}
+
+// 8 outputs per pass so each coefficient is broadcast once for two vectors
+static void audioHalfband_SSE(F32* dest, const F32* even, const F32* odd, const F32* coef, U32 count){
+   const U32 taps = AUDIO_HALFBAND_TAPS;
+   __m128 half = _mm_set1_ps(0.5f);
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      const F32* e = even + index;
+      __m128 sum0 = _mm_mul_ps(_mm_loadu_ps(odd + index + taps - 1), half);
+      __m128 sum1 = _mm_mul_ps(_mm_loadu_ps(odd + index + taps + 3), half);
+      for(U32 tap=0; tap<taps; tap++){
+         __m128 c = _mm_set1_ps(coef[tap]);
+         __m128 a0 = _mm_add_ps(_mm_loadu_ps(e + taps - 1 - tap), _mm_loadu_ps(e + taps + tap));
+         __m128 a1 = _mm_add_ps(_mm_loadu_ps(e + taps + 3 - tap), _mm_loadu_ps(e + taps + 4 + tap));
+         sum0 = _mm_add_ps(sum0, _mm_mul_ps(a0, c));
+         sum1 = _mm_add_ps(sum1, _mm_mul_ps(a1, c));
+      }
+      _mm_storeu_ps(dest + index, sum0);
+      _mm_storeu_ps(dest + index + 4, sum1);
+   }
+   audioHalfband_C(dest + index, even + index, odd + index, coef, count - index);
+}
+
+// left right left right in each vector, the interpolator runs on both channels at once
+//    straight from the interleaved data, 4 frames per iteration
+static void audioStereoTruePeak_SSE(F32* sumSquares, F32* peaks, F32* truePeaks, const F32* stereo, const F32* coef, U32 count){
+   const U32 taps = AUDIO_TRUEPEAK_TAPS;
+   __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+   __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+   __m128 peak0 = _mm_setzero_ps(), peak1 = _mm_setzero_ps();
+   __m128 true0 = _mm_setzero_ps(), true1 = _mm_setzero_ps();
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      const F32* newest = stereo + (taps - 1 + index)*2;
+      __m128 a = _mm_loadu_ps(newest);
+      __m128 b = _mm_loadu_ps(newest + 4);
+      sum0 = _mm_add_ps(sum0, _mm_mul_ps(a, a));
+      sum1 = _mm_add_ps(sum1, _mm_mul_ps(b, b));
+      peak0 = _mm_max_ps(peak0, _mm_and_ps(a, absMask));
+      peak1 = _mm_max_ps(peak1, _mm_and_ps(b, absMask));
+      for(U32 phase=0; phase<4; phase++){
+         const F32* c = coef + phase*taps;
+         __m128 out0 = _mm_setzero_ps(), out1 = _mm_setzero_ps();
+         for(U32 tap=0; tap<taps; tap++){
+            __m128 weight = _mm_set1_ps(c[tap]);
+            out0 = _mm_add_ps(out0, _mm_mul_ps(weight, _mm_loadu_ps(newest - tap*2)));
+            out1 = _mm_add_ps(out1, _mm_mul_ps(weight, _mm_loadu_ps(newest + 4 - tap*2)));
+         }
+         true0 = _mm_max_ps(true0, _mm_and_ps(out0, absMask));
+         true1 = _mm_max_ps(true1, _mm_and_ps(out1, absMask));
+      }
+   }
+   F32 sums[4], maxes[4], trues[4];
+   _mm_storeu_ps(sums, _mm_add_ps(sum0, sum1));
+   _mm_storeu_ps(maxes, _mm_max_ps(peak0, peak1));
+   _mm_storeu_ps(trues, _mm_max_ps(true0, true1));
+   sumSquares[0] += sums[0] + sums[2];
+   sumSquares[1] += sums[1] + sums[3];
+   peaks[0] = getMax(peaks[0], getMax(maxes[0], maxes[2]));
+   peaks[1] = getMax(peaks[1], getMax(maxes[1], maxes[3]));
+   truePeaks[0] = getMax(truePeaks[0], getMax(trues[0], trues[2]));
+   truePeaks[1] = getMax(truePeaks[1], getMax(trues[1], trues[3]));
+   audioStereoTruePeak_C(sumSquares, peaks, truePeaks, stereo + index*2, coef, count - index);
+}
+
+// both channels in the low two lanes, the recursion cannot be vectorized over time
+static void audioStereoBiquadEnergy_SSE(F32* state, F32* sumSquares, const F32* coef, const F32* stereo, U32 count){
+   __m128 s1 = _mm_setr_ps(state[0], state[4], 0.0f, 0.0f);
+   __m128 s2 = _mm_setr_ps(state[1], state[5], 0.0f, 0.0f);
+   __m128 s3 = _mm_setr_ps(state[2], state[6], 0.0f, 0.0f);
+   __m128 s4 = _mm_setr_ps(state[3], state[7], 0.0f, 0.0f);
+   __m128 b0 = _mm_set1_ps(coef[0]), b1 = _mm_set1_ps(coef[1]), b2 = _mm_set1_ps(coef[2]);
+   __m128 a1 = _mm_set1_ps(coef[3]), a2 = _mm_set1_ps(coef[4]);
+   __m128 d0 = _mm_set1_ps(coef[5]), d1 = _mm_set1_ps(coef[6]), d2 = _mm_set1_ps(coef[7]);
+   __m128 c1 = _mm_set1_ps(coef[8]), c2 = _mm_set1_ps(coef[9]);
+   __m128 sum = _mm_setzero_ps();
+   for(U32 index=0; index<count; index++){
+      __m128 x = _mm_castpd_ps(_mm_load_sd((const double*)(stereo + index*2)));
+      __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), s1);
+      s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), s2);
+      s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+      __m128 z = _mm_add_ps(_mm_mul_ps(d0, y), s3);
+      s3 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(d1, y), _mm_mul_ps(c1, z)), s4);
+      s4 = _mm_sub_ps(_mm_mul_ps(d2, y), _mm_mul_ps(c2, z));
+      sum = _mm_add_ps(sum, _mm_mul_ps(z, z));
+   }
+   F32 values[4];
+   _mm_storeu_ps(values, s1); state[0] = values[0]; state[4] = values[1];
+   _mm_storeu_ps(values, s2); state[1] = values[0]; state[5] = values[1];
+   _mm_storeu_ps(values, s3); state[2] = values[0]; state[6] = values[1];
+   _mm_storeu_ps(values, s4); state[3] = values[0]; state[7] = values[1];
+   _mm_storeu_ps(values, sum);
+   sumSquares[0] += values[0];
+   sumSquares[1] += values[1];
+}
+
+static void audioStereoWindow_SSE(F32* left, F32* right, const F32* stereo, const F32* window, F32 gain, U32 count){
+   __m128 vgain = _mm_set1_ps(gain);
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 a = _mm_loadu_ps(stereo + index*2);
+      __m128 b = _mm_loadu_ps(stereo + index*2 + 4);
+      __m128 scale = _mm_mul_ps(_mm_loadu_ps(window + index), vgain);
+      _mm_storeu_ps(left + index, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)), scale));
+      _mm_storeu_ps(right + index, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1)), scale));
+   }
+   audioStereoWindow_C(left + index, right + index, stereo + index*2, window + index, gain, count - index);
+}
+
+// the cross term is the power spectrum of the element wise product, re*re + im*im
+static void audioCrossSpectrum_SSE(F32* powerLeft, F32* powerRight, F32* cross, const F32* left, const F32* right, U32 count){
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 la = _mm_loadu_ps(left + index*2), lb = _mm_loadu_ps(left + index*2 + 4);
+      __m128 ra = _mm_loadu_ps(right + index*2), rb = _mm_loadu_ps(right + index*2 + 4);
+      __m128 a = _mm_mul_ps(la, la), b = _mm_mul_ps(lb, lb);
+      _mm_storeu_ps(powerLeft + index, _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1))));
+      a = _mm_mul_ps(ra, ra); b = _mm_mul_ps(rb, rb);
+      _mm_storeu_ps(powerRight + index, _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1))));
+      a = _mm_mul_ps(la, ra); b = _mm_mul_ps(lb, rb);
+      _mm_storeu_ps(cross + index, _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1))));
+   }
+   audioCrossSpectrum_C(powerLeft + index, powerRight + index, cross + index, left + index*2, right + index*2, count - index);
+}
+
+// left right left right in each vector, the cross term multiplies by the pair swapped copy
+static void audioStereoProducts_SSE(F32* sums, const F32* stereo, U32 count){
+   __m128 square = _mm_setzero_ps(), product = _mm_setzero_ps();
+   U32 index = 0;
+   for(; index+2<=count; index+=2){
+      __m128 a = _mm_loadu_ps(stereo + index*2);
+      square = _mm_add_ps(square, _mm_mul_ps(a, a));
+      product = _mm_add_ps(product, _mm_mul_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1))));
+   }
+   F32 squares[4], products[4];
+   _mm_storeu_ps(squares, square);
+   _mm_storeu_ps(products, product);
+   sums[0] += squares[0] + squares[2];
+   sums[1] += squares[1] + squares[3];
+   sums[2] += products[0] + products[2];
+   audioStereoProducts_C(sums, stereo + index*2, count - index);
+}
+
+// products of b and of b with real and imaginary swapped, then the pairs are combined
+static void audioConjMultiply_SSE(F32* dest, const F32* a, const F32* b, U32 count){
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m128 a0 = _mm_loadu_ps(a + index*2), a1 = _mm_loadu_ps(a + index*2 + 4);
+      __m128 b0 = _mm_loadu_ps(b + index*2), b1 = _mm_loadu_ps(b + index*2 + 4);
+      __m128 p0 = _mm_mul_ps(a0, b0), p1 = _mm_mul_ps(a1, b1);
+      __m128 q0 = _mm_mul_ps(a0, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(2,3,0,1)));
+      __m128 q1 = _mm_mul_ps(a1, _mm_shuffle_ps(b1, b1, _MM_SHUFFLE(2,3,0,1)));
+      __m128 re = _mm_add_ps(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(3,1,3,1)));
+      __m128 im = _mm_sub_ps(_mm_shuffle_ps(q0, q1, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(q0, q1, _MM_SHUFFLE(3,1,3,1)));
+      _mm_storeu_ps(dest + index*2, _mm_unpacklo_ps(re, im));
+      _mm_storeu_ps(dest + index*2 + 4, _mm_unpackhi_ps(re, im));
+   }
+   audioConjMultiply_C(dest + index*2, a + index*2, b + index*2, count - index);
+}
+
+static const AudioKernelSet sKernelsSSE = {
+   "SSE",
+   audioMix_SSE,
+   audioMixWindow_SSE,
+   audioPowerSpectrum_SSE,
+   audioLog_SSE,
+   audioSmooth_SSE,
+   audioSmoothAttackRelease_SSE,
+   audioResonate_SSE,
+   audioHalfband_SSE,
+   audioStereoTruePeak_SSE,
+   audioStereoBiquadEnergy_SSE,
+   audioStereoWindow_SSE,
+   audioCrossSpectrum_SSE,
+   audioStereoProducts_SSE,
+   audioConjMultiply_SSE,
+};
+
+// AVX versions
+//    the cpu properties the engine detects do not include AVX, check for it here
+//    the OS also has to save the upper halves of the registers (OSXSAVE and XCR0)
+static bool audioHasAVX(){
+   U32 ecx;
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   ecx = info[2];
+#else
+   unsigned int eax, ebx, ecxr, edx;
+   if(!__get_cpuid(1, &eax, &ebx, &ecxr, &edx))
+      return false;
+   ecx = ecxr;
+#endif
+   if(!(ecx & (1 << 27)) || !(ecx & (1 << 28)))
+      return false;
+
+#if defined(_MSC_VER)
+   U64 xcr0 = _xgetbv(0);
+#else
+   U32 xlo, xhi;
+   __asm__ __volatile__("xgetbv" : "=a"(xlo), "=d"(xhi) : "c"(0));
+   U64 xcr0 = ((U64)xhi << 32) | xlo;
+#endif
+   return (xcr0 & 0x6) == 0x6;
+}
+
+AUDIO_TARGET_AVX static void audioMix_AVX(F32* dest, const F32* stereo, F32 gain, U32 count){
+   __m256 vgain = _mm256_set1_ps(gain);
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 a = _mm256_loadu_ps(stereo + index*2);
+      __m256 b = _mm256_loadu_ps(stereo + index*2 + 8);
+      __m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+      __m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+      __m256 left = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0));
+      __m256 right = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1));
+      _mm256_storeu_ps(dest + index, _mm256_mul_ps(_mm256_add_ps(left, right), vgain));
+   }
+   _mm256_zeroupper();
+   audioMix_SSE(dest + index, stereo + index*2, gain, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioMixWindow_AVX(F32* dest, const F32* stereo, const F32* window, F32 gain, U32 count){
+   __m256 vgain = _mm256_set1_ps(gain);
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 a = _mm256_loadu_ps(stereo + index*2);     // l0 r0 l1 r1 | l2 r2 l3 r3
+      __m256 b = _mm256_loadu_ps(stereo + index*2 + 8); // l4 r4 l5 r5 | l6 r6 l7 r7
+      // shuffles work within 128 bit lanes, swap the middle lanes to get 0..7 in order
+      __m256 lo = _mm256_permute2f128_ps(a, b, 0x20); // l0 r0 l1 r1 | l4 r4 l5 r5
+      __m256 hi = _mm256_permute2f128_ps(a, b, 0x31); // l2 r2 l3 r3 | l6 r6 l7 r7
+      __m256 left = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0));
+      __m256 right = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1));
+      __m256 mono = _mm256_mul_ps(_mm256_add_ps(left, right), vgain);
+      _mm256_storeu_ps(dest + index, _mm256_mul_ps(mono, _mm256_loadu_ps(window + index)));
+   }
+   _mm256_zeroupper();
+   audioMixWindow_SSE(dest + index, stereo + index*2, window + index, gain, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioPowerSpectrum_AVX(F32* dest, const F32* complex, U32 count){
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 a = _mm256_loadu_ps(complex + index*2);
+      __m256 b = _mm256_loadu_ps(complex + index*2 + 8);
+      a = _mm256_mul_ps(a, a);
+      b = _mm256_mul_ps(b, b);
+      __m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+      __m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+      __m256 re = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0));
+      __m256 im = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1));
+      _mm256_storeu_ps(dest + index, _mm256_add_ps(re, im));
+   }
+   _mm256_zeroupper();
+   audioPowerSpectrum_SSE(dest + index, complex + index*2, count - index);
+}
+
+// same method as audioLog4_SSE, AVX1 has no 256 bit integer ops so the exponent is split per lane
+AUDIO_TARGET_AVX static inline __m256 audioLog8_AVX(__m256 x){
+   x = _mm256_max_ps(x, _mm256_set1_ps(FLT_MIN));
+   __m128i bitslo = _mm_castps_si128(_mm256_castps256_ps128(x));
+   __m128i bitshi = _mm_castps_si128(_mm256_extractf128_ps(x, 1));
+   __m128i bias = _mm_set1_epi32(127);
+   __m256 e = _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(
+      _mm_sub_epi32(_mm_srli_epi32(bitslo, 23), bias)), _mm_sub_epi32(_mm_srli_epi32(bitshi, 23), bias), 1));
+   __m256 m = _mm256_or_ps(_mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x007FFFFF))),
+      _mm256_castsi256_ps(_mm256_set1_epi32(0x3F800000)));
+
+   __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+   m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+   e = _mm256_add_ps(e, _mm256_and_ps(big, _mm256_set1_ps(1.0f)));
+
+   __m256 one = _mm256_set1_ps(1.0f);
+   __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+   __m256 t2 = _mm256_mul_ps(t, t);
+   __m256 p = _mm256_add_ps(_mm256_mul_ps(t2, _mm256_set1_ps(1.0f/7.0f)), _mm256_set1_ps(1.0f/5.0f));
+   p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(1.0f/3.0f));
+   p = _mm256_add_ps(_mm256_mul_ps(p, t2), one);
+   p = _mm256_mul_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(2.0f));
+
+   return _mm256_add_ps(p, _mm256_mul_ps(e, _mm256_set1_ps(0.693147181f)));
+}
+
+AUDIO_TARGET_AVX static void audioLog_AVX(F32* dest, const F32* src, F32 scale, U32 count){
+   __m256 vscale = _mm256_set1_ps(scale);
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      _mm256_storeu_ps(dest + index, _mm256_mul_ps(audioLog8_AVX(_mm256_loadu_ps(src + index)), vscale));
+   }
+   _mm256_zeroupper();
+   audioLog_SSE(dest + index, src + index, scale, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioSmooth_AVX(F32* state, const F32* input, F32 filter, U32 count){
+   __m256 vfilter = _mm256_set1_ps(filter);
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 s = _mm256_loadu_ps(state + index);
+      __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(input + index), s);
+      _mm256_storeu_ps(state + index, _mm256_add_ps(s, _mm256_mul_ps(diff, vfilter)));
+   }
+   _mm256_zeroupper();
+   audioSmooth_SSE(state + index, input + index, filter, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioSmoothAttackRelease_AVX(F32* state, const F32* input, const F32* attack, const F32* release, U32 count){
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 s = _mm256_loadu_ps(state + index);
+      __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(input + index), s);
+      __m256 rising = _mm256_cmp_ps(diff, _mm256_setzero_ps(), _CMP_GT_OQ);
+      __m256 coef = _mm256_blendv_ps(_mm256_loadu_ps(release + index), _mm256_loadu_ps(attack + index), rising);
+      _mm256_storeu_ps(state + index, _mm256_add_ps(s, _mm256_mul_ps(diff, coef)));
+   }
+   _mm256_zeroupper();
+   audioSmoothAttackRelease_SSE(state + index, input + index, attack + index, release + index, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioResonate_AVX(F32* state, F32* energy, const F32* coef, const F32* input, U32 frames, U32 bands){
+   for(U32 band=0; band<bands; band+=8){
+      __m256 are = _mm256_loadu_ps(state + band);
+      __m256 aim = _mm256_loadu_ps(state + bands + band);
+      __m256 bre = _mm256_loadu_ps(state + bands*2 + band);
+      __m256 bim = _mm256_loadu_ps(state + bands*3 + band);
+      __m256 cr = _mm256_loadu_ps(coef + band);
+      __m256 ci = _mm256_loadu_ps(coef + bands + band);
+      __m256 sum = _mm256_setzero_ps();
+      for(U32 count=0; count<frames; count++){
+         __m256 nre = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(are, cr), _mm256_mul_ps(aim, ci)), _mm256_set1_ps(input[count]));
+         aim = _mm256_add_ps(_mm256_mul_ps(are, ci), _mm256_mul_ps(aim, cr));
+         are = nre;
+         nre = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(bre, cr), _mm256_mul_ps(bim, ci)), are);
+         bim = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(bre, ci), _mm256_mul_ps(bim, cr)), aim);
+         bre = nre;
+         sum = _mm256_add_ps(sum, _mm256_add_ps(_mm256_mul_ps(bre, bre), _mm256_mul_ps(bim, bim)));
+      }
+      _mm256_storeu_ps(state + band, are);
+      _mm256_storeu_ps(state + bands + band, aim);
+      _mm256_storeu_ps(state + bands*2 + band, bre);
+      _mm256_storeu_ps(state + bands*3 + band, bim);
+      _mm256_storeu_ps(energy + band, _mm256_add_ps(_mm256_loadu_ps(energy + band), sum));
+   }
+   _mm256_zeroupper();
+}
+
+AUDIO_TARGET_AVX static void audioHalfband_AVX(F32* dest, const F32* even, const F32* odd, const F32* coef, U32 count){
+   const U32 taps = AUDIO_HALFBAND_TAPS;
+   __m256 half = _mm256_set1_ps(0.5f);
+   U32 index = 0;
+   for(; index+16<=count; index+=16){
+      const F32* e = even + index;
+      __m256 sum0 = _mm256_mul_ps(_mm256_loadu_ps(odd + index + taps - 1), half);
+      __m256 sum1 = _mm256_mul_ps(_mm256_loadu_ps(odd + index + taps + 7), half);
+      for(U32 tap=0; tap<taps; tap++){
+         __m256 c = _mm256_set1_ps(coef[tap]);
+         __m256 a0 = _mm256_add_ps(_mm256_loadu_ps(e + taps - 1 - tap), _mm256_loadu_ps(e + taps + tap));
+         __m256 a1 = _mm256_add_ps(_mm256_loadu_ps(e + taps + 7 - tap), _mm256_loadu_ps(e + taps + 8 + tap));
+         sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(a0, c));
+         sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(a1, c));
+      }
+      _mm256_storeu_ps(dest + index, sum0);
+      _mm256_storeu_ps(dest + index + 8, sum1);
+   }
+   _mm256_zeroupper();
+   audioHalfband_SSE(dest + index, even + index, odd + index, coef, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioStereoTruePeak_AVX(F32* sumSquares, F32* peaks, F32* truePeaks, const F32* stereo, const F32* coef, U32 count){
+   const U32 taps = AUDIO_TRUEPEAK_TAPS;
+   __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+   __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+   __m256 peak0 = _mm256_setzero_ps(), peak1 = _mm256_setzero_ps();
+   __m256 true0 = _mm256_setzero_ps(), true1 = _mm256_setzero_ps();
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      const F32* newest = stereo + (taps - 1 + index)*2;
+      __m256 a = _mm256_loadu_ps(newest);
+      __m256 b = _mm256_loadu_ps(newest + 8);
+      sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(a, a));
+      sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(b, b));
+      peak0 = _mm256_max_ps(peak0, _mm256_and_ps(a, absMask));
+      peak1 = _mm256_max_ps(peak1, _mm256_and_ps(b, absMask));
+      for(U32 phase=0; phase<4; phase++){
+         const F32* c = coef + phase*taps;
+         __m256 out0 = _mm256_setzero_ps(), out1 = _mm256_setzero_ps();
+         for(U32 tap=0; tap<taps; tap++){
+            __m256 weight = _mm256_set1_ps(c[tap]);
+            out0 = _mm256_add_ps(out0, _mm256_mul_ps(weight, _mm256_loadu_ps(newest - tap*2)));
+            out1 = _mm256_add_ps(out1, _mm256_mul_ps(weight, _mm256_loadu_ps(newest + 8 - tap*2)));
+         }
+         true0 = _mm256_max_ps(true0, _mm256_and_ps(out0, absMask));
+         true1 = _mm256_max_ps(true1, _mm256_and_ps(out1, absMask));
+      }
+   }
+   F32 sums[8], maxes[8], trues[8];
+   _mm256_storeu_ps(sums, _mm256_add_ps(sum0, sum1));
+   _mm256_storeu_ps(maxes, _mm256_max_ps(peak0, peak1));
+   _mm256_storeu_ps(trues, _mm256_max_ps(true0, true1));
+   _mm256_zeroupper();
+   sumSquares[0] += (sums[0] + sums[2]) + (sums[4] + sums[6]);
+   sumSquares[1] += (sums[1] + sums[3]) + (sums[5] + sums[7]);
+   peaks[0] = getMax(peaks[0], getMax(getMax(maxes[0], maxes[2]), getMax(maxes[4], maxes[6])));
+   peaks[1] = getMax(peaks[1], getMax(getMax(maxes[1], maxes[3]), getMax(maxes[5], maxes[7])));
+   truePeaks[0] = getMax(truePeaks[0], getMax(getMax(trues[0], trues[2]), getMax(trues[4], trues[6])));
+   truePeaks[1] = getMax(truePeaks[1], getMax(getMax(trues[1], trues[3]), getMax(trues[5], trues[7])));
+   audioStereoTruePeak_SSE(sumSquares, peaks, truePeaks, stereo + index*2, coef, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioStereoWindow_AVX(F32* left, F32* right, const F32* stereo, const F32* window, F32 gain, U32 count){
+   __m256 vgain = _mm256_set1_ps(gain);
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 a = _mm256_loadu_ps(stereo + index*2);
+      __m256 b = _mm256_loadu_ps(stereo + index*2 + 8);
+      __m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+      __m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+      __m256 scale = _mm256_mul_ps(_mm256_loadu_ps(window + index), vgain);
+      _mm256_storeu_ps(left + index, _mm256_mul_ps(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0)), scale));
+      _mm256_storeu_ps(right + index, _mm256_mul_ps(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1)), scale));
+   }
+   _mm256_zeroupper();
+   audioStereoWindow_SSE(left + index, right + index, stereo + index*2, window + index, gain, count - index);
+}
+
+// re*re + im*im of a pair of interleaved complex vectors, 8 results in order
+AUDIO_TARGET_AVX static inline __m256 audioPairSum8_AVX(__m256 a, __m256 b){
+   __m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+   __m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+   return _mm256_add_ps(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0)), _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1)));
+}
+
+AUDIO_TARGET_AVX static void audioCrossSpectrum_AVX(F32* powerLeft, F32* powerRight, F32* cross, const F32* left, const F32* right, U32 count){
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 la = _mm256_loadu_ps(left + index*2), lb = _mm256_loadu_ps(left + index*2 + 8);
+      __m256 ra = _mm256_loadu_ps(right + index*2), rb = _mm256_loadu_ps(right + index*2 + 8);
+      _mm256_storeu_ps(powerLeft + index, audioPairSum8_AVX(_mm256_mul_ps(la, la), _mm256_mul_ps(lb, lb)));
+      _mm256_storeu_ps(powerRight + index, audioPairSum8_AVX(_mm256_mul_ps(ra, ra), _mm256_mul_ps(rb, rb)));
+      _mm256_storeu_ps(cross + index, audioPairSum8_AVX(_mm256_mul_ps(la, ra), _mm256_mul_ps(lb, rb)));
+   }
+   _mm256_zeroupper();
+   audioCrossSpectrum_SSE(powerLeft + index, powerRight + index, cross + index, left + index*2, right + index*2, count - index);
+}
+
+AUDIO_TARGET_AVX static void audioStereoProducts_AVX(F32* sums, const F32* stereo, U32 count){
+   __m256 square = _mm256_setzero_ps(), product = _mm256_setzero_ps();
+   U32 index = 0;
+   for(; index+4<=count; index+=4){
+      __m256 a = _mm256_loadu_ps(stereo + index*2);
+      square = _mm256_add_ps(square, _mm256_mul_ps(a, a));
+      product = _mm256_add_ps(product, _mm256_mul_ps(a, _mm256_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1))));
+   }
+   F32 squares[8], products[8];
+   _mm256_storeu_ps(squares, square);
+   _mm256_storeu_ps(products, product);
+   _mm256_zeroupper();
+   sums[0] += (squares[0] + squares[2]) + (squares[4] + squares[6]);
+   sums[1] += (squares[1] + squares[3]) + (squares[5] + squares[7]);
+   sums[2] += (products[0] + products[2]) + (products[4] + products[6]);
+   audioStereoProducts_SSE(sums, stereo + index*2, count - index);
+}
+
+// same as the SSE version, the 128 bit halves are interleaved again before the store
+AUDIO_TARGET_AVX static void audioConjMultiply_AVX(F32* dest, const F32* a, const F32* b, U32 count){
+   U32 index = 0;
+   for(; index+8<=count; index+=8){
+      __m256 a0 = _mm256_loadu_ps(a + index*2), a1 = _mm256_loadu_ps(a + index*2 + 8);
+      __m256 b0 = _mm256_loadu_ps(b + index*2), b1 = _mm256_loadu_ps(b + index*2 + 8);
+      __m256 p0 = _mm256_mul_ps(a0, b0), p1 = _mm256_mul_ps(a1, b1);
+      __m256 q0 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b0, b0, _MM_SHUFFLE(2,3,0,1)));
+      __m256 q1 = _mm256_mul_ps(a1, _mm256_shuffle_ps(b1, b1, _MM_SHUFFLE(2,3,0,1)));
+      // within each 128 bit lane: re/im of 2 values from the first vector then 2 from the second
+      __m256 re = _mm256_add_ps(_mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(2,0,2,0)), _mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(3,1,3,1)));
+      __m256 im = _mm256_sub_ps(_mm256_shuffle_ps(q0, q1, _MM_SHUFFLE(2,0,2,0)), _mm256_shuffle_ps(q0, q1, _MM_SHUFFLE(3,1,3,1)));
+      // lane 0 holds values 0 1 4 5, lane 1 holds 2 3 6 7
+      __m256 lo = _mm256_unpacklo_ps(re, im); // 0 1 | 2 3
+      __m256 hi = _mm256_unpackhi_ps(re, im); // 4 5 | 6 7
+      _mm256_storeu_ps(dest + index*2, lo);
+      _mm256_storeu_ps(dest + index*2 + 8, hi);
+   }
+   _mm256_zeroupper();
+   audioConjMultiply_SSE(dest + index*2, a + index*2, b + index*2, count - index);
+}
+
+static const AudioKernelSet sKernelsAVX = {
+   "AVX",
+   audioMix_AVX,
+   audioMixWindow_AVX,
+   audioPowerSpectrum_AVX,
+   audioLog_AVX,
+   audioSmooth_AVX,
+   audioSmoothAttackRelease_AVX,
+   audioResonate_AVX,
+   audioHalfband_AVX,
+   audioStereoTruePeak_AVX,
+   // the biquads only use two lanes, AVX has nothing to add
+   audioStereoBiquadEnergy_SSE,
+   audioStereoWindow_AVX,
+   audioCrossSpectrum_AVX,
+   audioStereoProducts_AVX,
+   audioConjMultiply_AVX,
+};
+#endif
+
+// installed kernels
+void (*audioMix)(F32* dest, const F32* stereo, F32 gain, U32 count) = audioMix_C;
+void (*audioMixWindow)(F32* dest, const F32* stereo, const F32* window, F32 gain, U32 count) = audioMixWindow_C;
+void (*audioPowerSpectrum)(F32* dest, const F32* complex, U32 count) = audioPowerSpectrum_C;
+void (*audioLog)(F32* dest, const F32* src, F32 scale, U32 count) = audioLog_C;
+void (*audioSmooth)(F32* state, const F32* input, F32 filter, U32 count) = audioSmooth_C;
+void (*audioSmoothAttackRelease)(F32* state, const F32* input, const F32* attack, const F32* release, U32 count) = audioSmoothAttackRelease_C;
+void (*audioResonate)(F32* state, F32* energy, const F32* coef, const F32* input, U32 frames, U32 bands) = audioResonate_C;
+void (*audioHalfband)(F32* dest, const F32* even, const F32* odd, const F32* coef, U32 count) = audioHalfband_C;
+void (*audioStereoTruePeak)(F32* sumSquares, F32* peaks, F32* truePeaks, const F32* stereo, const F32* coef, U32 count) = audioStereoTruePeak_C;
+void (*audioStereoBiquadEnergy)(F32* state, F32* sumSquares, const F32* coef, const F32* stereo, U32 count) = audioStereoBiquadEnergy_C;
+void (*audioStereoWindow)(F32* left, F32* right, const F32* stereo, const F32* window, F32 gain, U32 count) = audioStereoWindow_C;
+void (*audioCrossSpectrum)(F32* powerLeft, F32* powerRight, F32* cross, const F32* left, const F32* right, U32 count) = audioCrossSpectrum_C;
+void (*audioStereoProducts)(F32* sums, const F32* stereo, U32 count) = audioStereoProducts_C;
+void (*audioConjMultiply)(F32* dest, const F32* a, const F32* b, U32 count) = audioConjMultiply_C;
+
+static const AudioKernelSet* sInstalledKernels = &sKernelsC;
+
+const AudioKernelSet* getAudioKernelSet(const char* name){
+   if(!dStricmp(name, "C"))
+      return &sKernelsC;
+#ifdef AUDIO_KERNELS_X86
+   if(!dStricmp(name, "SSE") && (Platform::SystemInfo.processor.properties & CPU_PROP_SSE2))
+      return &sKernelsSSE;
+   if(!dStricmp(name, "AVX") && audioHasAVX())
+      return &sKernelsAVX;
+#endif
+   return NULL;
+}
+
+void installAudioKernels(){
+   // best first
+   static const char* sPreferred[] = { "AVX", "SSE", "C" };
+   const AudioKernelSet* set = NULL;
+   for(U32 count=0; count<sizeof(sPreferred)/sizeof(sPreferred[0]) && !set; count++){
+      set = getAudioKernelSet(sPreferred[count]);
+   }
+
+   audioMix = set->mix;
+   audioMixWindow = set->mixWindow;
+   audioPowerSpectrum = set->powerSpectrum;
+   audioLog = set->log;
+   audioSmooth = set->smooth;
+   audioSmoothAttackRelease = set->smoothAttackRelease;
+   audioResonate = set->resonate;
+   audioHalfband = set->halfband;
+   audioStereoTruePeak = set->stereoTruePeak;
+   audioStereoBiquadEnergy = set->stereoBiquadEnergy;
+   audioStereoWindow = set->stereoWindow;
+   audioCrossSpectrum = set->crossSpectrum;
+   audioStereoProducts = set->stereoProducts;
+   audioConjMultiply = set->conjMultiply;
+   sInstalledKernels = set;
+}
+
+const char* getAudioKernelSetName(){
+   return sInstalledKernels->name;
+}
+
+// benchmark
+//    runs every kernel set this processor supports over the same data
+DefineEngineFunction( benchmarkAudioKernels, const char*, (U32 points), (1 << 24),
+   "Time the spectrum kernels (power, log, smoothing) of every kernel set the processor supports "
+   "at frame sizes from 1024 to 16384 and print nanoseconds per bin.\n"
+   "The C set is the plain scalar code the SIMD sets replace.\n"
+   "@param points Number of bins to process per measurement, larger is more accurate.\n"
+   "@return Name of the installed kernel set.\n"
+   "@ingroup AudioLoopBack" )
+{
+   static const char* sSetNames[] = { "C", "SSE", "AVX" };
+   const U32 setCount = sizeof(sSetNames)/sizeof(sSetNames[0]);
+   const U32 maxBins = 16384/2 + 1;
+
+   F32* complex = (F32*)dMalloc_aligned(sizeof(F32)*maxBins*2, 32);
+   F32* power = (F32*)dMalloc_aligned(sizeof(F32)*maxBins, 32);
+   F32* logged = (F32*)dMalloc_aligned(sizeof(F32)*maxBins, 32);
+   F32* reference = (F32*)dMalloc_aligned(sizeof(F32)*maxBins, 32);
+   F32* state = (F32*)dMalloc_aligned(sizeof(F32)*maxBins, 32);
+
+   // something spectrum like, a wide range of magnitudes
+   U32 seed = 1;
+   for(U32 count=0; count<maxBins*2; count++){
+      seed = seed*1664525 + 1013904223;
+      complex[count] = (F32(seed >> 8)/F32(1 << 24) - 0.5f)*mPow(10.0f, F32(count % 12) - 6.0f);
+   }
+   dMemset(state, 0, sizeof(F32)*maxBins);
+
+   Con::printf("benchmarkAudioKernels: ns per bin, installed set is %s", getAudioKernelSetName());
+   for(U32 size=1024; size<=16384; size*=2){
+      U32 bins = size/2 + 1;
+      U32 iterations = getMax(points/bins, U32(1));
+
+      for(U32 setIndex=0; setIndex<setCount; setIndex++){
+         const AudioKernelSet* set = getAudioKernelSet(sSetNames[setIndex]);
+         if(!set)
+            continue;
+
+         U32 start = Platform::getRealMilliseconds();
+         for(U32 count=0; count<iterations; count++)
+            set->powerSpectrum(power, complex, bins);
+         U32 powerMs = Platform::getRealMilliseconds() - start;
+
+         start = Platform::getRealMilliseconds();
+         for(U32 count=0; count<iterations; count++)
+            set->log(logged, power, 1.0f, bins);
+         U32 logMs = Platform::getRealMilliseconds() - start;
+
+         start = Platform::getRealMilliseconds();
+         for(U32 count=0; count<iterations; count++)
+            set->smooth(state, logged, 0.5f, bins);
+         U32 smoothMs = Platform::getRealMilliseconds() - start;
+
+         sKernelsC.log(reference, power, 1.0f, bins);
+         F32 maxError = 0.0f;
+         for(U32 count=0; count<bins; count++)
+            maxError = getMax(maxError, mFabs(logged[count] - reference[count])/getMax(mFabs(reference[count]), 1.0f));
+
+         F32 scale = 1000000.0f/(F32(iterations)*F32(bins));
+         Con::printf("   %5d %-3s  power %.3f  log %.3f  smooth %.3f  (log error %g)", size, set->name,
+            powerMs*scale, logMs*scale, smoothMs*scale, maxError);
+      }
+   }
+
+   dFree_aligned(complex);
+   dFree_aligned(power);
+   dFree_aligned(logged);
+   dFree_aligned(reference);
+   dFree_aligned(state);
+
+   return getAudioKernelSetName();
+}
@@ -0,0 +1,108 @@
+#ifndef _AUDIO_KERNELS_H_
+#define _AUDIO_KERNELS_H_
+
+#include "platform/platform.h"
+
+/*
+Inner loops shared by the analysis objects.
+Like the engine math library these are function pointers that start out pointing at
+the C versions, installAudioKernels() swaps in SIMD versions the processor supports.
+Pointers may be unaligned unless noted, counts do not need to be a multiple of the
+vector width.  dest may be the same as the source for the element wise kernels.
+*/
+
+// mix interleaved stereo to mono and apply gain
+//    dest[n] = (stereo[2n] + stereo[2n+1]) * gain
+extern void (*audioMix)(F32* dest, const F32* stereo, F32 gain, U32 count);
+// mix interleaved stereo to mono, apply gain and a window
+//    dest[n] = (stereo[2n] + stereo[2n+1]) * gain * window[n]
+extern void (*audioMixWindow)(F32* dest, const F32* stereo, const F32* window, F32 gain, U32 count);
+// power of interleaved complex values
+//    dest[n] = complex[2n]^2 + complex[2n+1]^2
+extern void (*audioPowerSpectrum)(F32* dest, const F32* complex, U32 count);
+// natural log times scale, zero and negative inputs are treated as FLT_MIN
+//    scale 1 gives ln, AUDIO_LOG_TO_DB gives decibels of a power value
+//    the SIMD versions are approximations accurate to about 1e-6 relative
+extern void (*audioLog)(F32* dest, const F32* src, F32 scale, U32 count);
+// one pole smoothing update
+//    state[n] += filter * (input[n] - state[n])
+extern void (*audioSmooth)(F32* state, const F32* input, F32 filter, U32 count);
+// one pole smoothing with separate coefficients per value for rising and falling input
+//    state[n] += (input[n] > state[n] ? attack[n] : release[n]) * (input[n] - state[n])
+extern void (*audioSmoothAttackRelease)(F32* state, const F32* input, const F32* attack, const F32* release, U32 count);
+// bank of damped complex resonators run over a block of mono input, two in series per band
+//    a[k] = a[k]*coef[k] + input[n], b[k] = b[k]*coef[k] + a[k], energy[k] += |b[k]|^2
+//    state holds bands values each of a real, a imaginary, b real, b imaginary
+//    coef holds bands real parts followed by bands imaginary parts
+//    bands must be a multiple of AUDIO_RESONATOR_ALIGN, unused bands have a zero coef
+extern void (*audioResonate)(F32* state, F32* energy, const F32* coef, const F32* input, U32 frames, U32 bands);
+
+// band count multiple for audioResonate
+#define AUDIO_RESONATOR_ALIGN 8
+// halfband decimating filter on the two polyphase branches of the input
+//    even and odd hold the even and odd input samples, 2*AUDIO_HALFBAND_TAPS-1 samples of
+//    history first, coef holds the AUDIO_HALFBAND_TAPS nonzero taps on one side of the center
+//    dest[n] = 0.5*odd[n+T-1] + sum(coef[i]*(even[n+T-1-i] + even[n+T+i])), T = AUDIO_HALFBAND_TAPS
+extern void (*audioHalfband)(F32* dest, const F32* even, const F32* odd, const F32* coef, U32 count);
+
+#define AUDIO_HALFBAND_TAPS 16
+// sum of squares, largest magnitude and true peak (largest magnitude of the signal
+//    interpolated to 4 times the rate) of each channel of interleaved stereo, one pass
+//    stereo holds AUDIO_TRUEPEAK_TAPS-1 frames of history followed by count new frames, the
+//    levels only cover the new frames
+//    coef holds the 4 phases of the interpolation filter, AUDIO_TRUEPEAK_TAPS taps each
+//    sumSquares[c] += sum(x[2n+c]^2), peaks[c] = max(peaks[c], |x[2n+c]|), truePeaks[c] likewise
+extern void (*audioStereoTruePeak)(F32* sumSquares, F32* peaks, F32* truePeaks, const F32* stereo, const F32* coef, U32 count);
+// two biquads in series on both channels of interleaved stereo, sum of the squared output
+//    coef is b0 b1 b2 a1 a2 of each biquad, state holds 2 values per biquad per channel
+//    sumSquares[c] += sum(output[2n+c]^2)
+extern void (*audioStereoBiquadEnergy)(F32* state, F32* sumSquares, const F32* coef, const F32* stereo, U32 count);
+
+#define AUDIO_TRUEPEAK_TAPS 12
+// split interleaved stereo into left and right, apply gain and a window
+//    left[n] = stereo[2n] * gain * window[n], right[n] = stereo[2n+1] * gain * window[n]
+extern void (*audioStereoWindow)(F32* left, F32* right, const F32* stereo, const F32* window, F32 gain, U32 count);
+// power of two interleaved complex spectra and the real part of their cross spectrum
+//    powerLeft[n] = |left[n]|^2, powerRight[n] = |right[n]|^2, cross[n] = re(left[n] * conj(right[n]))
+extern void (*audioCrossSpectrum)(F32* powerLeft, F32* powerRight, F32* cross, const F32* left, const F32* right, U32 count);
+// channel products of interleaved stereo
+//    sums[0] += sum(left^2), sums[1] += sum(right^2), sums[2] += sum(left*right)
+extern void (*audioStereoProducts)(F32* sums, const F32* stereo, U32 count);
+// element wise product of interleaved complex values with the first conjugated, correlation
+//    in the frequency domain
+//    dest[n] = conj(a[n]) * b[n]
+extern void (*audioConjMultiply)(F32* dest, const F32* a, const F32* b, U32 count);
+
+// 10*log10(x) = ln(x) * AUDIO_LOG_TO_DB
+#define AUDIO_LOG_TO_DB 4.3429448f
+
+// pick the fastest kernels for this processor, safe to call more than once
+void installAudioKernels();
+// name of the installed kernel set, eg: "C", "SSE" or "AVX"
+const char* getAudioKernelSetName();
+
+// one version of every kernel
+struct AudioKernelSet
+{
+   const char* name;
+   void (*mix)(F32* dest, const F32* stereo, F32 gain, U32 count);
+   void (*mixWindow)(F32* dest, const F32* stereo, const F32* window, F32 gain, U32 count);
+   void (*powerSpectrum)(F32* dest, const F32* complex, U32 count);
+   void (*log)(F32* dest, const F32* src, F32 scale, U32 count);
+   void (*smooth)(F32* state, const F32* input, F32 filter, U32 count);
+   void (*smoothAttackRelease)(F32* state, const F32* input, const F32* attack, const F32* release, U32 count);
+   void (*resonate)(F32* state, F32* energy, const F32* coef, const F32* input, U32 frames, U32 bands);
+   void (*halfband)(F32* dest, const F32* even, const F32* odd, const F32* coef, U32 count);
+   void (*stereoTruePeak)(F32* sumSquares, F32* peaks, F32* truePeaks, const F32* stereo, const F32* coef, U32 count);
+   void (*stereoBiquadEnergy)(F32* state, F32* sumSquares, const F32* coef, const F32* stereo, U32 count);
+   void (*stereoWindow)(F32* left, F32* right, const F32* stereo, const F32* window, F32 gain, U32 count);
+   void (*crossSpectrum)(F32* powerLeft, F32* powerRight, F32* cross, const F32* left, const F32* right, U32 count);
+   void (*stereoProducts)(F32* sums, const F32* stereo, U32 count);
+   void (*conjMultiply)(F32* dest, const F32* a, const F32* b, U32 count);
+};
+
+// get a kernel set by name for benchmarks and tests
+//    returns NULL if the set is not compiled in or the processor does not support it
+const AudioKernelSet* getAudioKernelSet(const char* name);
+
+#endif // _AUDIO_KERNELS_H_
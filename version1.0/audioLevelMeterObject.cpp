@@ -0,0 +1,260 @@
+#include "audioLevelMeterObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(LevelMeterObject);
+
+F32 LevelMeterObject::smTruePeakCoef[4*AUDIO_TRUEPEAK_TAPS];
+bool LevelMeterObject::smTruePeakCoefBuilt = LevelMeterObject::buildTruePeakCoefficients();
+
+// 10*log10 of a power value with the floor for silence
+static F32 powerToDB(F64 power){
+   if(power <= 0.0)
+      return AUDIO_LEVEL_FLOOR_DB;
+   return getMax(F32(mLog(power)*AUDIO_LOG_TO_DB), AUDIO_LEVEL_FLOOR_DB);
+}
+
+bool LevelMeterObject::buildTruePeakCoefficients(){
+   // 48 tap windowed sinc low pass at the original nyquist with a gain of 4, split
+   //    into the 4 phases of the interpolator
+   const U32 length = 4*AUDIO_TRUEPEAK_TAPS;
+   const F64 center = (length - 1)*0.5;
+   for(U32 count=0; count<length; count++){
+      F64 x = (count - center)*0.25;
+      F64 phase = M_2PI*count/(length - 1);
+      F64 window = 0.42 - 0.5*mCos(phase) + 0.08*mCos(2.0*phase);
+      smTruePeakCoef[(count % 4)*AUDIO_TRUEPEAK_TAPS + count/4] = F32(mSin(M_PI*x)/(M_PI*x)*window);
+   }
+   return true;
+}
+
+LevelMeterObject::LevelMeterObject(){
+   objectFilterRate = 0;
+   for(U32 channel=0; channel<AUDIO_NUM_CHANNELS; channel++){
+      objectRMS[channel] = AUDIO_LEVEL_FLOOR_DB;
+      objectPeak[channel] = AUDIO_LEVEL_FLOOR_DB;
+      objectTruePeak[channel] = AUDIO_LEVEL_FLOOR_DB;
+   }
+   objectMomentary = AUDIO_LEVEL_FLOOR_DB;
+   objectShortTerm = AUDIO_LEVEL_FLOOR_DB;
+}
+LevelMeterObject::~LevelMeterObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+}
+
+void LevelMeterObject::setupFilters(){
+   F64 rate = objectSamplesPerSecond;
+
+   // BS.1770 K-weighting for any sample rate, the same filters as the 48 kHz coefficients
+   //    in the standard (stage 1 high shelf, stage 2 high pass)
+   F64 f0 = 1681.974450955533;
+   F64 gain = 3.999843853973347;
+   F64 q = 0.7071752369554196;
+   F64 k = mTan(M_PI*f0/rate);
+   F64 vh = mPow(10.0, gain/20.0);
+   F64 vb = mPow(vh, 0.4996667741545416);
+   F64 a0 = 1.0 + k/q + k*k;
+   objectKWeightCoef[0] = F32((vh + vb*k/q + k*k)/a0);
+   objectKWeightCoef[1] = F32(2.0*(k*k - vh)/a0);
+   objectKWeightCoef[2] = F32((vh - vb*k/q + k*k)/a0);
+   objectKWeightCoef[3] = F32(2.0*(k*k - 1.0)/a0);
+   objectKWeightCoef[4] = F32((1.0 - k/q + k*k)/a0);
+
+   f0 = 38.13547087602444;
+   q = 0.5003270373238773;
+   k = mTan(M_PI*f0/rate);
+   a0 = 1.0 + k/q + k*k;
+   objectKWeightCoef[5] = 1.0f;
+   objectKWeightCoef[6] = -2.0f;
+   objectKWeightCoef[7] = 1.0f;
+   objectKWeightCoef[8] = F32(2.0*(k*k - 1.0)/a0);
+   objectKWeightCoef[9] = F32((1.0 - k/q + k*k)/a0);
+
+   dMemset(objectKWeightState, 0, sizeof(objectKWeightState));
+   dMemset(objectTruePeakFrames, 0, sizeof(objectTruePeakFrames));
+
+   dMemset(objectSliceEnergy, 0, sizeof(objectSliceEnergy));
+   objectSliceCount = 0;
+   objectCurrentEnergy = 0.0;
+   objectCurrentFrames = 0;
+   objectSliceFrames = getMax(objectSamplesPerSecond*AUDIO_LEVEL_SLICE_MS/1000, U32(1));
+
+   objectFilterRate = objectSamplesPerSecond;
+}
+
+F32 LevelMeterObject::getLoudness(U32 slices){
+   // until there is enough audio use what there is
+   slices = getMin(slices, objectSliceCount);
+   if(!slices)
+      return AUDIO_LEVEL_FLOOR_DB;
+
+   F64 energy = 0.0;
+   for(U32 count=0; count<slices; count++)
+      energy += objectSliceEnergy[(objectSliceCount - 1 - count) % AUDIO_LEVEL_SHORT_TERM_SLICES];
+
+   // channel weights are 1 for left and right
+   F64 meanSquare = energy/(F64(slices)*objectSliceFrames);
+   if(meanSquare <= 0.0)
+      return AUDIO_LEVEL_FLOOR_DB;
+   return getMax(-0.691f + powerToDB(meanSquare), AUDIO_LEVEL_FLOOR_DB);
+}
+
+void LevelMeterObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+
+   const F32* samples = getSampleData();
+   U32 samplesize = objectSampleBufferSamples;
+   if(!samples || !samplesize)
+      return;
+
+   if(objectSamplesPerSecond != objectFilterRate)
+      setupFilters();
+
+   // rms, sample peak and true peak of both channels in one pass over the interleaved block
+   //    the first frames need the previous block as filter history so they go through
+   //    objectTruePeakFrames, the rest is read in place
+   const U32 history = AUDIO_TRUEPEAK_TAPS - 1;
+   const U32 head = getMin(samplesize, history);
+   F32 sumSquares[AUDIO_NUM_CHANNELS] = { 0.0f, 0.0f };
+   F32 peaks[AUDIO_NUM_CHANNELS] = { 0.0f, 0.0f };
+   F32 truePeaks[AUDIO_NUM_CHANNELS] = { 0.0f, 0.0f };
+   dMemcpy(objectTruePeakFrames + history*AUDIO_NUM_CHANNELS, samples, sizeof(F32)*head*AUDIO_NUM_CHANNELS);
+   audioStereoTruePeak(sumSquares, peaks, truePeaks, objectTruePeakFrames, smTruePeakCoef, head);
+   if(samplesize > head)
+      audioStereoTruePeak(sumSquares, peaks, truePeaks, samples, smTruePeakCoef, samplesize - head);
+
+   // keep the last frames as history for the next block
+   if(samplesize >= history)
+      dMemcpy(objectTruePeakFrames, samples + (samplesize - history)*AUDIO_NUM_CHANNELS, sizeof(F32)*history*AUDIO_NUM_CHANNELS);
+   else
+      dMemmove(objectTruePeakFrames, objectTruePeakFrames + head*AUDIO_NUM_CHANNELS, sizeof(F32)*history*AUDIO_NUM_CHANNELS);
+
+   for(U32 channel=0; channel<AUDIO_NUM_CHANNELS; channel++){
+      F32 truePeak = getMax(truePeaks[channel], peaks[channel]);
+      objectRMS[channel] = powerToDB(sumSquares[channel]/samplesize);
+      objectPeak[channel] = powerToDB(peaks[channel]*peaks[channel]);
+      objectTruePeak[channel] = powerToDB(truePeak*truePeak);
+   }
+
+   // K-weighted energy, cut at the slice boundaries
+   U32 offset = 0;
+   while(offset < samplesize){
+      U32 frames = getMin(objectSliceFrames - objectCurrentFrames, samplesize - offset);
+      F32 energy[AUDIO_NUM_CHANNELS] = { 0.0f, 0.0f };
+      audioStereoBiquadEnergy(objectKWeightState, energy, objectKWeightCoef, samples + offset*AUDIO_NUM_CHANNELS, frames);
+      objectCurrentEnergy += F64(energy[0]) + F64(energy[1]);
+      objectCurrentFrames += frames;
+      offset += frames;
+
+      if(objectCurrentFrames == objectSliceFrames){
+         objectSliceEnergy[objectSliceCount % AUDIO_LEVEL_SHORT_TERM_SLICES] = objectCurrentEnergy;
+         objectSliceCount++;
+         objectCurrentEnergy = 0.0;
+         objectCurrentFrames = 0;
+      }
+   }
+
+   // filters left ringing on silence decay into denormals
+   for(U32 count=0; count<8; count++){
+      if(mFabs(objectKWeightState[count]) < 1e-15f)
+         objectKWeightState[count] = 0.0f;
+   }
+
+   objectMomentary = getLoudness(AUDIO_LEVEL_MOMENTARY_SLICES);
+   objectShortTerm = getLoudness(AUDIO_LEVEL_SHORT_TERM_SLICES);
+}
+
+F32 LevelMeterObject::getRMS(U32 channel){
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+   return objectRMS[getMin(channel, U32(AUDIO_NUM_CHANNELS-1))];
+}
+F32 LevelMeterObject::getPeak(U32 channel){
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+   return objectPeak[getMin(channel, U32(AUDIO_NUM_CHANNELS-1))];
+}
+F32 LevelMeterObject::getTruePeak(U32 channel){
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+   return objectTruePeak[getMin(channel, U32(AUDIO_NUM_CHANNELS-1))];
+}
+F32 LevelMeterObject::getMomentaryLoudness(){
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+   return objectMomentary;
+}
+F32 LevelMeterObject::getShortTermLoudness(){
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+   return objectShortTerm;
+}
+
+U32 LevelMeterObject::getProcessedOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectLevelDataMutex, true );
+
+   retoutput.clear();
+   for(U32 channel=0; channel<AUDIO_NUM_CHANNELS; channel++)
+      retoutput.push_back(objectRMS[channel]);
+   for(U32 channel=0; channel<AUDIO_NUM_CHANNELS; channel++)
+      retoutput.push_back(objectPeak[channel]);
+   for(U32 channel=0; channel<AUDIO_NUM_CHANNELS; channel++)
+      retoutput.push_back(objectTruePeak[channel]);
+   retoutput.push_back(objectMomentary);
+   retoutput.push_back(objectShortTerm);
+   mutex.unlock();
+
+   return getDataChanged();
+}
+
+// console
+DefineEngineMethod(LevelMeterObject, getRMS, F32, (U32 channel), (0),
+   "Get the RMS level of the last block.\n"
+   "@param channel 0 for left, 1 for right.\n"
+   "@return Level in dBFS, -120 for silence.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getRMS(channel);
+}
+
+DefineEngineMethod(LevelMeterObject, getPeak, F32, (U32 channel), (0),
+   "Get the largest sample of the last block.\n"
+   "@param channel 0 for left, 1 for right.\n"
+   "@return Level in dBFS, -120 for silence.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getPeak(channel);
+}
+
+DefineEngineMethod(LevelMeterObject, getTruePeak, F32, (U32 channel), (0),
+   "Get the true peak of the last block, the signal is interpolated to 4 times the rate to find "
+   "peaks between samples.\n"
+   "@param channel 0 for left, 1 for right.\n"
+   "@return Level in dBFS (dBTP), can be above 0.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getTruePeak(channel);
+}
+
+DefineEngineMethod(LevelMeterObject, getMomentaryLoudness, F32, (),,
+   "Get the EBU R128 momentary loudness, the last 400 mS.\n"
+   "@param Nothing.\n"
+   "@return Loudness in LUFS.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getMomentaryLoudness();
+}
+
+DefineEngineMethod(LevelMeterObject, getShortTermLoudness, F32, (),,
+   "Get the EBU R128 short term loudness, the last 3 seconds.\n"
+   "@param Nothing.\n"
+   "@return Loudness in LUFS.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getShortTermLoudness();
+}
@@ -0,0 +1,84 @@
+#ifndef _AUDIO_LEVEL_METER_OBJECT_H_
+#define _AUDIO_LEVEL_METER_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Level and loudness metering without an FFT.
+Per channel RMS and sample peak of every block, true peak from the signal interpolated to
+4 times the rate (catches the peaks between samples that clip after conversion), and
+EBU R128 / ITU BS.1770 loudness: K-weighted (a high shelf and a high pass that roughly
+follow the ear) mean square over the last 400 mS (momentary) and 3 S (short term).
+
+Levels are in dBFS, loudness in LUFS.  The loudness uses 100 mS slices so it updates
+every 100 mS whatever the capture block size is.
+*/
+
+// value reported for silence
+#define AUDIO_LEVEL_FLOOR_DB -120.0f
+#define AUDIO_LEVEL_SLICE_MS 100
+#define AUDIO_LEVEL_MOMENTARY_SLICES 4
+#define AUDIO_LEVEL_SHORT_TERM_SLICES 30
+
+class LevelMeterObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect level data
+   Mutex objectLevelDataMutex;
+
+   // filters are set up for objectFilterRate
+   U32 objectFilterRate;
+   F32 objectKWeightCoef[10];
+   F32 objectKWeightState[8];
+   // interleaved history for the true peak interpolation, the first AUDIO_TRUEPEAK_TAPS-1
+   //    frames carry over between blocks, the rest holds the start of the next block
+   F32 objectTruePeakFrames[2*(AUDIO_TRUEPEAK_TAPS - 1)*AUDIO_NUM_CHANNELS];
+
+   // K-weighted energy of both channels for each finished slice, a ring
+   F64 objectSliceEnergy[AUDIO_LEVEL_SHORT_TERM_SLICES];
+   U32 objectSliceCount;
+   // slice being filled
+   F64 objectCurrentEnergy;
+   U32 objectCurrentFrames;
+   U32 objectSliceFrames;
+
+   // results
+   F32 objectRMS[AUDIO_NUM_CHANNELS];
+   F32 objectPeak[AUDIO_NUM_CHANNELS];
+   F32 objectTruePeak[AUDIO_NUM_CHANNELS];
+   F32 objectMomentary;
+   F32 objectShortTerm;
+
+   // interpolation filter shared by every meter, built during static initialization
+   static F32 smTruePeakCoef[4*AUDIO_TRUEPEAK_TAPS];
+   static bool smTruePeakCoefBuilt;
+   static bool buildTruePeakCoefficients();
+
+   // objectLevelDataMutex must be held
+   void setupFilters();
+   F32 getLoudness(U32 slices);
+
+public:
+   LevelMeterObject();
+   virtual ~LevelMeterObject();
+
+   virtual void process_unique();
+
+   // dBFS of the last block, channel 0 is left
+   F32 getRMS(U32 channel);
+   F32 getPeak(U32 channel);
+   F32 getTruePeak(U32 channel);
+   // LUFS
+   F32 getMomentaryLoudness();
+   F32 getShortTermLoudness();
+
+   // rms left, rms right, peak left, peak right, true peak left, true peak right,
+   //    momentary, short term
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput);
+
+   DECLARE_CONOBJECT(LevelMeterObject);
+};
+
+#endif // _AUDIO_LEVEL_METER_OBJECT_H_
@@ -0,0 +1,318 @@
+#include "audioMelObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(MelObject);
+
+// HTK mel scale
+static F32 freqToMel(F32 freq){
+   return 2595.0f*mLog10(1.0f + freq/700.0f);
+}
+static F32 melToFreq(F32 mel){
+   return 700.0f*(mPow(10.0f, mel/2595.0f) - 1.0f);
+}
+
+MelObject::MelObject(){
+   // same framing as FFTObject so the spectrum is shared by default
+   objectFrameSize = AUDIO_FFT_FRAME_SIZE;
+   objectHopSize = U32(AUDIO_FFT_FRAME_SIZE*(1.0f - AUDIO_FFT_OVERLAP));
+   objectWindowType = AUDIO_FFT_WINDOW;
+   objectSpectrum = NULL;
+
+   objectBandCount = AUDIO_MEL_BANDS;
+   objectMinFreq = AUDIO_MEL_MIN_FREQ;
+   objectMaxFreq = AUDIO_MEL_MAX_FREQ;
+   objectRequestedCoeffCount = AUDIO_MEL_COEFFS;
+   objectCoeffCount = getMin(objectRequestedCoeffCount, objectBandCount);
+
+   objectFilterDirty = true;
+   objectFilterRate = 0;
+   objectSmoothing = AUDIO_FFT_SMOOTHING;
+
+   AudioMelOutput.setSize(objectBandCount);
+   AudioMelOutput.fill(0.0f);
+   AudioMFCCOutput.setSize(objectCoeffCount);
+   AudioMFCCOutput.fill(0.0f);
+}
+MelObject::~MelObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+}
+
+void MelObject::setFrameSize(U32 size, F32 overlap){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   objectFrameSize = AudioFramer::roundFrameSize(size);
+   objectHopSize = getMax(U32(objectFrameSize*(1.0f - mClampF(overlap, 0.0f, 0.9f))), U32(1));
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+   objectSpectrum = NULL;
+   objectFilterDirty = true;
+}
+
+void MelObject::setWindowType(AudioWindow::WindowType type){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   objectWindowType = type;
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
+   objectSpectrum = NULL;
+}
+
+void MelObject::setMelBands(U32 count, F32 minFreq, F32 maxFreq){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   objectBandCount = mClamp(count, 1, AUDIO_MEL_MAX_BANDS);
+   objectMinFreq = getMax(minFreq, 0.0f);
+   objectMaxFreq = getMax(maxFreq, objectMinFreq + 1.0f);
+   objectFilterDirty = true;
+
+   AudioMelOutput.setSize(objectBandCount);
+   AudioMelOutput.fill(0.0f);
+   AudioMFCCOutput.setSize(getMin(objectRequestedCoeffCount, objectBandCount));
+   AudioMFCCOutput.fill(0.0f);
+}
+
+void MelObject::setCoefficients(U32 count){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   objectRequestedCoeffCount = count;
+   objectFilterDirty = true;
+
+   AudioMFCCOutput.setSize(getMin(objectRequestedCoeffCount, objectBandCount));
+   AudioMFCCOutput.fill(0.0f);
+}
+
+void MelObject::buildFilters(){
+   U32 bins = objectFrameSize/2 + 1;
+   F32 binHz = (F32)objectSamplesPerSecond/objectFrameSize;
+   F32 maxFreq = getMin(objectMaxFreq, objectSamplesPerSecond*0.5f);
+   F32 minMel = freqToMel(getMin(objectMinFreq, maxFreq - 1.0f));
+   F32 melStep = (freqToMel(maxFreq) - minMel)/(objectBandCount + 1);
+
+   objectFilterStart.setSize(objectBandCount);
+   objectFilterLength.setSize(objectBandCount);
+   objectFilterOffset.setSize(objectBandCount);
+   objectCenterFreqs.setSize(objectBandCount);
+   objectFilterWeights.clear();
+
+   // triangles from the center of the band below to the center of the band above, the
+   //    weights of each band sum to 1 so the output is the mean power whatever the width
+   for(U32 band=0; band<objectBandCount; band++){
+      F32 lower = melToFreq(minMel + melStep*band);
+      F32 center = melToFreq(minMel + melStep*(band + 1));
+      F32 upper = melToFreq(minMel + melStep*(band + 2));
+      objectCenterFreqs[band] = center;
+
+      U32 first = U32(mCeil(lower/binHz));
+      U32 end = getMin(U32(mFloor(upper/binHz)) + 1, bins);
+      U32 offset = objectFilterWeights.size();
+      F32 total = 0.0f;
+      for(U32 bin=first; bin<end; bin++){
+         F32 freq = bin*binHz;
+         F32 weight = freq <= center ? (freq - lower)/getMax(center - lower, 1e-3f) : (upper - freq)/getMax(upper - center, 1e-3f);
+         weight = getMax(weight, 0.0f);
+         objectFilterWeights.push_back(weight);
+         total += weight;
+      }
+      if(total <= 0.0f){
+         // narrower than a bin, use the nearest one
+         objectFilterWeights.setSize(offset);
+         first = getMin(U32(center/binHz + 0.5f), bins - 1);
+         end = first + 1;
+         objectFilterWeights.push_back(1.0f);
+         total = 1.0f;
+      }
+      for(U32 count=offset; count<objectFilterWeights.size(); count++)
+         objectFilterWeights[count] /= total;
+
+      objectFilterStart[band] = first;
+      objectFilterLength[band] = objectFilterWeights.size() - offset;
+      objectFilterOffset[band] = offset;
+   }
+
+   // orthonormal DCT-II, computed once per band and coefficient count
+   objectCoeffCount = getMin(objectRequestedCoeffCount, objectBandCount);
+   objectDCT.setSize(objectCoeffCount*objectBandCount);
+   for(U32 coeff=0; coeff<objectCoeffCount; coeff++){
+      F32 scale = mSqrt((coeff ? 2.0f : 1.0f)/objectBandCount);
+      for(U32 band=0; band<objectBandCount; band++)
+         objectDCT[coeff*objectBandCount + band] = scale*mCos(M_PI_F*coeff*(band + 0.5f)/objectBandCount);
+   }
+
+   objectBandBuffer.setSize(objectBandCount);
+   objectSmoothing = getHopSmoothing(AUDIO_FFT_SMOOTHING, objectHopSize, objectSamplesPerSecond);
+   objectFilterRate = objectSamplesPerSecond;
+   objectFilterDirty = false;
+}
+
+void MelObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   if(!getSampleData() || !objectSampleBufferSamples)
+      return;
+
+   if(objectFilterDirty || objectFilterRate != objectSamplesPerSecond)
+      buildFilters();
+   if(!objectSpectrum)
+      objectSpectrum = AudioSharedSpectrum::find(objectFrameSize, objectHopSize, objectWindowType);
+
+   // the FFT is shared, only the filterbank runs here
+   U32 frames;
+   const F32* power = objectSpectrum->lock(objectSampleBlock, frames);
+   for(U32 count=0; count<frames; count++){
+      processSpectrum(power + count*objectSpectrum->getBins());
+   }
+   objectSpectrum->unlock();
+}
+
+void MelObject::processSpectrum(const F32* power){
+   // sparse filterbank
+   F32* bandBuffer = objectBandBuffer.address();
+   const F32* weights = objectFilterWeights.address();
+   for(U32 band=0; band<objectBandCount; band++){
+      const F32* src = power + objectFilterStart[band];
+      const F32* w = weights + objectFilterOffset[band];
+      F32 sum = 0.0f;
+      for(U32 count=0; count<objectFilterLength[band]; count++)
+         sum += src[count]*w[count];
+      bandBuffer[band] = sum;
+   }
+
+   audioLog(bandBuffer, bandBuffer, 1.0f, objectBandCount);
+   audioSmooth(AudioMelOutput.address(), bandBuffer, objectSmoothing, objectBandCount);
+
+   // MFCCs of the smoothed log energies
+   const F32* mel = AudioMelOutput.address();
+   for(U32 coeff=0; coeff<objectCoeffCount; coeff++){
+      const F32* basis = objectDCT.address() + coeff*objectBandCount;
+      F32 sum = 0.0f;
+      for(U32 band=0; band<objectBandCount; band++)
+         sum += basis[band]*mel[band];
+      AudioMFCCOutput[coeff] = sum;
+   }
+}
+
+void MelObject::getBandFrequencies(Vector<F32>& retfreqs){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   retfreqs.clear();
+   if(!objectFilterDirty)
+      retfreqs.merge(objectCenterFreqs);
+}
+void MelObject::getMelOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioMelOutput);
+}
+void MelObject::getMFCCOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioMFCCOutput);
+}
+
+U32 MelObject::getProcessedOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectMelDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioMelOutput);
+   retoutput.merge(AudioMFCCOutput);
+   mutex.unlock();
+
+   return getDataChanged();
+}
+
+// console
+DefineEngineMethod(MelObject, setFrameSize, void, (U32 size, F32 overlap), (AUDIO_FFT_FRAME_SIZE, AUDIO_FFT_OVERLAP),
+   "Set the FFT frame size and overlap, same as FFTObject.  Objects with the same frame size, "
+   "overlap and window share one FFT.\n"
+   "@param size Frame size in samples, rounded up to a power of 2 (64 to 32768).\n"
+   "@param overlap Fraction of each frame shared with the next (0 to 0.9).\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setFrameSize(size, overlap);
+}
+
+DefineEngineMethod(MelObject, setWindow, void, (const char* window), ("hann"),
+   "Set the window applied to each FFT frame, same as FFTObject.\n"
+   "@param window \"hann\" (default), \"hamming\", \"blackmanharris\" or \"flattop\".\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   AudioWindow::WindowType type = AudioWindow::getTypeFromName(window);
+   if(type == AudioWindow::WindowTypeCount){
+      Con::warnf("MelObject::setWindow - unknown window: %s", window);
+      return;
+   }
+   object->setWindowType(type);
+}
+
+DefineEngineMethod(MelObject, setMelBands, void, (U32 count, F32 minFreq, F32 maxFreq), (AUDIO_MEL_BANDS, AUDIO_MEL_MIN_FREQ, AUDIO_MEL_MAX_FREQ),
+   "Set the number of mel bands and the range they cover.\n"
+   "@param count Number of bands (1 to 128).\n"
+   "@param minFreq Lower edge of the first band in Hz.\n"
+   "@param maxFreq Upper edge of the last band in Hz, limited to half the sample rate.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setMelBands(count, minFreq, maxFreq);
+}
+
+DefineEngineMethod(MelObject, setCoefficients, void, (U32 count), (AUDIO_MEL_COEFFS),
+   "Set the number of MFCCs computed from the mel bands.\n"
+   "@param count Number of coefficients, 0 turns them off, limited to the band count.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setCoefficients(count);
+}
+
+DefineEngineMethod(MelObject, getBandFrequencies, const char*, (),,
+   "Get the center frequency of each mel band.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of frequencies in Hz, empty until audio has been processed.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpfreqs;
+   object->getBandFrequencies(tmpfreqs);
+
+   return formatAudioFloatList(tmpfreqs, "%.1f");
+}
+
+DefineEngineMethod(MelObject, getMelOutput, const char*, (),,
+   "Get the log energy of each mel band.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats, natural log of the mean power in the band.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getMelOutput(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+DefineEngineMethod(MelObject, getMFCCOutput, const char*, (),,
+   "Get the mel frequency cepstral coefficients.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats, the first is the overall level.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getMFCCOutput(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
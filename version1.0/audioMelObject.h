@@ -0,0 +1,96 @@
+#ifndef _AUDIO_MEL_OBJECT_H_
+#define _AUDIO_MEL_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Timbral features: log mel band energies and MFCCs (mel frequency cepstral coefficients).
+The mel bands are triangles spaced evenly on the mel scale, narrow in the bass and wide in
+the treble like the ear, applied as a sparse filterbank to the power spectrum.  The MFCCs
+are a DCT of the log mel energies, the first few describe the overall shape of the
+spectrum (brightness, tilt) independent of the notes being played.
+
+The power spectrum comes from the AudioSharedSpectrum, with the same frame size, overlap
+and window as an FFTObject the two share one FFT and the mel bands only cost the
+filterbank.  The defaults match FFTObject.
+*/
+
+#define AUDIO_MEL_BANDS 40
+#define AUDIO_MEL_MAX_BANDS 128
+#define AUDIO_MEL_MIN_FREQ 30.0f
+#define AUDIO_MEL_MAX_FREQ 16000.0f
+// number of MFCCs, 0 turns them off
+#define AUDIO_MEL_COEFFS 13
+
+class MelObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect mel data
+   Mutex objectMelDataMutex;
+
+   U32 objectFrameSize;
+   U32 objectHopSize;
+   AudioWindow::WindowType objectWindowType;
+   // looked up again when NULL
+   AudioSharedSpectrum* objectSpectrum;
+
+   U32 objectBandCount;
+   F32 objectMinFreq;
+   F32 objectMaxFreq;
+   // count asked for by setCoefficients, kept across band changes
+   U32 objectRequestedCoeffCount;
+   // count in use, the request limited to objectBandCount by buildFilters
+   U32 objectCoeffCount;
+
+   // filterbank and smoothing are set up for objectFilterRate, rebuilt when dirty
+   bool objectFilterDirty;
+   U32 objectFilterRate;
+   F32 objectSmoothing;
+   // band n has objectFilterLength[n] weights starting at bin objectFilterStart[n],
+   //    the weights are at objectFilterOffset[n] in objectFilterWeights
+   Vector<U32> objectFilterStart;
+   Vector<U32> objectFilterLength;
+   Vector<U32> objectFilterOffset;
+   Vector<F32> objectFilterWeights;
+   Vector<F32> objectCenterFreqs;
+   // DCT-II basis, objectCoeffCount rows of objectBandCount values
+   Vector<F32> objectDCT;
+
+   Vector<F32> objectBandBuffer;
+   Vector<F32> AudioMelOutput;
+   Vector<F32> AudioMFCCOutput;
+
+   // objectMelDataMutex must be held
+   void buildFilters();
+   void processSpectrum(const F32* power);
+
+public:
+   MelObject();
+   virtual ~MelObject();
+
+   virtual void process_unique();
+
+   // same as FFTObject
+   void setFrameSize(U32 size, F32 overlap);
+   void setWindowType(AudioWindow::WindowType type);
+   // number of mel bands and the range they cover in Hz
+   void setMelBands(U32 count, F32 minFreq, F32 maxFreq);
+   // number of MFCCs, limited to the band count while there are fewer bands, the request
+   //    itself is kept so raising the band count again brings the coefficients back
+   void setCoefficients(U32 count);
+
+   // center frequency of each band, empty until the first block has been processed
+   void getBandFrequencies(Vector<F32>& retfreqs);
+   // natural log of the mean power in each band, smoothed
+   void getMelOutput(Vector<F32>& retoutput);
+   void getMFCCOutput(Vector<F32>& retoutput);
+
+   // mel output followed by the MFCCs
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput);
+
+   DECLARE_CONOBJECT(MelObject);
+};
+
+#endif // _AUDIO_MEL_OBJECT_H_
@@ -0,0 +1,270 @@
+#include "audioMultiResFFTObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(MultiResFFTObject);
+
+MultiResFFTObject::MultiResFFTObject(){
+   // same defaults as FFTObject
+   U32 freq = 30;
+   for(U32 count=0; count < 9; count++){
+      AudioFreqBands.push_back(freq);
+      freq *= 2;
+   }
+   AudioFreqOutput.setSize(AudioFreqBands.size());
+   AudioFreqOutput.fill(0.0f);
+
+   objectStageCount = AUDIO_MULTIRES_STAGES;
+   objectStageSize = AUDIO_MULTIRES_SIZE;
+   objectStagesDirty = true;
+   objectStagesRate = 0;
+
+   objectMono = AudioMonoNode::find();
+}
+MultiResFFTObject::~MultiResFFTObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectMultiResDataMutex, true );
+
+   AudioAnalysisGraph::releaseNode(objectMono);
+}
+
+void MultiResFFTObject::setStages(U32 count, U32 size){
+   MutexHandle mutex;
+   mutex.lock( &objectMultiResDataMutex, true );
+
+   objectStageCount = mClamp(count, 1, AUDIO_MULTIRES_MAX_STAGES);
+   objectStageSize = AudioFramer::roundFrameSize(size);
+   objectStagesDirty = true;
+}
+
+void MultiResFFTObject::getBandStages(Vector<U32>& retstages){
+   MutexHandle mutex;
+   mutex.lock( &objectMultiResDataMutex, true );
+
+   retstages.clear();
+   if(objectStagesDirty)
+      return;
+   retstages.setSize(AudioFreqBands.size());
+   for(U32 stage=0; stage<objectStageCount; stage++){
+      for(U32 count=0; count<objectStages[stage].bandCount; count++)
+         retstages[objectStages[stage].firstBand + count] = stage;
+   }
+}
+
+void MultiResFFTObject::setAudioFreqBands(Vector<U32>& bands){
+   MutexHandle mutex;
+   mutex.lock( &objectMultiResDataMutex, true );
+
+   AudioFreqBands.clear();
+   AudioFreqBands.merge(bands);
+   objectStagesDirty = true;
+   U32 outsize = AudioFreqOutput.size();
+   AudioFreqOutput.setSize(AudioFreqBands.size());
+   for(U32 count=outsize; count<AudioFreqOutput.size(); count++){
+      AudioFreqOutput[count] = 0.0f;
+   }
+}
+
+void MultiResFFTObject::getAudioFreqBands(Vector<U32>& retbands){
+   MutexHandle mutex;
+   mutex.lock( &objectMultiResDataMutex, true );
+
+   retbands.clear();
+   retbands.merge(AudioFreqBands);
+}
+
+void MultiResFFTObject::getAudioFreqOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectMultiResDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioFreqOutput);
+}
+
+void MultiResFFTObject::buildStages(){
+   U32 bands = AudioFreqBands.size();
+   U32 size = objectStageSize;
+   U32 hop = getMax(U32(size*(1.0f - AUDIO_FFT_OVERLAP)), U32(1));
+   objectBandBuffer.setSize(bands);
+
+   // bands are sorted low to high so each stage gets a contiguous run, starting from the
+   //    lowest rate stage, the full rate stage takes everything the others cannot pass
+   U32 next = 0;
+   if(objectStageCount > 1)
+      objectChain.setup(objectStageCount - 1);
+   for(S32 stageIndex=objectStageCount-1; stageIndex>=0; stageIndex--){
+      Stage& stage = objectStages[stageIndex];
+      stage.rate = objectSamplesPerSecond >> stageIndex;
+      stage.framer.setup(size, hop);
+      stage.smoothing = getHopSmoothing(AUDIO_FFT_SMOOTHING, hop, stage.rate);
+
+      F32 limit = stage.rate*AUDIO_DECIMATOR_PASSBAND;
+      U32 first = next;
+      while(next < bands){
+         // upper edge is the midpoint to the next band, same as FFTObject
+         F32 upper = next != bands-1 ? (AudioFreqBands[next] + AudioFreqBands[next+1])*0.5f : AudioFreqBands[next]*1.5f;
+         if(stageIndex && upper > limit)
+            break;
+         next++;
+      }
+      stage.firstBand = first;
+      stage.bandCount = next - first;
+
+      // bins whose frequency falls inside the band edges, narrow bands get the nearest bin
+      F32 binHz = (F32)stage.rate/size;
+      stage.firstBin.setSize(stage.bandCount);
+      stage.endBin.setSize(stage.bandCount);
+      for(U32 count=0; count<stage.bandCount; count++){
+         U32 index = first + count;
+         F32 freq = (F32)AudioFreqBands[index];
+         F32 lower = index ? (AudioFreqBands[index-1] + freq)*0.5f : 0.0f;
+         F32 upper = index != bands-1 ? (freq + AudioFreqBands[index+1])*0.5f : freq*1.5f;
+         U32 firstBin = index ? U32(mFloor(lower/binHz)) + 1 : 0;
+         U32 endBin = getMin(U32(mFloor(upper/binHz)) + 1, size/2);
+         if(firstBin >= endBin && freq < stage.rate*0.5f){
+            firstBin = getMin(U32(freq/binHz + 0.5f), size/2 - 1);
+            endBin = firstBin + 1;
+         }
+         stage.firstBin[count] = firstBin;
+         stage.endBin[count] = getMax(firstBin, endBin);
+      }
+   }
+
+   objectStagesRate = objectSamplesPerSecond;
+   objectStagesDirty = false;
+}
+
+void MultiResFFTObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectMultiResDataMutex, true );
+
+   const F32* samples = getSampleData();
+   U32 samplesize = objectSampleBufferSamples;
+   if(!samples || !samplesize)
+      return;
+
+   if(objectStagesDirty || objectStagesRate != objectSamplesPerSecond)
+      buildStages();
+
+   // the decimators and the first framer copy what they need, the mono mix is only held
+   //    while they do
+   const F32* mono = objectMono->lock(objectSampleBlock, samplesize);
+   if(objectStageCount > 1)
+      objectChain.process(mono, samplesize);
+
+   // each stage frames its own stream
+   for(U32 stageIndex=0; stageIndex<objectStageCount; stageIndex++){
+      U32 count = samplesize;
+      const F32* input = stageIndex ? objectChain.getOutput(stageIndex, count) : mono;
+      objectStages[stageIndex].framer.write(input, count);
+   }
+   objectMono->unlock();
+
+   for(U32 stageIndex=0; stageIndex<objectStageCount; stageIndex++){
+      Stage& stage = objectStages[stageIndex];
+      const F32* frame;
+      while((frame = stage.framer.nextFrame()) != NULL){
+         processFrame(stage, frame);
+      }
+   }
+}
+
+void MultiResFFTObject::processFrame(Stage& stage, const F32* frame){
+   if(!stage.bandCount)
+      return;
+
+   U32 size = objectStageSize;
+   const F32* window = AudioWindow::getTable(AUDIO_FFT_WINDOW, size);
+   F32* fftBuffer = objectFFTBuffer.reserve<F32>(size);
+   for(U32 count=0; count<size; count++){
+      fftBuffer[count] = frame[count]*window[count];
+   }
+
+   AudioFFTPlan* plan = AudioFFTPlanCache::acquire(size);
+   F32* out = objectFFTOutput.reserve<F32>(size+2);
+   plan->forward(fftBuffer, out);
+   AudioFFTPlanCache::release(plan);
+
+   U32 bins = size/2;
+   F32* power = objectPowerBuffer.reserve<F32>(bins);
+   audioPowerSpectrum(power, out, bins);
+
+   // band power grows with the square of the frame size, match an FFTObject frame
+   F32 scale = (F32)AUDIO_FFT_FRAME_SIZE/size;
+   scale *= scale;
+   F32* bandPower = objectBandBuffer.address() + stage.firstBand;
+   for(U32 band=0; band<stage.bandCount; band++){
+      F32 sum = 0.0f;
+      for(U32 count=stage.firstBin[band]; count<stage.endBin[band]; count++){
+         sum += power[count];
+      }
+      bandPower[band] = sum*scale;
+   }
+
+   // only this stage's bands, the others keep their last value until their stage updates
+   audioLog(bandPower, bandPower, 1.0f, stage.bandCount);
+   audioSmooth(AudioFreqOutput.address() + stage.firstBand, bandPower, stage.smoothing, stage.bandCount);
+}
+
+// console
+DefineEngineMethod(MultiResFFTObject, setStages, void, (U32 count, U32 size), (AUDIO_MULTIRES_STAGES, AUDIO_MULTIRES_SIZE),
+   "Set the number of decimated stages and their FFT size.\n"
+   "Stage n runs at the capture rate divided by 2^n, each extra stage adds an octave of "
+   "longer windows at the bottom.\n"
+   "@param count Number of stages (1 to 6).\n"
+   "@param size FFT size of every stage, rounded up to a power of 2.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setStages(count, size);
+}
+
+DefineEngineMethod(MultiResFFTObject, getBandStages, const char*, (),,
+   "Get the stage that computes each band, 0 is the full rate stage.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of integers, empty until audio has been processed.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> stages;
+   object->getBandStages(stages);
+
+   return formatAudioU32List(stages);
+}
+
+DefineEngineMethod(MultiResFFTObject, setAudioFreqBands, void, (const char* bandfreqstr),,
+   "Set MultiResFFTObject frequency bands, same as FFTObject.\n"
+   "@param Comma or space separated list of positive integers.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> tmpbands;
+   parseAudioFreqBands(bandfreqstr, tmpbands);
+
+   object->setAudioFreqBands(tmpbands);
+}
+
+DefineEngineMethod(MultiResFFTObject, getAudioFreqBands, const char*, (),,
+   "Get MultiResFFTObject frequency bands.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of integers.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> tmpbands;
+   object->getAudioFreqBands(tmpbands);
+
+   return formatAudioU32List(tmpbands);
+}
+
+DefineEngineMethod(MultiResFFTObject, getAudioFreqOutput, const char*, (),,
+   "Get MultiResFFTObject band output, same scale as FFTObject.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getAudioFreqOutput(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
@@ -0,0 +1,92 @@
+#ifndef _AUDIO_MULTIRES_FFT_OBJECT_H_
+#define _AUDIO_MULTIRES_FFT_OBJECT_H_
+
+#include "loopbackAudio.h"
+#include "audioDecimator.h"
+
+/*
+Multi-resolution spectrum: the same FFT size run on copies of the stream decimated by
+1, 2, 4, 8... so each stage covers one more octave down with twice the frequency
+resolution and twice the latency of the stage above it.  Every band is computed by the
+lowest rate stage that still passes it, so treble bands update every few mS from short
+windows while bass bands get long windows.
+
+At the defaults (4 stages of 1024) the top stage has a 21 mS window updated every 11 mS
+and the bottom stage runs at 6 kHz with a 171 mS window, the same bass resolution as an
+8192 FFT at full rate.
+
+Uses the same band list and output layout as FFTObject, the level is scaled to match an
+FFTObject at the default frame size.
+*/
+
+#define AUDIO_MULTIRES_MAX_STAGES 6
+#define AUDIO_MULTIRES_STAGES 4
+#define AUDIO_MULTIRES_SIZE 1024
+
+class MultiResFFTObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   struct Stage {
+      // mono stream at this stage's rate
+      AudioFramer framer;
+      U32 rate;
+      F32 smoothing;
+      // bands computed by this stage, always a contiguous run
+      U32 firstBand;
+      U32 bandCount;
+      // bins firstBin[n] to endBin[n]-1 are summed into band firstBand+n
+      Vector<U32> firstBin;
+      Vector<U32> endBin;
+   };
+
+   // protect band data
+   Mutex objectMultiResDataMutex;
+
+   U32 objectStageCount;
+   U32 objectStageSize;
+   Stage objectStages[AUDIO_MULTIRES_MAX_STAGES];
+   // decimated streams for stages 1 and up
+   AudioHalfbandChain objectChain;
+   // stages and tables are set up for objectStagesRate, rebuilt when dirty
+   bool objectStagesDirty;
+   U32 objectStagesRate;
+
+   // shared mono mix of each block
+   AudioMonoNode* objectMono;
+   AudioScratchBuffer objectFFTBuffer;
+   AudioScratchBuffer objectFFTOutput;
+   AudioScratchBuffer objectPowerBuffer;
+   Vector<F32> objectBandBuffer;
+   Vector<U32> AudioFreqBands;
+   Vector<F32> AudioFreqOutput;
+
+   // objectMultiResDataMutex must be held
+   void buildStages();
+   void processFrame(Stage& stage, const F32* frame);
+
+public:
+   MultiResFFTObject();
+   virtual ~MultiResFFTObject();
+
+   virtual void process_unique();
+
+   // number of stages (1 to AUDIO_MULTIRES_MAX_STAGES) and the FFT size used by all of them
+   void setStages(U32 count, U32 size);
+   // index of the stage computing each band, empty until the first block has been processed
+   void getBandStages(Vector<U32>& retstages);
+
+   // same as FFTObject
+   void setAudioFreqBands(Vector<U32>& bands);
+   void getAudioFreqBands(Vector<U32>& retbands);
+   void getAudioFreqOutput(Vector<F32>& retoutput);
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput){
+      getAudioFreqOutput(retoutput);
+      return getDataChanged();
+   }
+
+   DECLARE_CONOBJECT(MultiResFFTObject);
+};
+
+#endif // _AUDIO_MULTIRES_FFT_OBJECT_H_
@@ -0,0 +1,302 @@
+#include "audioPitchObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(PitchObject);
+
+// frames with less energy than this per sample are silence
+#define AUDIO_PITCH_MIN_ENERGY 1e-10f
+
+PitchObject::PitchObject(){
+   objectMinFreq = AUDIO_PITCH_MIN_FREQ;
+   objectMaxFreq = AUDIO_PITCH_MAX_FREQ;
+   objectThreshold = AUDIO_PITCH_THRESHOLD;
+
+   objectFramerRate = 0;
+   objectSetupDirty = true;
+   objectWindowSize = 0;
+   objectMinLag = 0;
+   objectMaxLag = 0;
+
+   objectPitch = 0.0f;
+   objectConfidence = 0.0f;
+   objectVoiced = false;
+
+   objectMono = AudioMonoNode::find();
+}
+PitchObject::~PitchObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectPitchDataMutex, true );
+
+   AudioAnalysisGraph::releaseNode(objectMono);
+}
+
+void PitchObject::setPitchRange(F32 minFreq, F32 maxFreq){
+   MutexHandle mutex;
+   mutex.lock( &objectPitchDataMutex, true );
+
+   objectMinFreq = mClampF(minFreq, 20.0f, 5000.0f);
+   objectMaxFreq = mClampF(maxFreq, objectMinFreq*1.5f, 10000.0f);
+   objectSetupDirty = true;
+}
+
+void PitchObject::setThreshold(F32 threshold){
+   MutexHandle mutex;
+   mutex.lock( &objectPitchDataMutex, true );
+
+   objectThreshold = mClampF(threshold, 0.01f, 1.0f);
+}
+
+void PitchObject::setupFramer(){
+   U32 rate = objectSamplesPerSecond;
+   objectMinLag = getMax(U32(rate/objectMaxFreq), U32(2));
+   objectMaxLag = U32(mCeil(rate/objectMinFreq));
+
+   // the window has to hold the longest period, one extra lag is needed for interpolation
+   U32 frameSize = AudioFramer::roundFrameSize((objectMaxLag + 2)*2);
+   objectWindowSize = frameSize/2;
+   objectMaxLag = getMin(objectMaxLag, objectWindowSize - 2);
+   objectMinLag = getMin(objectMinLag, objectMaxLag - 1);
+
+   objectFramer.setup(frameSize, getMax(rate*AUDIO_PITCH_HOP_MS/1000, U32(1)));
+   objectFramerRate = rate;
+   objectSetupDirty = false;
+}
+
+void PitchObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectPitchDataMutex, true );
+
+   const F32* samples = getSampleData();
+   U32 samplesize = objectSampleBufferSamples;
+   if(!samples || !samplesize)
+      return;
+
+   if(objectSetupDirty || objectFramerRate != objectSamplesPerSecond)
+      setupFramer();
+
+   U32 frames;
+   const F32* mono = objectMono->lock(objectSampleBlock, frames);
+   objectFramer.write(mono, frames);
+   objectMono->unlock();
+
+   const F32* frame;
+   while((frame = objectFramer.nextFrame()) != NULL){
+      processFrame(frame);
+   }
+}
+
+void PitchObject::processFrame(const F32* frame){
+   const U32 window = objectWindowSize;
+   const U32 frameSize = window*2;
+   // correlation of the first window with the whole frame, the window is zero padded to the
+   //    frame size so the circular correlation only wraps for lags past the window size
+   const U32 fftSize = frameSize;
+   const U32 bins = fftSize/2 + 1;
+
+   F32 energy = 0.0f;
+   for(U32 count=0; count<window; count++)
+      energy += frame[count]*frame[count];
+   if(energy < AUDIO_PITCH_MIN_ENERGY*window){
+      objectPitch = 0.0f;
+      objectConfidence = 0.0f;
+      objectVoiced = false;
+      return;
+   }
+
+   F32* pad = objectPadBuffer.reserve<F32>(fftSize);
+   F32* spectrumA = objectSpectrumA.reserve<F32>(bins*2);
+   F32* spectrumB = objectSpectrumB.reserve<F32>(bins*2);
+   F32* correlation = objectCorrelation.reserve<F32>(fftSize);
+
+   AudioFFTPlan* plan = AudioFFTPlanCache::acquire(fftSize);
+   dMemcpy(pad, frame, sizeof(F32)*window);
+   dMemset(pad + window, 0, sizeof(F32)*(fftSize - window));
+   plan->forward(pad, spectrumA);
+   dMemcpy(pad, frame, sizeof(F32)*frameSize);
+   plan->forward(pad, spectrumB);
+   audioConjMultiply(spectrumA, spectrumA, spectrumB, bins);
+   plan->inverse(spectrumA, correlation);
+   AudioFFTPlanCache::release(plan);
+
+   // difference function normalised by its running mean (cumulative mean normalised
+   //    difference), 1 at lag 0 by definition
+   const U32 lags = objectMaxLag + 2;
+   F32* difference = objectDifference.reserve<F32>(lags);
+   F32 scale = 1.0f/fftSize;
+   F32 shifted = energy;
+   F32 sum = 0.0f;
+   difference[0] = 1.0f;
+   for(U32 lag=1; lag<lags; lag++){
+      shifted += frame[lag + window - 1]*frame[lag + window - 1] - frame[lag - 1]*frame[lag - 1];
+      F32 value = getMax(energy + shifted - 2.0f*correlation[lag]*scale, 0.0f);
+      sum += value;
+      difference[lag] = sum > 0.0f ? value*lag/sum : 1.0f;
+   }
+
+   // first dip under the threshold, followed to the bottom, otherwise the deepest point
+   U32 best = 0;
+   for(U32 lag=objectMinLag; lag<=objectMaxLag; lag++){
+      if(difference[lag] < objectThreshold){
+         while(lag+1 <= objectMaxLag && difference[lag+1] < difference[lag])
+            lag++;
+         best = lag;
+         break;
+      }
+   }
+   objectVoiced = best != 0;
+   if(!objectVoiced){
+      best = objectMinLag;
+      for(U32 lag=objectMinLag+1; lag<=objectMaxLag; lag++){
+         if(difference[lag] < difference[best])
+            best = lag;
+      }
+   }
+
+   // parabola through the dip for a fractional period
+   F32 period = (F32)best;
+   F32 before = difference[best-1], center = difference[best], after = difference[best+1];
+   F32 curve = before - 2.0f*center + after;
+   if(curve > 0.0f)
+      period += mClampF(0.5f*(before - after)/curve, -0.5f, 0.5f);
+
+   objectConfidence = mClampF(1.0f - center, 0.0f, 1.0f);
+   objectPitch = objectVoiced ? objectSamplesPerSecond/period : 0.0f;
+}
+
+F32 PitchObject::getPitch(){
+   MutexHandle mutex;
+   mutex.lock( &objectPitchDataMutex, true );
+   return objectPitch;
+}
+F32 PitchObject::getConfidence(){
+   MutexHandle mutex;
+   mutex.lock( &objectPitchDataMutex, true );
+   return objectConfidence;
+}
+F32 PitchObject::getNote(){
+   MutexHandle mutex;
+   mutex.lock( &objectPitchDataMutex, true );
+   if(objectPitch <= 0.0f)
+      return 0.0f;
+   return 69.0f + 12.0f*mLog(objectPitch/440.0f)/mLog(2.0f);
+}
+
+U32 PitchObject::getProcessedOutput(Vector<F32>& retoutput){
+   retoutput.clear();
+   retoutput.push_back(getPitch());
+   retoutput.push_back(getConfidence());
+   retoutput.push_back(getNote());
+
+   return getDataChanged();
+}
+
+// console
+DefineEngineMethod(PitchObject, setPitchRange, void, (F32 minFreq, F32 maxFreq), (AUDIO_PITCH_MIN_FREQ, AUDIO_PITCH_MAX_FREQ),
+   "Set the range of fundamental frequencies searched.  A lower minimum needs a longer frame.\n"
+   "@param minFreq Lowest pitch in Hz.\n"
+   "@param maxFreq Highest pitch in Hz.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setPitchRange(minFreq, maxFreq);
+}
+
+DefineEngineMethod(PitchObject, setThreshold, void, (F32 threshold), (AUDIO_PITCH_THRESHOLD),
+   "Set how periodic a frame has to be to count as pitched, lower is stricter.\n"
+   "@param threshold 0.01 to 1, 0.15 by default.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setThreshold(threshold);
+}
+
+DefineEngineMethod(PitchObject, getPitch, F32, (),,
+   "Get the fundamental frequency of the last frame.\n"
+   "@param Nothing.\n"
+   "@return Pitch in Hz, 0 if the frame was not pitched.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getPitch();
+}
+
+DefineEngineMethod(PitchObject, getConfidence, F32, (),,
+   "Get how periodic the last frame was.\n"
+   "@param Nothing.\n"
+   "@return 0 to 1, clean tones are above 0.9.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getConfidence();
+}
+
+DefineEngineMethod(PitchObject, getNote, F32, (),,
+   "Get the pitch of the last frame as a MIDI note number, 69 is A 440 and 60 is middle C.\n"
+   "@param Nothing.\n"
+   "@return Note with the fraction in cents/100, 0 if the frame was not pitched.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getNote();
+}
+
+// benchmark
+DefineEngineFunction( benchmarkAudioPitch, F32, (U32 seconds), (10),
+   "Time PitchObject on a harmonic tone at 48 kHz and print the cost of each 10 mS hop.\n"
+   "@param seconds Seconds of audio to process.\n"
+   "@return Milliseconds of one core used per hop, zero if the audio loopback thread is running.\n"
+   "@ingroup AudioLoopBack" )
+{
+   // the object shares the analysis graph nodes with the live ones
+   if(_activeLoopbackThread != NULL){
+      Con::warnf("benchmarkAudioPitch: Stop the active audio loopback thread first.");
+      return 0.0f;
+   }
+
+   const U32 rate = 48000;
+   const U32 frames = rate/10;
+   const U32 blocks = getMax(seconds, U32(1))*10;
+   const F32 freq = 220.0f;
+
+   // a few harmonics over a little noise, the block is a whole number of periods
+   AudioSampleRing ring;
+   ring.allocate(frames*4, AUDIO_NUM_CHANNELS);
+   ring.reset(rate);
+   Vector<F32> data;
+   data.setSize(frames*AUDIO_NUM_CHANNELS);
+   U32 seed = 1;
+   for(U32 count=0; count<frames; count++){
+      seed = seed*1664525 + 1013904223;
+      F32 phase = M_2PI_F*freq*count/rate;
+      F32 value = 0.3f*mSin(phase) + 0.2f*mSin(2.0f*phase) + 0.1f*mSin(3.0f*phase) +
+         0.02f*(F32(seed >> 8)/F32(1 << 24) - 0.5f);
+      data[count*2+0] = value;
+      data[count*2+1] = value;
+   }
+   ring.write(data.address(), frames);
+   U32 index = ring.publish() - frames;
+   // the mono mix is only computed for a block it has not seen, alternate between two
+   //    copies so every timed call pays for it as it would live
+   AudioSampleBlockRef block[2];
+   block[0] = AudioSampleBlock::create(ring, index, frames, 0);
+   block[1] = AudioSampleBlock::create(ring, index, frames, 1);
+
+   PitchObject* pitch = new PitchObject();
+   // first block sets up the framer and buffers
+   pitch->process(block[0]);
+
+   U32 start = Platform::getRealMilliseconds();
+   for(U32 count=0; count<blocks; count++)
+      pitch->process(block[(count+1)&1]);
+   U32 elapsed = Platform::getRealMilliseconds() - start;
+
+   F32 hops = F32(blocks)*100.0f/AUDIO_PITCH_HOP_MS;
+   F32 hopMs = elapsed/hops;
+   Con::printf("benchmarkAudioPitch: %.1f uS per %d mS hop (%.1f%% of one core), %s FFT, %s kernels",
+      hopMs*1000.0f, AUDIO_PITCH_HOP_MS, hopMs*100.0f/AUDIO_PITCH_HOP_MS,
+      AudioFFTPlanCache::getSelectedBackend()->getName(), getAudioKernelSetName());
+   Con::printf("benchmarkAudioPitch: %.2f Hz found for %.2f Hz, confidence %.3f", pitch->getPitch(), freq, pitch->getConfidence());
+
+   delete pitch;
+   return hopMs;
+}
@@ -0,0 +1,88 @@
+#ifndef _AUDIO_PITCH_OBJECT_H_
+#define _AUDIO_PITCH_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Fundamental frequency tracking with YIN.
+Every hop (10 mS) the YIN difference function of the newest frame is computed for every
+lag between the shortest and longest period in the pitch range:
+   d(t) = sum((x[j] - x[j+t])^2) = energy(0) + energy(t) - 2*r(t)
+The cross correlation r(t) comes from frame size FFTs of the zero padded first half and of
+the whole frame, a conjugate multiply and an inverse FFT, so the cost does not grow with the
+lag range.  d(t) is normalised by its
+running mean, the first dip under the threshold is the period and the depth of the dip
+gives the confidence.
+
+The frame is twice the longest period rounded up to a power of 2, 2048 samples at
+48 kHz for the default 50 Hz lower limit.
+*/
+
+#define AUDIO_PITCH_MIN_FREQ 50.0f
+#define AUDIO_PITCH_MAX_FREQ 2000.0f
+#define AUDIO_PITCH_HOP_MS 10
+// dips in the normalised difference below this are periods, 0.1 to 0.2 is usual
+#define AUDIO_PITCH_THRESHOLD 0.15f
+
+class PitchObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect pitch data
+   Mutex objectPitchDataMutex;
+
+   F32 objectMinFreq;
+   F32 objectMaxFreq;
+   F32 objectThreshold;
+
+   // mono stream cut into frames of twice the window
+   AudioFramer objectFramer;
+   // framer and lags are set up for objectFramerRate, rebuilt when dirty
+   U32 objectFramerRate;
+   bool objectSetupDirty;
+   U32 objectWindowSize;
+   U32 objectMinLag;
+   U32 objectMaxLag;
+
+   // shared mono mix of each block
+   AudioMonoNode* objectMono;
+   // zero padded first half, the spectra, the correlation and the difference function
+   AudioScratchBuffer objectPadBuffer;
+   AudioScratchBuffer objectSpectrumA;
+   AudioScratchBuffer objectSpectrumB;
+   AudioScratchBuffer objectCorrelation;
+   AudioScratchBuffer objectDifference;
+
+   F32 objectPitch;
+   F32 objectConfidence;
+   bool objectVoiced;
+
+   // objectPitchDataMutex must be held
+   void setupFramer();
+   void processFrame(const F32* frame);
+
+public:
+   PitchObject();
+   virtual ~PitchObject();
+
+   virtual void process_unique();
+
+   // range of fundamentals searched in Hz
+   void setPitchRange(F32 minFreq, F32 maxFreq);
+   void setThreshold(F32 threshold);
+
+   // Hz, 0 when no pitch was found in the last frame
+   F32 getPitch();
+   // 0 to 1, how periodic the last frame was
+   F32 getConfidence();
+   // MIDI note number with the fraction, 69 is A 440, 0 when no pitch was found
+   F32 getNote();
+
+   // pitch, confidence, note
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput);
+
+   DECLARE_CONOBJECT(PitchObject);
+};
+
+#endif // _AUDIO_PITCH_OBJECT_H_
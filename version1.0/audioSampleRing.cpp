@@ -0,0 +1,153 @@
+#include "audioSampleRing.h"
+
+#include "math/mMathFn.h"
+
+AudioSampleRing::AudioSampleRing(){
+   mWriteIndex = 0;
+   mPendingIndex = 0;
+   mLastPacketFrames = 0;
+   mSamplesPerSecond = 0;
+
+   mBuffer = NULL;
+   mChannels = 0;
+   mCapacity = 0;
+   mMask = 0;
+   mGuardFrames = 0;
+}
+AudioSampleRing::~AudioSampleRing(){
+   if(mBuffer)
+      dFree_aligned(mBuffer);
+}
+
+void AudioSampleRing::allocate(U32 capacityFrames, U32 channels){
+   if(mBuffer)
+      dFree_aligned(mBuffer);
+
+   mCapacity = getNextPow2(capacityFrames);
+   mMask = mCapacity - 1;
+   mChannels = channels;
+   // a quarter of the ring is kept between the oldest readable frame and the producer
+   mGuardFrames = mCapacity/4;
+
+   mBuffer = (F32*)dMalloc_aligned(sizeof(F32)*mCapacity*mChannels, AUDIO_RING_CACHE_LINE);
+   dMemset(mBuffer, 0, sizeof(F32)*mCapacity*mChannels);
+
+   mWriteIndex = 0;
+   mPendingIndex = 0;
+   mLastPacketFrames = 0;
+}
+
+void AudioSampleRing::reset(U32 samplesPerSecond){
+   mSamplesPerSecond = samplesPerSecond;
+   mLastPacketFrames = 0;
+   // drop anything committed but not published, then move the published index a whole ring
+   //    forward so every reader is past getSafeFrames() and clampReadIndex() skips it ahead
+   //    rather than letting it read old data as the new stream
+   dFetchAndAdd(mWriteIndex, mCapacity);
+   mPendingIndex = dAtomicRead(mWriteIndex);
+}
+
+void AudioSampleRing::write(const F32* src, U32 frames){
+   while(frames){
+      F32* dest;
+      U32 span = reserve(frames, dest);
+      dMemcpy(dest, src, sizeof(F32)*span*mChannels);
+      commit(span);
+      src += span*mChannels;
+      frames -= span;
+   }
+}
+
+U32 AudioSampleRing::publish(){
+   U32 current = mWriteIndex;
+   U32 frames = mPendingIndex - current;
+   mLastPacketFrames = frames;
+   // full barrier, the frame data is visible before the new index
+   dFetchAndAdd(mWriteIndex, frames);
+   return mPendingIndex;
+}
+
+void AudioSampleRing::read(U32 index, U32 frames, F32* dest){
+   while(frames){
+      const F32* src;
+      U32 span = getSpan(index, frames, src);
+      dMemcpy(dest, src, sizeof(F32)*span*mChannels);
+      index += span;
+      dest += span*mChannels;
+      frames -= span;
+   }
+}
+
+U32 AudioSampleRing::clampReadIndex(U32& readIndex, U32 writeIndex){
+   U32 frames = writeIndex - readIndex;
+   if(frames > getSafeFrames()){
+      // reader fell too far behind (or the stream was reset), skip to the newest packet
+      frames = getMin(getLastPacketFrames(), getSafeFrames());
+      readIndex = writeIndex - frames;
+   }
+   return frames;
+}
+
+// shared blocks
+Mutex AudioSampleBlock::smPoolMutex;
+Vector<AudioSampleBlock::DataBuffer> AudioSampleBlock::smPool;
+volatile U32 AudioSampleBlock::smAllocCount = 0;
+
+AudioSampleBlock::AudioSampleBlock(){
+   mData = NULL;
+   mCapacity = 0;
+   mFrames = 0;
+   mChannels = 0;
+   mSamplesPerSecond = 0;
+   mSequence = 0;
+}
+AudioSampleBlock::~AudioSampleBlock(){
+   if(!mData)
+      return;
+
+   // keep the data for the next block
+   MutexHandle mutex;
+   mutex.lock( &smPoolMutex, true );
+   if(smPool.size() < AUDIO_SAMPLE_BLOCK_POOL){
+      DataBuffer buffer;
+      buffer.data = mData;
+      buffer.capacity = mCapacity;
+      smPool.push_back(buffer);
+   }else{
+      dFree_aligned(mData);
+   }
+}
+
+AudioSampleBlock* AudioSampleBlock::create(AudioSampleRing& ring, U32 index, U32 frames, U32 sequence){
+   AudioSampleBlock* block = new AudioSampleBlock;
+   block->mFrames = frames;
+   block->mChannels = ring.getChannels();
+   block->mSamplesPerSecond = ring.getSamplesPerSecond();
+   block->mSequence = sequence;
+
+   // reuse the data of a freed block if one is large enough, otherwise replace the newest
+   //    pooled buffer so the pool moves up to the new packet size
+   U32 values = getMax(frames, U32(1))*block->mChannels;
+   MutexHandle mutex;
+   mutex.lock( &smPoolMutex, true );
+   for(S32 count=smPool.size()-1; count>=0 && !block->mData; count--){
+      if(smPool[count].capacity >= values){
+         block->mData = smPool[count].data;
+         block->mCapacity = smPool[count].capacity;
+         smPool.erase(count);
+      }
+   }
+   if(!block->mData && smPool.size()){
+      dFree_aligned(smPool.last().data);
+      smPool.pop_back();
+   }
+   mutex.unlock();
+
+   if(!block->mData){
+      block->mData = (F32*)dMalloc_aligned(sizeof(F32)*values, AUDIO_RING_CACHE_LINE);
+      block->mCapacity = values;
+      dFetchAndAdd(smAllocCount, 1);
+   }
+   ring.read(index, frames, block->mData);
+   return block;
+}
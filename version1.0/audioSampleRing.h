@@ -0,0 +1,151 @@
+#ifndef _AUDIO_SAMPLE_RING_H_
+#define _AUDIO_SAMPLE_RING_H_
+
+#include "platform/platform.h"
+#include "platform/platformIntrinsics.h"
+#include "platform/threads/threadSafeRefCount.h"
+#include "platform/threads/mutex.h"
+#include <core/util/tVector.h>
+
+/*
+Single producer ring buffer of interleaved stereo frames.
+The capture side reserves/commits space and then publishes a whole packet at once.
+Readers keep their own frame index and read spans directly out of the ring, no locks are
+involved so the producer never waits on a slow reader.  A reader that falls further behind
+than getSafeFrames() has lost data and must skip ahead, see clampReadIndex().
+
+Indexes are frame counts that are allowed to wrap at 2^32, differences are always
+computed with unsigned subtraction.
+*/
+
+// keep the producer index on its own cache line away from the read mostly data
+#define AUDIO_RING_CACHE_LINE 64
+
+class AudioSampleRing
+{
+private:
+   // written by the producer once per packet, polled by the readers
+   U8 mPadStart[AUDIO_RING_CACHE_LINE];
+   volatile U32 mWriteIndex;      // published frames
+   volatile U32 mLastPacketFrames; // size of the last published packet
+   volatile U32 mSamplesPerSecond;
+   U8 mPadWrite[AUDIO_RING_CACHE_LINE - sizeof(U32)*3];
+   // producer only, changes on every commit
+   U32 mPendingIndex;             // committed but not yet published frames
+   U8 mPadPending[AUDIO_RING_CACHE_LINE - sizeof(U32)];
+
+   // set once in allocate()
+   F32* mBuffer;
+   U32 mChannels;
+   U32 mCapacity; // in frames, power of 2
+   U32 mMask;
+   U32 mGuardFrames; // space left for the producer to write into while readers copy
+   U8 mPadEnd[AUDIO_RING_CACHE_LINE];
+
+public:
+   AudioSampleRing();
+   ~AudioSampleRing();
+
+   // preallocate the ring, capacity is rounded up to a power of 2
+   //    only call when no producer or readers are active
+   void allocate(U32 capacityFrames, U32 channels);
+   bool isAllocated(){ return mBuffer != NULL; }
+   // start a new stream, the write index jumps a whole ring ahead so readers see they are
+   //    too far behind and skip to the first packet of the new stream
+   void reset(U32 samplesPerSecond);
+
+   U32 getCapacity(){ return mCapacity; }
+   U32 getChannels(){ return mChannels; }
+   U32 getSamplesPerSecond(){ return mSamplesPerSecond; }
+
+   // producer
+   // get a contiguous block of up to frames frames at the pending position
+   U32 reserve(U32 frames, F32*& dest){
+      U32 offset = mPendingIndex & mMask;
+      dest = mBuffer + offset*mChannels;
+      return getMin(frames, mCapacity - offset);
+   }
+   // mark frames written by the last reserve as complete
+   void commit(U32 frames){ mPendingIndex += frames; }
+   // copy frames into the ring, wraps as needed
+   void write(const F32* src, U32 frames);
+   // frames committed since the last publish
+   U32 getPendingFrames(){ return mPendingIndex - mWriteIndex; }
+   // make all committed frames visible to readers
+   //    returns the new write index
+   U32 publish();
+
+   // readers
+   U32 getWriteIndex(){ return dAtomicRead(mWriteIndex); }
+   U32 getLastPacketFrames(){ return dAtomicRead(mLastPacketFrames); }
+   // how far behind the write index a reader can be and still get valid data
+   U32 getSafeFrames(){ return mCapacity - mGuardFrames; }
+   // get the contiguous part of frames starting at index
+   //    returns number of frames available in src, call again for the wrapped remainder
+   U32 getSpan(U32 index, U32 frames, const F32*& src){
+      U32 offset = index & mMask;
+      src = mBuffer + offset*mChannels;
+      return getMin(frames, mCapacity - offset);
+   }
+   // copy frames starting at index to dest, handles wrap
+   void read(U32 index, U32 frames, F32* dest);
+   // make sure a reader index still points at valid data
+   //    returns number of frames the reader should consume, updates readIndex if it had to skip
+   U32 clampReadIndex(U32& readIndex, U32 writeIndex);
+};
+
+/*
+Read only block of interleaved frames copied out of the ring once per packet.
+All LoopBackObjects hold a reference to the same block, the block is freed when the last
+reference goes away.  Nothing may write to the data after create() returns, objects that
+need to modify samples write into their own buffers.
+
+The sample data of freed blocks goes back to a small pool and is reused by the next
+create(), so once the largest packet size has been seen the data is never allocated again.
+The block object itself is still a small heap allocation per packet.
+*/
+
+// data buffers kept for reuse, only a few blocks are ever in flight at once
+#define AUDIO_SAMPLE_BLOCK_POOL 8
+
+class AudioSampleBlock : public ThreadSafeRefCount<AudioSampleBlock>
+{
+private:
+   struct DataBuffer {
+      F32* data;
+      U32 capacity;  // values data can hold
+   };
+
+   F32* mData;
+   U32 mCapacity;
+   U32 mFrames;
+   U32 mChannels;
+   U32 mSamplesPerSecond;
+   // packet number since the stream started
+   U32 mSequence;
+
+   static Mutex smPoolMutex;
+   static Vector<DataBuffer> smPool;
+   static volatile U32 smAllocCount;
+
+   AudioSampleBlock();
+
+public:
+   ~AudioSampleBlock();
+
+   // copy frames starting at index out of the ring into a new block
+   static AudioSampleBlock* create(AudioSampleRing& ring, U32 index, U32 frames, U32 sequence);
+
+   const F32* getData() const { return mData; }
+   U32 getFrames() const { return mFrames; }
+   U32 getChannels() const { return mChannels; }
+   U32 getSamplesPerSecond() const { return mSamplesPerSecond; }
+   U32 getSequence() const { return mSequence; }
+
+   // number of sample data allocations, stays put while packets are no larger than before
+   static U32 getAllocCount(){ return dAtomicRead(smAllocCount); }
+};
+
+typedef ThreadSafeRef<AudioSampleBlock> AudioSampleBlockRef;
+
+#endif // _AUDIO_SAMPLE_RING_H_
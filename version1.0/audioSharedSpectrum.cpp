@@ -0,0 +1,77 @@
+#include "audioSharedSpectrum.h"
+
+#include "math/mMath.h"
+#include "loopbackAudio.h"
+
+AudioSharedSpectrum::AudioSharedSpectrum(const String& key, U32 frameSize, U32 hopSize, AudioWindow::WindowType windowType) : AudioAnalysisNode(key){
+   mFrameSize = frameSize;
+   mHopSize = hopSize;
+   mWindowType = windowType;
+   mWindow = AudioWindow::getTable(windowType, frameSize);
+   mFramer.setup(frameSize, hopSize, AUDIO_NUM_CHANNELS);
+   mRate = 0;
+   mFrames = 0;
+}
+
+String AudioSharedSpectrum::makeKey(U32& frameSize, U32& hopSize, AudioWindow::WindowType windowType){
+   frameSize = AudioFramer::roundFrameSize(frameSize);
+   hopSize = mClamp(hopSize, 1, frameSize);
+   return String::ToString("spectrum %d %d %s", frameSize, hopSize, AudioWindow::getTypeName(windowType));
+}
+
+AudioSharedSpectrum* AudioSharedSpectrum::find(U32 frameSize, U32 hopSize, AudioWindow::WindowType windowType){
+   String key = makeKey(frameSize, hopSize, windowType);
+
+   MutexHandle mutex;
+   mutex.lock( &AudioAnalysisGraph::getMutex(), true );
+
+   AudioAnalysisNode* node = AudioAnalysisGraph::acquireNode(key);
+   if(!node){
+      node = new AudioSharedSpectrum(key, frameSize, hopSize, windowType);
+      AudioAnalysisGraph::addNode(node);
+   }
+   return static_cast<AudioSharedSpectrum*>(node);
+}
+
+bool AudioSharedSpectrum::exists(U32 frameSize, U32 hopSize, AudioWindow::WindowType windowType){
+   String key = makeKey(frameSize, hopSize, windowType);
+
+   MutexHandle mutex;
+   mutex.lock( &AudioAnalysisGraph::getMutex(), true );
+
+   return AudioAnalysisGraph::findNode(key) != NULL;
+}
+
+void AudioSharedSpectrum::compute(AudioSampleBlock* block){
+   // frames from a different stream cannot be joined with what is pending
+   if(block->getSamplesPerSecond() != mRate){
+      mFramer.reset();
+      mRate = block->getSamplesPerSecond();
+   }
+   mFramer.write(block->getData(), block->getFrames());
+
+   // every frame the block completes, buffers only grow
+   U32 bins = getBins();
+   F32* power = mPower.reserve<F32>(bins*getMax(mFramer.getFramesReady(), U32(1)));
+   mFrames = 0;
+   const F32* frame;
+   while((frame = mFramer.nextFrame()) != NULL){
+      F32* fftBuffer = mFFTBuffer.reserve<F32>(mFrameSize);
+      audioMixWindow(fftBuffer, frame, mWindow, AUDIO_DATA_GAIN, mFrameSize);
+
+      AudioFFTPlan* plan = AudioFFTPlanCache::acquire(mFrameSize);
+      F32* out = mFFTOutput.reserve<F32>(mFrameSize+2);
+      plan->forward(fftBuffer, out);
+      AudioFFTPlanCache::release(plan);
+
+      audioPowerSpectrum(power + mFrames*bins, out, bins);
+      mFrames++;
+   }
+}
+
+const F32* AudioSharedSpectrum::lock(AudioSampleBlock* block, U32& frames){
+   lockBlock(block);
+
+   frames = mFrames;
+   return mFrames ? mPower.reserve<F32>(mFrames*getBins()) : NULL;
+}
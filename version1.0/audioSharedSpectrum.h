@@ -0,0 +1,77 @@
+#ifndef _AUDIO_SHARED_SPECTRUM_H_
+#define _AUDIO_SHARED_SPECTRUM_H_
+
+#include "platform/platform.h"
+#include "platform/threads/mutex.h"
+#include <core/util/tVector.h>
+
+#include "audioAnalysisGraph.h"
+#include "audioFFT.h"
+#include "audioFramer.h"
+#include "audioWindow.h"
+#include "audioSampleRing.h"
+#include "audioCaptureSource.h"
+
+/*
+Mono power spectra shared by every object that frames the stream the same way.
+One AudioSharedSpectrum node exists in the AudioAnalysisGraph per frame size, hop size and
+window.  Each block is framed and transformed once by whichever object asks for it first,
+the others read the cached spectra, so an FFTObject and a MelObject on the same settings
+cost one FFT per hop.
+
+Spectra are the power of bins 0 to frameSize/2 of the mixed, gained and windowed frame,
+the same values FFTObject has always used.  The mix is done together with the window on
+each frame rather than read from the AudioMonoNode, one pass over the data instead of two.
+
+Usage, once per block from process_unique:
+   U32 frames;
+   const F32* power = spectrum->lock(block, frames);
+   ... frames spectra of getBins() values each ...
+   spectrum->unlock();
+*/
+
+class AudioSharedSpectrum : public AudioAnalysisNode
+{
+private:
+   U32 mFrameSize;
+   U32 mHopSize;
+   AudioWindow::WindowType mWindowType;
+   const F32* mWindow;
+
+   AudioFramer mFramer;
+   U32 mRate;
+   // spectra completed by the last block
+   AudioScratchBuffer mPower;
+   U32 mFrames;
+   AudioScratchBuffer mFFTBuffer;
+   AudioScratchBuffer mFFTOutput;
+
+   AudioSharedSpectrum(const String& key, U32 frameSize, U32 hopSize, AudioWindow::WindowType windowType);
+   // graph key for the settings, rounds frameSize and clamps hopSize the same as find()
+   static String makeKey(U32& frameSize, U32& hopSize, AudioWindow::WindowType windowType);
+
+protected:
+   virtual void compute(AudioSampleBlock* block);
+
+public:
+   // get the shared spectrum for the settings with one more user, created on first use
+   //    frameSize is rounded with AudioFramer::roundFrameSize, hopSize is clamped to 1..frameSize
+   //    release with AudioAnalysisGraph::releaseNode
+   static AudioSharedSpectrum* find(U32 frameSize, U32 hopSize, AudioWindow::WindowType windowType);
+   // true if the spectrum for the settings is already in the graph, another object reading
+   //    it then costs no FFT of its own
+   static bool exists(U32 frameSize, U32 hopSize, AudioWindow::WindowType windowType);
+
+   U32 getFrameSize(){ return mFrameSize; }
+   U32 getHopSize(){ return mHopSize; }
+   AudioWindow::WindowType getWindowType(){ return mWindowType; }
+   // values in each spectrum, frameSize/2 + 1
+   U32 getBins(){ return mFrameSize/2 + 1; }
+
+   // lock the spectra completed by block, computing them if this is the first request
+   //    returns frames spectra one after the other, NULL if the block completed none
+   //    unlock must be called even when NULL is returned
+   const F32* lock(AudioSampleBlock* block, U32& frames);
+};
+
+#endif // _AUDIO_SHARED_SPECTRUM_H_
@@ -0,0 +1,303 @@
+#include "audioSlidingDFTObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(SlidingDFTObject);
+
+SlidingDFTObject::SlidingDFTObject(){
+   // same defaults as FFTObject
+   U32 freq = 30;
+   for(U32 count=0; count < 9; count++){
+      AudioFreqBands.push_back(freq);
+      freq *= 2;
+   }
+   AudioFreqOutput.setSize(AudioFreqBands.size());
+   AudioFreqOutput.fill(0.0f);
+
+   objectBankDirty = true;
+   objectBankRate = 0;
+   objectBankSize = 0;
+}
+SlidingDFTObject::~SlidingDFTObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectSDFTDataMutex, true );
+}
+
+void SlidingDFTObject::setAudioFreqBands(Vector<U32>& bands){
+   MutexHandle mutex;
+   mutex.lock( &objectSDFTDataMutex, true );
+
+   AudioFreqBands.clear();
+   AudioFreqBands.merge(bands);
+   objectBankDirty = true;
+   U32 outsize = AudioFreqOutput.size();
+   AudioFreqOutput.setSize(AudioFreqBands.size());
+   for(U32 count=outsize; count<AudioFreqOutput.size(); count++){
+      AudioFreqOutput[count] = 0.0f;
+   }
+}
+
+void SlidingDFTObject::getAudioFreqBands(Vector<U32>& retbands){
+   MutexHandle mutex;
+   mutex.lock( &objectSDFTDataMutex, true );
+
+   retbands.clear();
+   retbands.merge(AudioFreqBands);
+}
+
+void SlidingDFTObject::getAudioFreqOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectSDFTDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioFreqOutput);
+}
+
+void SlidingDFTObject::buildBank(){
+   U32 bands = AudioFreqBands.size();
+   U32 rate = objectSamplesPerSecond;
+   F32 nyquist = rate*0.5f;
+
+   objectBankSize = (bands + AUDIO_RESONATOR_ALIGN - 1) & ~(AUDIO_RESONATOR_ALIGN - 1);
+   objectState.setSize(objectBankSize*4);
+   objectState.fill(0.0f);
+   objectCoef.setSize(objectBankSize*2);
+   objectCoef.fill(0.0f);
+   objectEnergy.setSize(objectBankSize);
+   objectScale.setSize(bands);
+   objectBandBuffer.setSize(bands);
+
+   // FFTObject at its default frame size puts 3*A^2*N^2/32 of power in the band
+   //    holding a sine of amplitude A, the resonator pair averages A^2/(4*(1-r)^4)
+   F32 reference = 3.0f*AUDIO_FFT_FRAME_SIZE*AUDIO_FFT_FRAME_SIZE/8.0f;
+
+   for(U32 band=0; band<bands; band++){
+      // band edges are the midpoints FFTObject uses
+      F32 freq = (F32)AudioFreqBands[band];
+      F32 lower = band ? (AudioFreqBands[band-1] + freq)*0.5f : 0.0f;
+      F32 upper = band != bands-1 ? (freq + AudioFreqBands[band+1])*0.5f : freq*1.5f;
+      if(freq >= nyquist){
+         // bands above nyquist get no energy
+         objectScale[band] = 0.0f;
+         continue;
+      }
+
+      // each pole is half the band wide, the pair is -3dB at about a third of the band width
+      //    and -14dB at the band edges, a single pole that wide leaks too much into the other bands
+      F32 width = getMax((upper - lower)*0.5f, 1.0f);
+      F32 radius = mExp(-M_PI_F*width/rate);
+      F32 omega = M_2PI_F*freq/rate;
+      objectCoef[band] = radius*mCos(omega);
+      objectCoef[objectBankSize+band] = radius*mSin(omega);
+      F32 gain = (1.0f - radius)*(1.0f - radius);
+      objectScale[band] = gain*gain*reference;
+   }
+
+   objectBankRate = rate;
+   objectBankDirty = false;
+}
+
+void SlidingDFTObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectSDFTDataMutex, true );
+
+   const F32* samples = getSampleData();
+   U32 samplesize = objectSampleBufferSamples;
+   if(!samples || !samplesize)
+      return;
+
+   if(objectBankDirty || objectBankRate != objectSamplesPerSecond)
+      buildBank();
+
+   F32* mono = objectMonoBuffer.reserve<F32>(samplesize);
+   audioMix(mono, samples, AUDIO_DATA_GAIN, samplesize);
+
+   objectEnergy.fill(0.0f);
+   audioResonate(objectState.address(), objectEnergy.address(), objectCoef.address(), mono, samplesize, objectBankSize);
+
+   // resonators left ringing on silence decay into denormals, which are very slow
+   for(U32 count=0; count<objectState.size(); count++){
+      if(mFabs(objectState[count]) < 1e-15f)
+         objectState[count] = 0.0f;
+   }
+
+   U32 bands = AudioFreqBands.size();
+   F32 perSample = 1.0f/samplesize;
+   for(U32 band=0; band<bands; band++){
+      objectBandBuffer[band] = objectEnergy[band]*perSample*objectScale[band];
+   }
+
+   // one update per block, smoothing follows the block length
+   F32 smoothing = getHopSmoothing(AUDIO_FFT_SMOOTHING, samplesize, objectSamplesPerSecond);
+   audioLog(objectBandBuffer.address(), objectBandBuffer.address(), 1.0f, bands);
+   audioSmooth(AudioFreqOutput.address(), objectBandBuffer.address(), smoothing, bands);
+}
+
+// console
+DefineEngineMethod(SlidingDFTObject, setAudioFreqBands, void, (const char* bandfreqstr),,
+   "Set SlidingDFTObject frequency bands, same as FFTObject.\n"
+   "@param Comma or space separated list of positive integers.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> tmpbands;
+   parseAudioFreqBands(bandfreqstr, tmpbands);
+
+   object->setAudioFreqBands(tmpbands);
+}
+
+DefineEngineMethod(SlidingDFTObject, getAudioFreqBands, const char*, (),,
+   "Get SlidingDFTObject frequency bands.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of integers.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> tmpbands;
+   object->getAudioFreqBands(tmpbands);
+
+   return formatAudioU32List(tmpbands);
+}
+
+DefineEngineMethod(SlidingDFTObject, getAudioFreqOutput, const char*, (),,
+   "Get SlidingDFTObject band output, same scale as FFTObject.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getAudioFreqOutput(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+DefineEngineFunction( createAudioBandObject, S32, (const char* bandfreqstr), (""),
+   "Create a band analysis object, a SlidingDFTObject for a few bands when the processor has AVX "
+   "and no FFTObject spectrum is being computed yet, an FFTObject otherwise.\n"
+   "Both take the same bands and return output on the same scale.  The object still has to be "
+   "added with addAudioLoopBackObject().\n"
+   "@param bandfreqstr Comma or space separated list of band frequencies, empty for the defaults.\n"
+   "@return Id of the new object.\n"
+   "@ingroup AudioLoopBack" )
+{
+   Vector<U32> tmpbands;
+   parseAudioFreqBands(bandfreqstr, tmpbands);
+
+   // the defaults have 9 bands
+   U32 bands = tmpbands.size() ? tmpbands.size() : 9;
+   // the resonators are only cheaper with the AVX kernels, and never cheaper than reading a
+   //    spectrum another FFTObject on the default settings already computes
+   installAudioKernels();
+   bool avx = !dStricmp(getAudioKernelSetName(), "AVX");
+   bool shared = AudioSharedSpectrum::exists(AUDIO_FFT_FRAME_SIZE, U32(AUDIO_FFT_FRAME_SIZE*(1.0f - AUDIO_FFT_OVERLAP)), AUDIO_FFT_WINDOW);
+   if(bands <= AUDIO_SDFT_MAX_BANDS && avx && !shared){
+      SlidingDFTObject* obj = new SlidingDFTObject();
+      if(tmpbands.size())
+         obj->setAudioFreqBands(tmpbands);
+      obj->registerObject();
+      return obj->getId();
+   }else{
+      FFTObject* obj = new FFTObject();
+      if(tmpbands.size())
+         obj->setAudioFreqBands(tmpbands);
+      obj->registerObject();
+      return obj->getId();
+   }
+}
+
+// benchmark
+//    both objects process the same blocks, outside of the capture thread
+DefineEngineFunction( benchmarkAudioBandObjects, U32, (U32 blocks), (1000),
+   "Time FFTObject and SlidingDFTObject on the same audio at band counts from 4 to 48 and print "
+   "microseconds per 100 mS block.  The last column is a second FFTObject reading the spectrum "
+   "the first one computed.\n"
+   "@param blocks Number of blocks to process per measurement.\n"
+   "@return Largest band count where SlidingDFTObject was faster, see AUDIO_SDFT_MAX_BANDS, "
+   "zero if the audio loopback thread is running.\n"
+   "@ingroup AudioLoopBack" )
+{
+   // the objects share the analysis graph nodes with the live ones
+   if(_activeLoopbackThread != NULL){
+      Con::warnf("benchmarkAudioBandObjects: Stop the active audio loopback thread first.");
+      return 0;
+   }
+
+   const U32 rate = 48000;
+   const U32 frames = rate/10;
+
+   // a few sines over noise
+   AudioSampleRing ring;
+   ring.allocate(frames*4, AUDIO_NUM_CHANNELS);
+   ring.reset(rate);
+   Vector<F32> data;
+   data.setSize(frames*AUDIO_NUM_CHANNELS);
+   U32 seed = 1;
+   for(U32 count=0; count<frames; count++){
+      seed = seed*1664525 + 1013904223;
+      F32 value = 0.3f*mSin(M_2PI_F*110.0f*count/rate) + 0.2f*mSin(M_2PI_F*2500.0f*count/rate) +
+         0.05f*(F32(seed >> 8)/F32(1 << 24) - 0.5f);
+      data[count*2+0] = value;
+      data[count*2+1] = value;
+   }
+   ring.write(data.address(), frames);
+   U32 index = ring.publish() - frames;
+   // the shared spectrum is only computed for a block it has not seen, alternate between two
+   //    copies so every timed call pays for the mix, window and FFT as it would live
+   AudioSampleBlockRef block[2];
+   block[0] = AudioSampleBlock::create(ring, index, frames, 0);
+   block[1] = AudioSampleBlock::create(ring, index, frames, 1);
+
+   static const U32 sBandCounts[] = { 4, 8, 12, 16, 24, 32, 48 };
+   U32 crossover = 0;
+   Con::printf("benchmarkAudioBandObjects: uS per block, %s kernels, FFTObject / SlidingDFTObject / shared FFTObject",
+      getAudioKernelSetName());
+   for(U32 test=0; test<sizeof(sBandCounts)/sizeof(sBandCounts[0]); test++){
+      // log spaced from 30 Hz to 16 kHz
+      Vector<U32> bands;
+      U32 count = sBandCounts[test];
+      for(U32 band=0; band<count; band++)
+         bands.push_back(U32(30.0f*mPow(16000.0f/30.0f, F32(band)/F32(count-1))));
+
+      FFTObject* fft = new FFTObject();
+      FFTObject* fftShared = new FFTObject();
+      SlidingDFTObject* sdft = new SlidingDFTObject();
+      fft->setAudioFreqBands(bands);
+      fftShared->setAudioFreqBands(bands);
+      sdft->setAudioFreqBands(bands);
+
+      // first block sets up tables and buffers
+      fft->process(block[0]);
+      fftShared->process(block[0]);
+      sdft->process(block[0]);
+
+      U32 start = Platform::getRealMilliseconds();
+      for(U32 iter=0; iter<blocks; iter++)
+         fft->process(block[(iter+1)&1]);
+      F32 fftTime = (Platform::getRealMilliseconds() - start)*1000.0f/blocks;
+
+      start = Platform::getRealMilliseconds();
+      for(U32 iter=0; iter<blocks; iter++)
+         sdft->process(block[(iter+1)&1]);
+      F32 sdftTime = (Platform::getRealMilliseconds() - start)*1000.0f/blocks;
+
+      // both FFTObjects on each block, the second only sums the bands of the shared spectrum
+      start = Platform::getRealMilliseconds();
+      for(U32 iter=0; iter<blocks; iter++){
+         fft->process(block[iter&1]);
+         fftShared->process(block[iter&1]);
+      }
+      F32 sharedTime = getMax((Platform::getRealMilliseconds() - start)*1000.0f/blocks - fftTime, 0.0f);
+
+      Con::printf("   %2d bands  %8.1f %8.1f %8.1f", count, fftTime, sdftTime, sharedTime);
+      // only while every smaller count was also faster
+      if(sdftTime < fftTime && crossover == (test ? sBandCounts[test-1] : 0))
+         crossover = count;
+
+      delete fft;
+      delete fftShared;
+      delete sdft;
+   }
+
+   return crossover;
+}
@@ -0,0 +1,80 @@
+#ifndef _AUDIO_SLIDING_DFT_OBJECT_H_
+#define _AUDIO_SLIDING_DFT_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Band magnitudes for a handful of bands without an FFT.
+Each band is a pair of damped complex resonators in series (an exponentially windowed
+sliding DFT) tuned to the band frequency.  The response is strongest at the band frequency
+and falls away towards the edges of the range FFTObject sums for the band, so tones
+between two bands read lower than they do from FFTObject.  Every sample updates every band
+so there is no frame size or hop, the output is updated once per captured block from the
+average energy over the block.
+
+Cost is per sample per band where the FFT cost is per frame no matter how many bands are
+used, so this is only cheaper for small band counts, and only while no other FFTObject
+already pays for the shared spectrum.  createAudioBandObject() picks between the two,
+benchmarkAudioBandObjects() measures the crossover.
+
+Uses the same band list and output layout as FFTObject, the level is scaled to match an
+FFTObject at the default frame size.
+*/
+
+// band counts up to this use SlidingDFTObject in createAudioBandObject(), with the AVX
+//    kernels and while no FFTObject spectrum on the default settings exists
+//    resonators run in groups of AUDIO_RESONATOR_ALIGN, with AVX up to 8 bands take about 90%
+//    of the time of an FFTObject computing its own spectrum and 12 or more are slower.  An
+//    FFTObject reading a spectrum that is already computed costs under a fifth of either,
+//    without AVX the resonators are slower than the FFT, about 1.4 times with SSE and 6 with C
+#define AUDIO_SDFT_MAX_BANDS 8
+
+class SlidingDFTObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect band data
+   Mutex objectSDFTDataMutex;
+
+   // resonator bank for objectBankRate, rebuilt when dirty
+   //    sizes are padded to AUDIO_RESONATOR_ALIGN, padding bands have a zero coefficient
+   bool objectBankDirty;
+   U32 objectBankRate;
+   U32 objectBankSize;
+   // see audioResonate for the layout
+   Vector<F32> objectState;
+   Vector<F32> objectCoef;
+   Vector<F32> objectEnergy;
+   // energy to FFTObject band power
+   Vector<F32> objectScale;
+
+   // mono copy of the block, not the shared AudioMonoNode because the resonators read it for
+   //    the whole block and holding the node that long would serialize the worker pool
+   AudioScratchBuffer objectMonoBuffer;
+   Vector<F32> objectBandBuffer;
+   Vector<U32> AudioFreqBands;
+   Vector<F32> AudioFreqOutput;
+
+   // objectSDFTDataMutex must be held
+   void buildBank();
+
+public:
+   SlidingDFTObject();
+   virtual ~SlidingDFTObject();
+
+   virtual void process_unique();
+
+   // same as FFTObject
+   void setAudioFreqBands(Vector<U32>& bands);
+   void getAudioFreqBands(Vector<U32>& retbands);
+   void getAudioFreqOutput(Vector<F32>& retoutput);
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput){
+      getAudioFreqOutput(retoutput);
+      return getDataChanged();
+   }
+
+   DECLARE_CONOBJECT(SlidingDFTObject);
+};
+
+#endif // _AUDIO_SLIDING_DFT_OBJECT_H_
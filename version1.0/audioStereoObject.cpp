@@ -0,0 +1,349 @@
+#include "audioStereoObject.h"
+
+#include "console/engineAPI.h"
+#include "math/mMath.h"
+
+IMPLEMENT_CONOBJECT(StereoObject);
+
+// power sums below this are treated as silence
+#define AUDIO_STEREO_MIN_POWER 1e-12f
+
+// balance and correlation from left power, right power and cross power
+static void getStereoField(F32 left, F32 right, F32 cross, F32& balance, F32& correlation){
+   F32 total = left + right;
+   balance = total > AUDIO_STEREO_MIN_POWER ? (right - left)/total : 0.0f;
+   F32 product = left*right;
+   correlation = product > AUDIO_STEREO_MIN_POWER*AUDIO_STEREO_MIN_POWER ? mClampF(cross/mSqrt(product), -1.0f, 1.0f) : 0.0f;
+}
+
+StereoObject::StereoObject(){
+   // same defaults as FFTObject
+   U32 freq = 30;
+   for(U32 count=0; count < 9; count++){
+      AudioFreqBands.push_back(freq);
+      freq *= 2;
+   }
+   AudioBalanceOutput.setSize(AudioFreqBands.size());
+   AudioBalanceOutput.fill(0.0f);
+   AudioCorrelationOutput.setSize(AudioFreqBands.size());
+   AudioCorrelationOutput.fill(0.0f);
+   objectBandSums.setSize(AudioFreqBands.size()*3);
+   objectBandSums.fill(0.0f);
+
+   objectFramer.setup(AUDIO_FFT_FRAME_SIZE, U32(AUDIO_FFT_FRAME_SIZE*(1.0f - AUDIO_FFT_OVERLAP)), AUDIO_NUM_CHANNELS);
+   objectFramerRate = 0;
+   objectSmoothing = AUDIO_FFT_SMOOTHING;
+   objectWindow = NULL;
+   objectBandTableDirty = true;
+
+   for(U32 count=0; count<3; count++)
+      objectSums[count] = 0.0f;
+   objectPointCount = AUDIO_STEREO_POINTS;
+   objectBalance = 0.0f;
+   objectCorrelation = 0.0f;
+}
+StereoObject::~StereoObject(){
+   // acquire mutex before delete
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+}
+
+void StereoObject::setFrameSize(U32 size, F32 overlap){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   overlap = mClampF(overlap, 0.0f, 0.9f);
+   size = AudioFramer::roundFrameSize(size);
+   objectFramer.setup(size, getMax(U32(size*(1.0f - overlap)), U32(1)), AUDIO_NUM_CHANNELS);
+   objectWindow = NULL;
+   objectFramerRate = 0;
+}
+
+void StereoObject::setPointCount(U32 count){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   objectPointCount = mClamp(count, 1, AUDIO_STEREO_MAX_POINTS);
+}
+
+void StereoObject::setAudioFreqBands(Vector<U32>& bands){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   AudioFreqBands.clear();
+   AudioFreqBands.merge(bands);
+   objectBandTableDirty = true;
+
+   // band sums start again from silence
+   U32 bandsize = AudioFreqBands.size();
+   AudioBalanceOutput.setSize(bandsize);
+   AudioBalanceOutput.fill(0.0f);
+   AudioCorrelationOutput.setSize(bandsize);
+   AudioCorrelationOutput.fill(0.0f);
+   objectBandSums.setSize(bandsize*3);
+   objectBandSums.fill(0.0f);
+}
+void StereoObject::getAudioFreqBands(Vector<U32>& retbands){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   retbands.clear();
+   retbands.merge(AudioFreqBands);
+}
+
+void StereoObject::buildBandTable(){
+   U32 size = objectFramer.getFrameSize();
+   U32 bands = AudioFreqBands.size();
+   objectFirstBin.setSize(bands);
+   objectEndBin.setSize(bands);
+   objectBandBuffer.setSize(bands*3);
+
+   // band edges are the midpoints between band frequencies, same as FFTObject
+   //    narrow bands get the nearest bin
+   F32 binHz = (F32)objectSamplesPerSecond/size;
+   for(U32 index=0; index<bands; index++){
+      F32 freq = (F32)AudioFreqBands[index];
+      F32 lower = index ? (AudioFreqBands[index-1] + freq)*0.5f : 0.0f;
+      F32 upper = index != bands-1 ? (freq + AudioFreqBands[index+1])*0.5f : freq*1.5f;
+      U32 firstBin = index ? U32(mFloor(lower/binHz)) + 1 : 0;
+      U32 endBin = getMin(U32(mFloor(upper/binHz)) + 1, size/2);
+      if(firstBin >= endBin && freq < objectSamplesPerSecond*0.5f){
+         firstBin = getMin(U32(freq/binHz + 0.5f), size/2 - 1);
+         endBin = firstBin + 1;
+      }
+      objectFirstBin[index] = firstBin;
+      objectEndBin[index] = getMax(firstBin, endBin);
+   }
+
+   objectBandTableDirty = false;
+}
+
+void StereoObject::process_unique(){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   const F32* samples = getSampleData();
+   U32 samplesize = objectSampleBufferSamples;
+   if(!samples || !samplesize)
+      return;
+
+   if(objectSamplesPerSecond != objectFramerRate){
+      objectFramer.reset();
+      objectFramerRate = objectSamplesPerSecond;
+      objectBandTableDirty = true;
+      objectSmoothing = getHopSmoothing(AUDIO_FFT_SMOOTHING, objectFramer.getHopSize(), objectFramerRate);
+   }
+
+   // broadband field and goniometer points read the shared block directly
+   F32 sums[3] = { 0.0f, 0.0f, 0.0f };
+   audioStereoProducts(sums, samples, samplesize);
+   audioSmooth(objectSums, sums, getHopSmoothing(AUDIO_FFT_SMOOTHING, samplesize, objectSamplesPerSecond), 3);
+   getStereoField(objectSums[0], objectSums[1], objectSums[2], objectBalance, objectCorrelation);
+
+   U32 points = getMin(objectPointCount, samplesize);
+   objectPoints.setSize(points*2);
+   F32* point = objectPoints.address();
+   for(U32 count=0; count<points; count++){
+      const F32* frame = samples + U32(((U64)count*samplesize)/points)*AUDIO_NUM_CHANNELS;
+      point[count*2+0] = (frame[1] - frame[0])*0.70710678f;
+      point[count*2+1] = (frame[0] + frame[1])*0.70710678f;
+   }
+
+   // per band field needs both spectra, the mono mix in AudioSharedSpectrum is not enough
+   objectFramer.write(samples, samplesize);
+   const F32* frame;
+   while((frame = objectFramer.nextFrame()) != NULL){
+      processFrame(frame);
+   }
+}
+
+void StereoObject::processFrame(const F32* frame){
+   U32 size = objectFramer.getFrameSize();
+   if(!objectWindow)
+      objectWindow = AudioWindow::getTable(AUDIO_FFT_WINDOW, size);
+   if(objectBandTableDirty)
+      buildBandTable();
+
+   F32* left = objectLeftBuffer.reserve<F32>(size);
+   F32* right = objectRightBuffer.reserve<F32>(size);
+   audioStereoWindow(left, right, frame, objectWindow, AUDIO_DATA_GAIN, size);
+
+   // both transforms on the one plan
+   F32* leftSpectrum = objectLeftSpectrum.reserve<F32>(size+2);
+   F32* rightSpectrum = objectRightSpectrum.reserve<F32>(size+2);
+   AudioFFTPlan* plan = AudioFFTPlanCache::acquire(size);
+   plan->forward(left, leftSpectrum);
+   plan->forward(right, rightSpectrum);
+   AudioFFTPlanCache::release(plan);
+
+   U32 bins = size/2;
+   F32* power = objectPowerBuffer.reserve<F32>(bins*3);
+   F32* powerLeft = power;
+   F32* powerRight = power + bins;
+   F32* cross = power + bins*2;
+   audioCrossSpectrum(powerLeft, powerRight, cross, leftSpectrum, rightSpectrum, bins);
+
+   U32 bands = AudioFreqBands.size();
+   F32* bandBuffer = objectBandBuffer.address();
+   for(U32 band=0; band<bands; band++){
+      F32 sumLeft = 0.0f, sumRight = 0.0f, sumCross = 0.0f;
+      for(U32 count=objectFirstBin[band]; count<objectEndBin[band]; count++){
+         sumLeft += powerLeft[count];
+         sumRight += powerRight[count];
+         sumCross += cross[count];
+      }
+      bandBuffer[band] = sumLeft;
+      bandBuffer[bands+band] = sumRight;
+      bandBuffer[bands*2+band] = sumCross;
+   }
+
+   // smooth the sums, not the ratios, so the values settle on the average field
+   F32* bandSums = objectBandSums.address();
+   audioSmooth(bandSums, bandBuffer, objectSmoothing, bands*3);
+   for(U32 band=0; band<bands; band++)
+      getStereoField(bandSums[band], bandSums[bands+band], bandSums[bands*2+band], AudioBalanceOutput[band], AudioCorrelationOutput[band]);
+}
+
+void StereoObject::getBandBalance(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioBalanceOutput);
+}
+void StereoObject::getBandCorrelation(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioCorrelationOutput);
+}
+F32 StereoObject::getBalance(){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+   return objectBalance;
+}
+F32 StereoObject::getCorrelation(){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+   return objectCorrelation;
+}
+void StereoObject::getGoniometerPoints(Vector<F32>& retpoints){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   retpoints.clear();
+   retpoints.merge(objectPoints);
+}
+
+U32 StereoObject::getProcessedOutput(Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectStereoDataMutex, true );
+
+   retoutput.clear();
+   retoutput.merge(AudioBalanceOutput);
+   retoutput.merge(AudioCorrelationOutput);
+   retoutput.push_back(objectBalance);
+   retoutput.push_back(objectCorrelation);
+   mutex.unlock();
+
+   return getDataChanged();
+}
+
+// console
+DefineEngineMethod(StereoObject, setFrameSize, void, (U32 size, F32 overlap), (AUDIO_FFT_FRAME_SIZE, AUDIO_FFT_OVERLAP),
+   "Set the STFT frame size and overlap used for the band values, same as FFTObject.\n"
+   "@param size Frame size in samples, rounded up to a power of 2.\n"
+   "@param overlap Fraction of each frame shared with the next, 0 to 0.9.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setFrameSize(size, overlap);
+}
+
+DefineEngineMethod(StereoObject, setPointCount, void, (U32 count), (AUDIO_STEREO_POINTS),
+   "Set the number of goniometer points taken from each block.\n"
+   "@param count 1 to 4096.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setPointCount(count);
+}
+
+DefineEngineMethod(StereoObject, setAudioFreqBands, void, (const char* bandfreqstr),,
+   "Set StereoObject frequency bands, same as FFTObject.\n"
+   "@param Comma or space separated list of positive integers.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> tmpbands;
+   parseAudioFreqBands(bandfreqstr, tmpbands);
+
+   object->setAudioFreqBands(tmpbands);
+}
+
+DefineEngineMethod(StereoObject, getAudioFreqBands, const char*, (),,
+   "Get StereoObject frequency bands.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of integers.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> tmpbands;
+   object->getAudioFreqBands(tmpbands);
+
+   return formatAudioU32List(tmpbands);
+}
+
+DefineEngineMethod(StereoObject, getBandBalance, const char*, (),,
+   "Get the left/right balance of each band.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats, -1 left to 1 right.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getBandBalance(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+DefineEngineMethod(StereoObject, getBandCorrelation, const char*, (),,
+   "Get the correlation between the channels in each band.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats, 1 mono, 0 unrelated, -1 out of phase.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getBandCorrelation(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+DefineEngineMethod(StereoObject, getBalance, F32, (),,
+   "Get the left/right balance of the whole signal.\n"
+   "@param Nothing.\n"
+   "@return -1 left to 1 right.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getBalance();
+}
+
+DefineEngineMethod(StereoObject, getCorrelation, F32, (),,
+   "Get the correlation between the channels of the whole signal.\n"
+   "@param Nothing.\n"
+   "@return 1 mono, 0 unrelated, -1 out of phase.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getCorrelation();
+}
+
+DefineEngineMethod(StereoObject, getGoniometerPoints, const char*, (),,
+   "Get the goniometer points of the last block, mono is a vertical line.\n"
+   "@param Nothing.\n"
+   "@return Space separated x y pairs, x = (right-left)/sqrt(2), y = (left+right)/sqrt(2).\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmppoints;
+   object->getGoniometerPoints(tmppoints);
+
+   return formatAudioFloatList(tmppoints, "%.4f");
+}
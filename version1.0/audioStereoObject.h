@@ -0,0 +1,98 @@
+#ifndef _AUDIO_STEREO_OBJECT_H_
+#define _AUDIO_STEREO_OBJECT_H_
+
+#include "loopbackAudio.h"
+
+/*
+Stereo field analysis, everything the mono mix in FFTObject throws away.
+
+Per band (same band list as FFTObject):
+   balance      -1 all left, 0 centered, 1 all right, from the power of each channel
+   correlation  1 mono, 0 unrelated (wide), -1 out of phase, from the cross spectrum
+Broadband balance and correlation come straight from the shared sample block, as do the
+goniometer points: every Nth frame of the block rotated to mid/side so mono is a vertical
+line, x = (right-left)/sqrt(2), y = (left+right)/sqrt(2).
+
+Band values are computed from smoothed power sums so a quiet band does not flicker.
+
+The STFT framer is owned by the object rather than shared through the AudioAnalysisGraph.
+AudioSharedSpectrum frames the mono mix, which loses the channel difference this object
+measures, and no other object frames both channels, so a shared stereo framing node would
+have a single reader.
+*/
+
+#define AUDIO_STEREO_POINTS 256
+#define AUDIO_STEREO_MAX_POINTS 4096
+
+class StereoObject : public LoopBackObject
+{
+typedef LoopBackObject Parent;
+
+private:
+   // protect stereo data
+   Mutex objectStereoDataMutex;
+
+   // interleaved frames of both channels, nothing else in the graph needs them
+   AudioFramer objectFramer;
+   U32 objectFramerRate;
+   // per frame smoothing of the band sums
+   F32 objectSmoothing;
+   const F32* objectWindow;
+   // split and windowed channels, their spectra, then power left, power right and cross
+   AudioScratchBuffer objectLeftBuffer;
+   AudioScratchBuffer objectRightBuffer;
+   AudioScratchBuffer objectLeftSpectrum;
+   AudioScratchBuffer objectRightSpectrum;
+   AudioScratchBuffer objectPowerBuffer;
+   // bins objectFirstBin[n] to objectEndBin[n]-1 are summed into band n
+   Vector<U32> objectFirstBin;
+   Vector<U32> objectEndBin;
+   bool objectBandTableDirty;
+   // left power of every band, then right power, then cross, raw and smoothed
+   Vector<F32> objectBandBuffer;
+   Vector<F32> objectBandSums;
+   // smoothed broadband left power, right power and cross
+   F32 objectSums[3];
+
+   U32 objectPointCount;
+   Vector<F32> objectPoints;
+
+   Vector<U32> AudioFreqBands;
+   Vector<F32> AudioBalanceOutput;
+   Vector<F32> AudioCorrelationOutput;
+   F32 objectBalance;
+   F32 objectCorrelation;
+
+   // objectStereoDataMutex must be held
+   void buildBandTable();
+   void processFrame(const F32* frame);
+
+public:
+   StereoObject();
+   virtual ~StereoObject();
+
+   virtual void process_unique();
+
+   // set the STFT frame size (power of 2) and overlap, same as FFTObject
+   void setFrameSize(U32 size, F32 overlap);
+   // number of goniometer points taken from each block
+   void setPointCount(U32 count);
+
+   // same as FFTObject
+   void setAudioFreqBands(Vector<U32>& bands);
+   void getAudioFreqBands(Vector<U32>& retbands);
+
+   void getBandBalance(Vector<F32>& retoutput);
+   void getBandCorrelation(Vector<F32>& retoutput);
+   F32 getBalance();
+   F32 getCorrelation();
+   // x y pairs of the last block
+   void getGoniometerPoints(Vector<F32>& retpoints);
+
+   // band balance, band correlation, then broadband balance and correlation
+   virtual U32 getProcessedOutput(Vector<F32>& retoutput);
+
+   DECLARE_CONOBJECT(StereoObject);
+};
+
+#endif // _AUDIO_STEREO_OBJECT_H_
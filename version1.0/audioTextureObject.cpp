@@ -21,6 +21,21 @@
 
 extern bool gEditingMission;
 
+// waterfall palette, black through blue, red and yellow to white for levels 0 to 1
+static ColorI getWaterfallColor(F32 level){
+   static const ColorI palette[5] = {
+      ColorI(0, 0, 0, 255), ColorI(0, 0, 160, 255), ColorI(200, 0, 60, 255),
+      ColorI(255, 200, 0, 255), ColorI(255, 255, 255, 255)
+   };
+   F32 pos = mClampF(level, 0.0f, 1.0f)*4.0f;
+   U32 index = getMin(U32(pos), U32(3));
+   F32 frac = pos - index;
+   const ColorI& a = palette[index];
+   const ColorI& b = palette[index+1];
+   return ColorI(U8(a.red + (b.red - a.red)*frac), U8(a.green + (b.green - a.green)*frac),
+      U8(a.blue + (b.blue - a.blue)*frac), 255);
+}
+
 IMPLEMENT_CO_NETOBJECT_V1(AudioTextureObject);
 
 AudioTextureObject::AudioTextureObject(){
@@ -37,6 +52,18 @@ AudioTextureObject::AudioTextureObject(){
 
    mProfile = NULL;
 
+   mLoopBackObjectChanged = 0;
+
+   mDisplayMode = "scope";
+   mWaterfall = false;
+   mWaterfallRows = 256;
+   mWaterfallMin = -5.0f;
+   mWaterfallMax = 15.0f;
+   mWaterfallRow = 0;
+   mWaterfallHistoryRow = 0;
+   mWaterfallBound = false;
+   mWaterfallWarned = false;
+
    //mGeomShapeInstance = NULL;
 
    // generate UV coords for line drawing
@@ -83,6 +110,15 @@ void AudioTextureObject::initPersistFields(){
       "The target render texture." );
    addField( "geomShapeFilename",      TypeStringFilename, Offset( mGeomShapeFileName, AudioTextureObject ),
       "The path to the geometry DTS shape file." );
+   addField( "displayMode",      TypeRealString, Offset( mDisplayMode, AudioTextureObject ),
+      "\"scope\" draws the sample data, \"waterfall\" scrolls the band history of an FFTObject." );
+   addField( "waterfallRows",      TypeS32, Offset( mWaterfallRows, AudioTextureObject ),
+      "Number of FFTObject rows shown in waterfall mode (16 to 4096).  The FFTObject history must be "
+      "turned on with setHistorySize, it only has to hold the rows added between two frames." );
+   addField( "waterfallMin",      TypeF32, Offset( mWaterfallMin, AudioTextureObject ),
+      "Band output drawn as black in waterfall mode." );
+   addField( "waterfallMax",      TypeF32, Offset( mWaterfallMax, AudioTextureObject ),
+      "Band output drawn as white in waterfall mode." );
 
    endGroup( "Rendering" );
    addGroup("Control");   
@@ -138,6 +174,8 @@ void AudioTextureObject::onRemove(){
    }
 
    mLineTexture.free();
+   releaseWaterfallTarget();
+   mWaterfallTexture.free();
 
    // Remove our TSShapeInstance
    //if ( mGeomShapeInstance )
@@ -171,6 +209,10 @@ U32 AudioTextureObject::packUpdate( NetConnection *conn, U32 mask, BitStream *st
       stream->write( mTextureName );
       stream->write( mProfileName );
       stream->write( mLineTextureName );      
+      stream->write( mDisplayMode );
+      stream->write( mWaterfallRows );
+      stream->write( mWaterfallMin );
+      stream->write( mWaterfallMax );
       //stream->write( mGeomShapeFileName );   
       if(mLoopBackObject){
          stream->writeFlag(true);  
@@ -200,6 +242,10 @@ void AudioTextureObject::unpackUpdate( NetConnection *conn, BitStream *stream ){
       stream->read( &mTextureName );
       stream->read( &mProfileName );
       stream->read( &mLineTextureName );      
+      stream->read( &mDisplayMode );
+      stream->read( &mWaterfallRows );
+      stream->read( &mWaterfallMin );
+      stream->read( &mWaterfallMax );
       //stream->read( &mGeomShapeFileName );
       if( stream->readFlag() )
          stream->read( &mLoopBackObjectName );
@@ -366,6 +412,10 @@ void AudioTextureObject::updateMaterial()
       }
    }    
 
+   // the target gets its own texture back before it is looked up again, waterfall mode
+   //    binds it again on the next frame
+   releaseWaterfallTarget();
+
    if(mTextureName.isNotEmpty()){      
       
       if(mTextureTarget && !mTextureName.equal( mTextureTarget->getName(), String::NoCase )){
@@ -415,6 +465,10 @@ void AudioTextureObject::updateMaterial()
       mLineTexture.set(mLineTextureName, &GFXDefaultStaticDiffuseProfile, String("Line Texture"));
    }
 
+   mWaterfall = mDisplayMode.equal("waterfall", String::NoCase);
+   if(!mWaterfall)
+      mWaterfallTexture.free();
+
    if(mLoopBackObjectName.isNotEmpty()){
       Con::warnf("AudioTextureObject::updateMaterial : %s",mLoopBackObjectName.c_str());
       SimObject* tmpObj = Sim::findObject(mLoopBackObjectName.c_str());
@@ -498,10 +552,18 @@ void AudioTextureObject::prepRenderImage( SceneRenderState *state ){
       Con::printf("Running on server");
    */
 
+   // waterfall mode only uploads the rows added since the last frame, materials sample the
+   //    waterfall texture through the named target so nothing is drawn here
+   if(mWaterfall){
+      FFTObject* fftObj = dynamic_cast<FFTObject*>(mLoopBackObject.getObject());
+      if(mTextureTarget && fftObj && updateWaterfall(fftObj))
+         bindWaterfallTarget();
+   }
+
    Vector<F32> sourceData;
    U32 changed=0;
    LoopBackObject* tmpObj = mLoopBackObject.getObject();
-   if(tmpObj){
+   if(tmpObj && !mWaterfall){
       changed = mLoopBackObject->getAudioOutput(sourceData);
    }else{
       //Con::printf("No object to get data from.");
@@ -715,10 +777,11 @@ void AudioTextureObject::render( ObjectRenderInst *ri, SceneRenderState *state,
    GFX->setVertexBuffer( mVertexBuffer );
 
    // set texture 
+   //    in waterfall mode the target holds the waterfall texture, shown here without the V offset
    if (!mTextureTarget){      
       GFX->setTexture(0, mWarningTexture);      
    }else{
-      GFX->setTexture(0, mTexture);
+      GFX->setTexture(0, mTextureTarget->getTexture());
    }
 
    // define shader type
@@ -728,6 +791,92 @@ void AudioTextureObject::render( ObjectRenderInst *ri, SceneRenderState *state,
    GFX->drawPrimitive( GFXTriangleList, 0, 4 );      
 }
 
+bool AudioTextureObject::updateWaterfall(FFTObject* fftObj){
+   U32 rows = mClamp(mWaterfallRows, 16, AUDIO_FFT_HISTORY_MAX_ROWS);
+   if(!fftObj->getHistorySize()){
+      if(!mWaterfallWarned)
+         Con::warnf("AudioTextureObject::updateWaterfall - FFTObject history is off, call setHistorySize on it.");
+      mWaterfallWarned = true;
+      return false;
+   }
+   mWaterfallWarned = false;
+
+   U32 bands;
+   U32 count = fftObj->getHistory(mWaterfallHistoryRow, mWaterfallBuffer, bands);
+   mWaterfallHistoryRow += count;
+   if(!count || !bands)
+      return false;
+
+   if(mWaterfallTexture.isNull() || mWaterfallTexture->getWidth() != bands || mWaterfallTexture->getHeight() != rows){
+      mWaterfallTexture.set(bands, rows, GFXFormatR8G8B8A8, &GFXDynamicTextureProfile, String("Waterfall Texture"));
+      if(mWaterfallTexture.isNull())
+         return false;
+      mWaterfallRow = 0;
+
+      // start black
+      GFXLockedRect* locked = mWaterfallTexture->lock();
+      if(locked){
+         for(U32 row=0; row<rows; row++){
+            U8* dest = locked->bits + row*locked->pitch;
+            for(U32 band=0; band<bands; band++){
+               dest[band*4+0] = 0;
+               dest[band*4+1] = 0;
+               dest[band*4+2] = 0;
+               dest[band*4+3] = 255;
+            }
+         }
+         mWaterfallTexture->unlock();
+      }
+   }
+
+   // one row of texels per history row, written in place over the oldest row
+   F32 scale = 1.0f/getMax(mWaterfallMax - mWaterfallMin, 0.001f);
+   for(U32 row=0; row<count; row++){
+      RectI rect(0, mWaterfallRow, bands, 1);
+      GFXLockedRect* locked = mWaterfallTexture->lock(0, &rect);
+      if(!locked)
+         break;
+      U8* dest = locked->bits;
+      const F32* src = mWaterfallBuffer.address() + row*bands;
+      for(U32 band=0; band<bands; band++){
+         ColorI color = getWaterfallColor((src[band] - mWaterfallMin)*scale);
+         dest[band*4+0] = color.red;
+         dest[band*4+1] = color.green;
+         dest[band*4+2] = color.blue;
+         dest[band*4+3] = color.alpha;
+      }
+      GFX->getDeviceSwizzle32()->InPlace(dest, bands*4);
+      mWaterfallTexture->unlock();
+      mWaterfallRow = (mWaterfallRow + 1) % rows;
+   }
+
+   return true;
+}
+
+void AudioTextureObject::bindWaterfallTarget(){
+   if(!mTextureTarget || mWaterfallTexture.isNull())
+      return;
+
+   if(!mWaterfallBound){
+      mTargetViewport = mTextureTarget->getViewport();
+      mWaterfallBound = true;
+   }
+   mTextureTarget->setTexture(mWaterfallTexture);
+   // oldest row at the top, the material offsets V by the viewport and wraps past the end
+   mTextureTarget->setViewport(RectI(0, mWaterfallRow, mWaterfallTexture->getWidth(), mWaterfallTexture->getHeight()));
+}
+
+void AudioTextureObject::releaseWaterfallTarget(){
+   if(!mWaterfallBound)
+      return;
+
+   if(mTextureTarget){
+      mTextureTarget->setTexture(mTexture);
+      mTextureTarget->setViewport(mTargetViewport);
+   }
+   mWaterfallBound = false;
+}
+
 void AudioTextureObject::drawTriLine( F32 x1, F32 y1, F32 x2, F32 y2, const ColorI &color, F32 thickness )
 {
    GFXVertexBufferHandle<GFXVertexPC> verts( GFX, 12, GFXBufferTypeVolatile );
@@ -84,6 +84,34 @@ private:
    U32 mLoopBackObjectChanged;
    String mLoopBackObjectName;
 
+   // "scope" draws the sample data as lines, "waterfall" scrolls the band history of an FFTObject
+   String mDisplayMode;
+   bool mWaterfall;
+   // rows of history shown, band output values drawn as black and white
+   S32 mWaterfallRows;
+   F32 mWaterfallMin;
+   F32 mWaterfallMax;
+   // one texel per band, only new rows are uploaded, the row after the newest is the oldest
+   //    the named texture target points at this texture in waterfall mode so materials sample
+   //    it directly, its viewport starts at the oldest row and reaches the material as the
+   //    $rtParams constant of the texture slot.  The material shader adds rtParams.y to V and
+   //    samples with V wrap and point filtering, linear filtering blends the newest row into
+   //    the oldest at the seam, eg a CustomMaterial stateBlock with
+   //       samplerStates[0] = new GFXSamplerStateData(){ addressModeU = GFXAddressClamp;
+   //          addressModeV = GFXAddressWrap; minFilter = GFXTextureFilterPoint;
+   //          magFilter = GFXTextureFilterPoint; mipFilter = GFXTextureFilterNone; };
+   GFXTexHandle mWaterfallTexture;
+   U32 mWaterfallRow;
+   // next FFTObject history row to upload
+   U32 mWaterfallHistoryRow;
+   Vector<F32> mWaterfallBuffer;
+   // the named texture target holds mWaterfallTexture, its own texture is mTexture and its
+   //    own viewport is kept in mTargetViewport until it is given back
+   bool mWaterfallBound;
+   RectI mTargetViewport;
+   // warned that the FFTObject history is off
+   bool mWaterfallWarned;
+
 public:
    AudioTextureObject();
    virtual ~AudioTextureObject();
@@ -131,6 +159,15 @@ public:
    // render the bitmap
    void render( ObjectRenderInst *ri, SceneRenderState *state, BaseMatInstance *overrideMat );   
 
+   // upload the FFTObject history rows added since the last call, returns true if there were any
+   //    the FFTObject history has to be turned on from script with setHistorySize, it only
+   //    needs to hold the rows added between two frames, the texture keeps the rest
+   bool updateWaterfall(FFTObject* fftObj);
+   // point the named texture target at the waterfall texture with the viewport at the oldest row
+   void bindWaterfallTarget();
+   // give the named texture target back its own texture and viewport
+   void releaseWaterfallTarget();
+
    // set audio object
    void setAudioObject(LoopBackObject* aObj){
       Con::warnf("setAudioObject");
@@ -0,0 +1,69 @@
+#include "audioWindow.h"
+
+#include "math/mMath.h"
+#include "audioFFT.h"
+
+static const char* sWindowNames[AudioWindow::WindowTypeCount] = {
+   "hann",
+   "hamming",
+   "blackmanharris",
+   "flattop",
+};
+
+// cosine sum coefficients for each window type
+//    w(n) = a0 - a1*cos(x) + a2*cos(2x) - a3*cos(3x) + a4*cos(4x), x = 2*pi*n/(size-1)
+static const F64 sWindowCoefficients[AudioWindow::WindowTypeCount][5] = {
+   { 0.5, 0.5, 0.0, 0.0, 0.0 },
+   { 0.54, 0.46, 0.0, 0.0, 0.0 },
+   { 0.35875, 0.48829, 0.14128, 0.01168, 0.0 },
+   { 0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368 },
+};
+
+Mutex AudioWindow::smMutex;
+Vector<AudioWindow::Entry> AudioWindow::smEntries;
+
+F32* AudioWindow::buildTable(WindowType type, U32 size){
+   F32* table = (F32*)dMalloc_aligned(sizeof(F32)*getMax(size, U32(1)), AUDIO_SCRATCH_ALIGN);
+   const F64* a = sWindowCoefficients[type];
+   // symmetric window, same as the original hanningWindow
+   F64 step = size > 1 ? M_2PI/(F64)(size - 1) : 0.0;
+   for(U32 count=0; count<size; count++){
+      F64 x = step*count;
+      table[count] = F32(a[0] - a[1]*mCos(x) + a[2]*mCos(2.0*x) - a[3]*mCos(3.0*x) + a[4]*mCos(4.0*x));
+   }
+   return table;
+}
+
+const F32* AudioWindow::getTable(WindowType type, U32 size){
+   if(type >= WindowTypeCount)
+      type = WindowHann;
+
+   MutexHandle mutex;
+   mutex.lock( &smMutex, true );
+
+   for(U32 count=0; count<smEntries.size(); count++){
+      if(smEntries[count].type == type && smEntries[count].size == size)
+         return smEntries[count].table;
+   }
+
+   Entry entry;
+   entry.type = type;
+   entry.size = size;
+   entry.table = buildTable(type, size);
+   smEntries.push_back(entry);
+   return entry.table;
+}
+
+AudioWindow::WindowType AudioWindow::getTypeFromName(const char* name){
+   for(U32 count=0; count<WindowTypeCount; count++){
+      if(!dStricmp(name, sWindowNames[count]))
+         return (WindowType)count;
+   }
+   return WindowTypeCount;
+}
+
+const char* AudioWindow::getTypeName(WindowType type){
+   if(type >= WindowTypeCount)
+      return "";
+   return sWindowNames[type];
+}
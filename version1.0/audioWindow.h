@@ -0,0 +1,53 @@
+#ifndef _AUDIO_WINDOW_H_
+#define _AUDIO_WINDOW_H_
+
+#include "platform/platform.h"
+#include "platform/threads/mutex.h"
+#include <core/util/tVector.h>
+
+/*
+Precomputed window tables for FFT frames.
+Tables are built once per shape and size and then shared read only by every object,
+they live until shutdown.  Objects should keep the pointer rather than looking it up
+every frame.
+
+   Hann            - general purpose, the original FFTObject window
+   Hamming         - narrower main lobe, higher far side lobes
+   Blackman-Harris - very low side lobes (-92 dB), good for large dynamic range
+   Flat-top        - wide main lobe but accurate peak amplitudes
+*/
+
+class AudioWindow
+{
+public:
+   enum WindowType {
+      WindowHann = 0,
+      WindowHamming,
+      WindowBlackmanHarris,
+      WindowFlatTop,
+      WindowTypeCount
+   };
+
+private:
+   struct Entry {
+      WindowType type;
+      U32 size;
+      F32* table;
+   };
+
+   static Mutex smMutex;
+   static Vector<Entry> smEntries;
+
+   static F32* buildTable(WindowType type, U32 size);
+
+public:
+   // get the shared table for type and size, aligned for SIMD loads
+   static const F32* getTable(WindowType type, U32 size);
+
+   // script names: "hann", "hamming", "blackmanharris", "flattop"
+   //    returns WindowTypeCount if the name is unknown
+   static WindowType getTypeFromName(const char* name);
+   static const char* getTypeName(WindowType type);
+};
+
+#endif // _AUDIO_WINDOW_H_
@@ -21,13 +21,6 @@
 //#include <avrt.h>
 //#pragma comment(lib, "Avrt.lib")
 
-#include "kiss_fft/kiss_fft.h"
-#include "kiss_fft/kiss_fftr.h"
-
-#include <D3dx9core.h>
-#define INITGUID
-#include <mmdeviceapi.h>
-#undef INITGUID
 
 AudioLoopbackThread *_activeLoopbackThread = NULL;
 
@@ -40,106 +33,57 @@ AudioFilterValues are the filter values used to calcuate each band progressively
 */
 
 // static data
-Mutex AudioLoopbackThread::loopbackObjectsMutex;
-Vector<SimObjectPtr<LoopBackObject>> AudioLoopbackThread::loopbackObjects;
+Mutex AudioAnalysisThread::loopbackObjectsMutex;
+Vector<SimObjectPtr<LoopBackObject>> AudioAnalysisThread::loopbackObjects;
 
-Mutex AudioLoopbackThread::sampleBufferMutex;
-F32 *AudioLoopbackThread::sampleBuffer = NULL;
-U32 AudioLoopbackThread::sampleBufferSize = 0;
-U32 AudioLoopbackThread::sampleBufferSamples = 0;
-U32 AudioLoopbackThread::samplesPerSecond = 0;
+AudioSampleRing AudioLoopbackThread::sampleRing;
+AudioLoopbackStats AudioLoopbackThread::stats;
+Semaphore AudioLoopbackThread::ringFree(1);
 
-AudioLoopbackThread::AudioLoopbackThread(bool start_thread, bool autodelete)
+AudioLoopbackThread::AudioLoopbackThread(AudioCaptureSource* source, bool start_thread, bool autodelete)
 :Thread(NULL,NULL,start_thread,autodelete)
 {
-   hnsRequestedDuration = REFTIMES_PER_SEC;
-   pEnumerator = NULL;
-   pDevice = NULL;
-   pAudioClient = NULL;
-   pCaptureClient = NULL;
-   pwfx = NULL;
-   packetLength = 0;    
+   // wait for a stopped thread that is still shutting down
+   ringFree.acquire(true);
+
+   mSource = source;
+
+   // use the SIMD kernels and fastest FFT the processor has
+   installAudioKernels();
+   AudioFFTPlanCache::getSelectedBackend();
 
-   internalSampleData = NULL;
+   // the ring is allocated once and kept, registered objects hold a pointer to it
+   if(!sampleRing.isAllocated())
+      sampleRing.allocate(AUDIO_RING_FRAMES, AUDIO_NUM_CHANNELS);
+
+   mAnalysis = new AudioAnalysisThread(&sampleRing);
 }
 
 AudioLoopbackThread::~AudioLoopbackThread(){
    // free memory
-   if(internalSampleData)
-      free(internalSampleData);  
+   if(mSource)
+      delete mSource;
 
-   //Con::printf("Deallocating LoopBackObject::sampleBuffer");
-   
-   MutexHandle mutex;
-   mutex.lock( &sampleBufferMutex, true );
-   sampleBufferSize = 0;
-   sampleBufferSamples = 0;
-   samplesPerSecond = 0;
-   if(sampleBuffer){
-      free(sampleBuffer);
-      sampleBuffer = NULL;
-   }
-   
-   //Con::printf("Done Deallocating LoopBackObject::sampleBuffer");
+   // stopped in run, waits for the worker threads to exit
+   delete mAnalysis;
+
+   ringFree.release();
 }
 
 void AudioLoopbackThread::run(void *arg /* = 0 */)
 {      
    // init audio device
-   hr = CoCreateInstance(
-      __uuidof(MMDeviceEnumerator), 
-      NULL, CLSCTX_ALL, 
-      __uuidof(IMMDeviceEnumerator),
-      (void**)&pEnumerator);
-   AUDIOLB_EXIT_ON_ERROR(hr)
-
-   hr = pEnumerator->GetDefaultAudioEndpoint(
-      eRender, eConsole, &pDevice); // eCapture changed to eRender for loopback
-   AUDIOLB_EXIT_ON_ERROR(hr)
-
-   hr = pDevice->Activate(
-      __uuidof(IAudioClient), 
-      CLSCTX_ALL, NULL, 
-      (void**)&pAudioClient);
-   AUDIOLB_EXIT_ON_ERROR(hr)
-
-   hr = pAudioClient->GetMixFormat(&pwfx);
-   AUDIOLB_EXIT_ON_ERROR(hr)
-
-   // ensure format is something we can use
-   if(pwfx->wFormatTag == WAVE_FORMAT_IEEE_FLOAT){
-      if(pwfx->nChannels < AUDIO_NUM_CHANNELS) // need stereo
-         hr = -1;
-   }else if(pwfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE){
-      PWAVEFORMATEXTENSIBLE pEx = reinterpret_cast<PWAVEFORMATEXTENSIBLE>(pwfx);
-      if(IsEqualGUID(KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, pEx->SubFormat)){
-         if(pwfx->nChannels < AUDIO_NUM_CHANNELS) // need stereo
-            hr = -1;
-      }else{
-         hr = -1;
-      }
-   }else{
-      hr = -1;      
+   if(!mSource || !mSource->open()){
+      // debug, not really thread safe
+      Con::warnf("AudioLoopbackThread::run - could not open capture source.");
+      return;
    }
-   AUDIOLB_EXIT_ON_ERROR(hr)
-
-   hr = pAudioClient->Initialize(
-      AUDCLNT_SHAREMODE_SHARED,
-      AUDCLNT_STREAMFLAGS_LOOPBACK, // 0 changed to AUDCLNT_STREAMFLAGS_LOOPBACK for loopback
-      hnsRequestedDuration,
-      0,
-      pwfx,
-      NULL);
-   AUDIOLB_EXIT_ON_ERROR(hr)
-
-   // Get the size of the allocated buffer.
-   hr = pAudioClient->GetBufferSize(&bufferFrameCount);
-   AUDIOLB_EXIT_ON_ERROR(hr)
-
-   hr = pAudioClient->GetService(
-      __uuidof(IAudioCaptureClient),
-      (void**)&pCaptureClient);
-   AUDIOLB_EXIT_ON_ERROR(hr)
+   sampleRing.reset(mSource->getSamplesPerSecond());
+   stats.reset();
+
+   // analysis runs beside the capture and only talks to it through the ring
+   mAnalysis->reset();
+   mAnalysis->start();
 
    // register with MMCSS
    // I think this controls priority to be realtime, might need this
@@ -152,157 +96,241 @@ void AudioLoopbackThread::run(void *arg /* = 0 */)
    } 
    */  
 
-   // format is in pwfx
+   // thread control loop
+   while(!checkForStop()){            
+      if(!processCapture())
+         break;
+   }   
 
-   // Calculate the actual duration of the allocated buffer.
-   hnsActualDuration = (double)REFTIMES_PER_SEC * bufferFrameCount / pwfx->nSamplesPerSec;
+   // wake the analysis thread so it sees the stop
+   mAnalysis->stop();
+   mAnalysis->signalData();
+   mAnalysis->join();
 
-   hr = pAudioClient->Start();  // Start recording.
-   AUDIOLB_EXIT_ON_ERROR(hr)
+   // clean up init
+   mSource->close();
+   //if(hTask)
+   //   AvRevertMmThreadCharacteristics(hTask);
+}
 
-   // freq per bin in FFT
-   // Fs/N where Fs=sample rate N=FFT width
-   // ignore upper half of FFT output   
+bool AudioLoopbackThread::processCapture(){
+   // realtime sources sleep here
+   mSource->waitForData();
 
-   F32 summing_buffer[AUDIO_FREQ_BANDS];
-   U32 samplesize = 0; 
-   U32 buffersize = 0;  
+   // source writes straight into the ring
+   if(!mSource->read(sampleRing))
+      return false;
+   stats.discontinuities = mSource->getDiscontinuities();
 
-   // thread control loop
-   while(!checkForStop()){            
-      Sleep(hnsActualDuration/REFTIMES_PER_MILLISEC/2);      
-
-      hr = pCaptureClient->GetNextPacketSize(&packetLength);
-      AUDIOLB_EXIT_ON_ERROR(hr)      
-
-      // clear summing buffer      
-      for(U32 count=0; count<AUDIO_FREQ_BANDS; count++){
-         summing_buffer[count] = 0.0f;
-      }    
-
-      //sum_divisor = 0;  
-      samplesize = 0;      
-
-      while(packetLength != 0)
-      {        
-         // Get the available data in the shared buffer.
-         hr = pCaptureClient->GetBuffer(
-            &pData,
-            &numFramesAvailable,
-            &flags, NULL, NULL);
-         AUDIOLB_EXIT_ON_ERROR(hr)
-
-         if (flags & AUDCLNT_BUFFERFLAGS_SILENT)
-         {
-             pData = NULL;  // Tell CopyData to write silence.
-         }               
-
-         // grab and manipulate data here
-         #define TEMP_LB_FILTER_VAL 0.1f
-         #define TEMP_LB_GAIN 1.0f
-         
-         if(pData != NULL){
-            U32 currentindex = samplesize;
-            samplesize += packetLength;            
-            if(samplesize > buffersize || internalSampleData == NULL){               
-               buffersize = samplesize;
-               internalSampleData = (F32 *)realloc(internalSampleData, sizeof(F32)*buffersize*AUDIO_NUM_CHANNELS);               
-               //Con::printf("%d", buffersize);  // verify allocation is working
-            }
-            
-            F32 *pFloatData = reinterpret_cast<F32*>(pData);
-            //Con::printf("packetlength: %d",packetLength);                   
-            
-            for(U32 count=0; count<packetLength; count++){               
-               internalSampleData[currentindex*AUDIO_NUM_CHANNELS+count*AUDIO_NUM_CHANNELS+0] = pFloatData[count*pwfx->nChannels+0];
-               internalSampleData[currentindex*AUDIO_NUM_CHANNELS+count*AUDIO_NUM_CHANNELS+1] = pFloatData[count*pwfx->nChannels+1];               
-            }                        
-         }else{
-            // do calcs with zero for values
-            // not needed, the value will zero out after audio source is removed
-         }                    
-      
-         // release data
-         hr = pCaptureClient->ReleaseBuffer(numFramesAvailable);
-         AUDIOLB_EXIT_ON_ERROR(hr)
-
-         // start next capture
-         hr = pCaptureClient->GetNextPacketSize(&packetLength);
-         AUDIOLB_EXIT_ON_ERROR(hr)
-      }      
-      
-      //Con::printf("%d",samplesize);
-      if(!samplesize)
+   // make the packet visible
+   U32 frames = sampleRing.getPendingFrames();
+   //Con::printf("%d",frames);
+   if(!frames)
+      return true;
+   sampleRing.publish();
+   stats.capturePackets++;
+   stats.captureFrames += frames;
+
+   mAnalysis->signalData();
+
+   return true;
+}
+
+bool AudioLoopbackThread::runHops(U32 hops){
+   if(!mSource || !mSource->open())
+      return false;
+   sampleRing.reset(mSource->getSamplesPerSecond());
+   stats.reset();
+   mAnalysis->reset();
+
+   bool result = true;
+   for(U32 count=0; count<hops && result; count++){
+      result = processCapture();
+      mAnalysis->processAvailable();
+   }
+
+   mSource->close();
+   return result;
+}
+
+// analysis
+AudioAnalysisThread::AudioAnalysisThread(AudioSampleRing* ring)
+:Thread(NULL,NULL,false,false)
+{
+   mRing = ring;
+   mReadIndex = 0;
+   mSequence = 0;
+
+   // dedicated pool so we do not compete with the engine's global pool work
+   //    zero threads lets the pool pick based on processor count
+   mProcessPool = new ThreadPool("AudioLoopBack", 0);
+}
+
+AudioAnalysisThread::~AudioAnalysisThread(){
+   // waits for the worker threads to exit
+   delete mProcessPool;
+}
+
+void AudioAnalysisThread::reset(){
+   mReadIndex = mRing->getWriteIndex();
+   mSequence = 0;
+   // drop wakeups left over from a previous run
+   while(mDataReady.acquire(false));
+}
+
+void AudioAnalysisThread::run(void *arg /* = 0 */)
+{
+   AudioLoopbackStats& stats = AudioLoopbackThread::getStats();
+
+   while(!checkForStop()){
+      if(!mDataReady.acquire(true, AUDIO_ANALYSIS_TIMEOUT_MS)){
+         // capture has gone quiet, WASAPI loopback delivers nothing while the device is idle
+         stats.underruns++;
          continue;
+      }
+      // wakeups for packets already drained by an earlier pass are ignored
+      processAvailable();
+   }
+}
+
+bool AudioAnalysisThread::processAvailable(){
+   AudioLoopbackStats& stats = AudioLoopbackThread::getStats();
+
+   U32 writeIndex = mRing->getWriteIndex();
+   U32 backlog = writeIndex - mReadIndex;
+   if(!backlog)
+      return false;
+
+   U32 frames = mRing->clampReadIndex(mReadIndex, writeIndex);
+   U32 maxFrames = (mRing->getSamplesPerSecond()*AUDIO_ANALYSIS_MAX_BACKLOG_MS)/1000;
+   if(frames > maxFrames){
+      // too far behind to be useful for display, jump to the newest packet
+      U32 keep = getMin(mRing->getLastPacketFrames(), maxFrames);
+      mReadIndex += frames - keep;
+      frames = keep;
+   }
+   if(frames < backlog){
+      stats.overruns++;
+      stats.droppedFrames += backlog - frames;
+   }else{
+      stats.maxBacklog = getMax(U32(stats.maxBacklog), backlog);
+   }
+
+   // copy once, every object shares this block
+   //    everything published since the last pass is processed together so a slow pass catches up
+   AudioSampleBlockRef block = AudioSampleBlock::create(*mRing, mReadIndex, frames, mSequence++);
+   mReadIndex += frames;
 
-      // resize external buffer as needed
-      // access to the external buffer is controlled by mutex      
-      MutexHandle mutex;
-      mutex.lock( &sampleBufferMutex, true );
-      if(buffersize > sampleBufferSize){
-         sampleBufferSize = buffersize;
-         sampleBuffer = (F32 *)realloc(sampleBuffer, sizeof(F32)*sampleBufferSize*AUDIO_NUM_CHANNELS);    
+   // process loopback objects
+   //LoopBackObject::processLoopBack();      
+   //    the mutex keeps objects from being deleted until the whole hop is done
+   MutexHandle mutex;
+   mutex.lock( &loopbackObjectsMutex, true );
+   mProcessList.clear();
+   Vector<SimObjectPtr<LoopBackObject>>::iterator i; 
+   for(i = loopbackObjects.begin(); i != loopbackObjects.end();)  
+   {  
+      LoopBackObject *obj = (*i); // (LoopBackObject *)
+      if(!obj){ 
+         loopbackObjects.remove(*i);
+         continue;
       }
-      // copy sample details
-      samplesPerSecond = pwfx->nSamplesPerSec;
-      sampleBufferSamples = samplesize;      
-      // copy raw sample data to LoopBackObject buffer
-      memcpy(sampleBuffer,internalSampleData,sizeof(F32)*samplesize*AUDIO_NUM_CHANNELS);      
-      mutex.unlock();
-
-      // process loopback objects
-      //LoopBackObject::processLoopBack();      
-      mutex.lock( &loopbackObjectsMutex, true );
-      Vector<SimObjectPtr<LoopBackObject>>::iterator i; 
-      for(i = loopbackObjects.begin(); i != loopbackObjects.end();)  
-      {  
-         LoopBackObject *obj = (*i); // (LoopBackObject *)
-         if(!obj){ 
-            loopbackObjects.remove(*i);
-            continue;
-         }
-         else
-            i++;
-            
-         obj->process();
-      } 
-      mutex.unlock();            
-   }   
+      else
+         i++;
+         
+      mProcessList.push_back(obj);
+   } 
+   processObjects(block);
+   mutex.unlock();            
 
-   hr = pAudioClient->Stop();  // Stop recording.
-   AUDIOLB_EXIT_ON_ERROR(hr)
+   stats.analysisBlocks++;
+   stats.analysisFrames += frames;
 
-Exit:
+   return true;
+}
 
-   if(FAILED(hr)){
-      // debug, not really thread safe
-      Con::warnf("AudioLoopbackThread::run - loopback error: %X",hr);
+// work item for the loopback pool, all items of one hop share the same job
+class LoopBackProcessItem : public ThreadPool::WorkItem
+{
+   typedef ThreadPool::WorkItem Parent;
+
+   LoopBackProcessJob* mJob;
+
+public:
+   LoopBackProcessItem(LoopBackProcessJob* job){ mJob = job; }
+
+protected:
+   virtual void execute(){
+      mJob->processChunks();
+      // last one out releases the analysis thread
+      if(dFetchAndAdd(mJob->pending, U32(-1)) == 1)
+         mJob->done.release();
+   }
+};
+
+void LoopBackProcessJob::processChunks(){
+   for(;;){
+      U32 start = dFetchAndAdd(next, chunk);
+      if(start >= count)
+         break;
+      U32 end = getMin(start + chunk, count);
+      for(U32 index=start; index<end; index++){
+         objects[index]->process(block);
+      }
    }
+}
 
-   // clean up init
-   CoTaskMemFree(pwfx);
-   AUDIOLB_SAFE_RELEASE(pEnumerator)
-   AUDIOLB_SAFE_RELEASE(pDevice)
-   AUDIOLB_SAFE_RELEASE(pAudioClient)
-   AUDIOLB_SAFE_RELEASE(pCaptureClient)   
-   //if(hTask)
-   //   AvRevertMmThreadCharacteristics(hTask);
+void AudioAnalysisThread::processObjects(AudioSampleBlock* block){
+   U32 count = mProcessList.size();
+   if(!count)
+      return;
+
+   // not worth the hand off for a few objects
+   U32 workers = mProcessPool->getNumThreads();
+   if(count < AUDIO_PARALLEL_MIN_OBJECTS || workers < 2){
+      for(U32 index=0; index<count; index++){
+         mProcessList[index]->process(block);
+      }
+      return;
+   }
+
+   LoopBackProcessJob& job = mProcessJob;
+   job.block = block;
+   job.objects = mProcessList.address();
+   job.count = count;
+   // several chunks per worker to balance uneven objects, cheap objects still get batched
+   job.chunk = getMax(count/(workers*8), U32(1));
+   job.next = 0;
+
+   // this thread works on the list too, it counts as one of the workers
+   U32 items = getMin(workers, count) - 1;
+   job.pending = items;
+   for(U32 index=0; index<items; index++){
+      mProcessPool->queueWorkItem(new LoopBackProcessItem(&job));
+   }
+   job.processChunks();
+
+   // per hop barrier, every object is done before the next packet is read
+   if(items)
+      job.done.acquire();
 }
 
-void AudioLoopbackThread::addLoopbackObject(LoopBackObject* obj){
+void AudioAnalysisThread::addLoopbackObject(LoopBackObject* obj){
    MutexHandle mutex;
    mutex.lock( &loopbackObjectsMutex, true );
+   if(obj->hasRemoveFunction()){
+      Con::warnf("AudioAnalysisThread::addLoopbackObject - object is already associated with a sample source.  Remove the object form that source first.");
+      return;
+   }
    loopbackObjects.push_back(obj); 
 
-   obj->setExtSampleBuffer(&sampleBufferMutex, &sampleBuffer, &sampleBufferSize, &sampleBufferSamples, &samplesPerSecond);
-   obj->setRemoveFunction(AudioLoopbackThread::removeLoopbackObject);
+   obj->setRemoveFunction(AudioAnalysisThread::removeLoopbackObject);
 }   
-void AudioLoopbackThread::removeLoopbackObject(LoopBackObject* obj){
+void AudioAnalysisThread::removeLoopbackObject(LoopBackObject* obj){
    MutexHandle mutex;
    mutex.lock( &loopbackObjectsMutex, true );
    loopbackObjects.remove(obj);   
 
-   obj->clearExtSampleBuffer();
    obj->setRemoveFunction(NULL);
 }
 
@@ -312,15 +340,8 @@ IMPLEMENT_CONOBJECT(LoopBackObject);
 // functions
 LoopBackObject::LoopBackObject(){
    //objectSampleFilter = 0.2f;
-   objectSampleBufferSize = 0;
    objectSampleBufferSamples = 0;
-   objectSampleBuffer = NULL;
-
-   extSampleBufferMutex = NULL;
-   extSampleBuffer = NULL;
-   extSampleBufferSize = NULL;
-   extSampleBufferSamples = NULL;
-   extSamplesPerSecond = NULL;
+   objectSamplesPerSecond = 0;
 
    removeFunc = NULL;  
 
@@ -335,52 +356,32 @@ LoopBackObject::~LoopBackObject(){
    MutexHandle objectMutex;
    objectMutex.lock( &objectSampleBufferMutex, true );  
 
-   free(objectSampleBuffer); 
+   // drop reference to the shared block
+   objectSampleBlock = NULL; 
 
    // this printf will crash the engine is a large number of objects are deleted at once
    //Con::printf("LoopBackObject::~LoopBackObject() - acquired objectSampleBufferMutex mutex.");
 }
 
-void LoopBackObject::process(){
+void LoopBackObject::onRemove(){
+   // waits for the current hop if the object is being processed
+   if(removeFunc != NULL)
+      removeFunc(this);
+
+   Parent::onRemove();
+}
+
+void LoopBackObject::process(AudioSampleBlock* block){
    //Con::printf("LoopBackObject::process() - Processing audio data: %d",this->getId());
        
-   if(!extSampleBufferMutex){
-      Con::warnf("LoopBackObject::process() - This object not properly associated with a sample source.");
-   }
-
    // get object sample buffer
    MutexHandle objectMutex;
    objectMutex.lock( &objectSampleBufferMutex, true );
 
-   // get global sample buffer
-   MutexHandle mutex;
-   mutex.lock( extSampleBufferMutex, true );
-
-   // resize buffer as needed
-   if(*extSampleBufferSize > objectSampleBufferSize){
-      //U32 diff = sampleBufferSize - objectSampleBufferSize;
-      objectSampleBufferSize = *extSampleBufferSize;
-      objectSampleBuffer = (F32 *)realloc(objectSampleBuffer, sizeof(F32)*objectSampleBufferSize*AUDIO_NUM_CHANNELS);          
-      // init new memory
-      /*
-      for(U32 count=(objectSampleBufferSize-diff)*AUDIO_NUM_CHANNELS; count < objectSampleBufferSize*AUDIO_NUM_CHANNELS; count++){
-         objectSampleBuffer[count] = 0.0f;            
-      }
-      */
-   }
-   objectSampleBufferSamples = *extSampleBufferSamples;
-   objectSamplesPerSecond = *extSamplesPerSecond;
-   /*
-   // filter sample data using lowPassFilter - not a good idea
-   for(U32 count=0; count < objectSampleBufferSamples*AUDIO_NUM_CHANNELS; count++){
-      objectSampleBuffer[count] = lowPassFilter(sampleBuffer[count],objectSampleBuffer[count],objectSampleFilter);
-   } 
-   */  
-   // copy sample data
-   memcpy(objectSampleBuffer,*extSampleBuffer,sizeof(F32)*objectSampleBufferSamples*AUDIO_NUM_CHANNELS);   
-
-   // done with global sample buffer
-   mutex.unlock();
+   // share the block, no copy
+   objectSampleBlock = block;
+   objectSampleBufferSamples = block->getFrames();
+   objectSamplesPerSecond = block->getSamplesPerSecond();
 
    // now perform additional processing on sample data
    // keeps from needing to reacquire mutex or call additional functions
@@ -393,38 +394,6 @@ void LoopBackObject::process(){
    objectMutex.unlock();   
 }
 
-// use objectSampleBufferMutex to protect this call
-void LoopBackObject::setExtSampleBuffer(Mutex* extmut, F32** extbuff, U32* extbuffsize, U32* extbuffsamples, U32* extsamplessecond){
-   if(extSampleBufferMutex){
-      Con::warnf("LoopBackObject::setExtSampleBuffer - object is already associated with a sample source.  Remove the object form that source first.");
-      return;
-   }
-
-   MutexHandle objectMutex;
-   objectMutex.lock( &objectSampleBufferMutex, true );
-
-   extSampleBufferMutex = extmut;
-   extSampleBuffer = extbuff;
-   extSampleBufferSize = extbuffsize;
-   extSampleBufferSamples = extbuffsamples;
-   extSamplesPerSecond = extsamplessecond;
-}
-void LoopBackObject::clearExtSampleBuffer(){
-   if(!extSampleBufferMutex){
-      Con::warnf("LoopBackObject::clearExtSampleBuffer - object is not associated with a sample source.");
-      return;
-   }
-
-   MutexHandle objectMutex;
-   objectMutex.lock( &objectSampleBufferMutex, true );
-
-   extSampleBufferMutex = NULL;
-   extSampleBuffer = NULL;
-   extSampleBufferSize = NULL;
-   extSampleBufferSamples = NULL;
-   extSamplesPerSecond = NULL;
-}
-
 // FFT Object
 IMPLEMENT_CONOBJECT(FFTObject);
 
@@ -437,6 +406,22 @@ FFTObject::FFTObject(){
    }
    AudioFreqOutput.setSize(AudioFreqBands.size());
    AudioFreqOutput.fill(0.0f);
+   objectAttackTimes.setSize(AudioFreqBands.size());
+   objectAttackTimes.fill(AUDIO_FFT_ATTACK_MS);
+   objectReleaseTimes.setSize(AudioFreqBands.size());
+   objectReleaseTimes.fill(AUDIO_FFT_RELEASE_MS);
+
+   objectOverlap = AUDIO_FFT_OVERLAP;
+   objectFrameSize = AUDIO_FFT_FRAME_SIZE;
+   objectHopSize = U32(AUDIO_FFT_FRAME_SIZE*(1.0f - AUDIO_FFT_OVERLAP));
+   objectWindowType = AUDIO_FFT_WINDOW;
+   objectSpectrum = NULL;
+   objectFramerRate = 0;
+   objectBandTableDirty = true;
+
+   objectHistoryRows = 0;
+   objectHistoryBands = 0;
+   objectHistoryCount = 0;
 }
 FFTObject::~FFTObject(){
    // acquire mutex before delete
@@ -445,6 +430,8 @@ FFTObject::~FFTObject(){
 
    // this printf will crash the engine is a large number of objects are deleted at once
    //Con::printf("FFTObject::~FFTObject() - acquired objectFFTDataMutex mutex.");
+
+   AudioAnalysisGraph::releaseNode(objectSpectrum);
 }
 // custom processing for FFT 
 void FFTObject::process_unique(){
@@ -453,67 +440,188 @@ void FFTObject::process_unique(){
    MutexHandle mutex;
    mutex.lock( &objectFFTDataMutex, true ); 
     
+   const F32* samples = getSampleData();
    U32 samplesize = objectSampleBufferSamples;
-   samplesize &= ~0x1; // force even
-
-   //Con::printf("samplesize: %d",samplesize);
+   if(!samples || !samplesize)
+      return;
 
-   // make mono and window the data in place
-   F32 packed;
-   for(U32 count=0; count<samplesize; count++){           
-      packed = (objectSampleBuffer[count*AUDIO_NUM_CHANNELS+0] + objectSampleBuffer[count*AUDIO_NUM_CHANNELS+1])*AUDIO_DATA_GAIN;       
-      objectSampleBuffer[count] = hanningWindow(packed, count, samplesize);         
+   if(objectSamplesPerSecond != objectFramerRate){
+      objectFramerRate = objectSamplesPerSecond;
+      // smoothing coefficients depend on the hop and rate
+      objectBandTableDirty = true;
+   }
+   if(!objectSpectrum)
+      objectSpectrum = AudioSharedSpectrum::find(objectFrameSize, objectHopSize, objectWindowType);
+
+   // the framing and FFTs are done once per block for every object with these settings
+   //    every complete frame updates the output, a block can hold none or several
+   U32 frames;
+   const F32* power = objectSpectrum->lock(objectSampleBlock, frames);
+   for(U32 count=0; count<frames; count++){
+      processSpectrum(power + count*objectSpectrum->getBins());
    }
+   objectSpectrum->unlock();
+}
 
-   // these buffers should be able to grow rather than alloc new and deleting
-   //    todo: make these grow, a max size will be reached and not need to grow bigger
-   kiss_fftr_cfg st = kiss_fftr_alloc(samplesize,0,0,0);            
-   kiss_fft_cpx* out = (kiss_fft_cpx*)malloc(sizeof(kiss_fft_cpx)*(samplesize/2+1));
-   kiss_fftr(st,objectSampleBuffer,(kiss_fft_cpx*)out);  
-   
-   // combine freqs into bands
-   U32 bandstep = 0;
-   U32 binsperband = 0;
-   U32 currentfreqbin = 0;
+void FFTObject::processSpectrum(const F32* power){
+   if(objectBandTableDirty)
+      buildBandTable();
 
-   Vector<F32> summing_buffer;
+   // combine freqs into bands, each band is a contiguous run of bins
+   Vector<F32>& summing_buffer = objectBandBuffer;
    summing_buffer.setSize(AudioFreqOutput.size()); 
-   summing_buffer.fill(0.0f); 
-   for(U32 count=0; count<(samplesize/2) && bandstep<AudioFreqBands.size();){ 
-      // update value              
-      F32 combined = out[count].r * out[count].r + out[count].i * out[count].i;
-      binsperband++;
-      summing_buffer[bandstep] += combined;
-      
-      // increment and ready comparison data
+   const U32* edges = objectBandEdges.address();
+   for(U32 band=0; band<AudioFreqBands.size(); band++){
+      F32 sum = 0.0f;
+      for(U32 count=edges[band]; count<edges[band+1]; count++){
+         sum += power[count];
+      }
+      // dividing by the number of bins in the band messes up the response on the high end
+      summing_buffer[band] = sum;
+   }
+
+   // log and smooth into the output
+   //    empty bands log to a large negative value rather than -inf so the filter recovers
+   audioLog(summing_buffer.address(), summing_buffer.address(), 1.0f, AudioFreqBands.size());
+   audioSmoothAttackRelease(AudioFreqOutput.address(), summing_buffer.address(), objectAttackCoefs.address(),
+      objectReleaseCoefs.address(), AudioFreqBands.size());
+
+   if(objectHistoryRows)
+      pushHistory();
+}
+
+void FFTObject::setAttackRelease(F32 attackMs, F32 releaseMs, S32 band){
+   MutexHandle mutex;
+   mutex.lock( &objectFFTDataMutex, true );
+
+   attackMs = getMax(attackMs, 0.0f);
+   releaseMs = getMax(releaseMs, 0.0f);
+   for(U32 count=0; count<objectAttackTimes.size(); count++){
+      if(band < 0 || U32(band) == count){
+         objectAttackTimes[count] = attackMs;
+         objectReleaseTimes[count] = releaseMs;
+      }
+   }
+   objectBandTableDirty = true;
+}
+
+bool FFTObject::getAttackRelease(U32 band, F32& attackMs, F32& releaseMs){
+   MutexHandle mutex;
+   mutex.lock( &objectFFTDataMutex, true );
+
+   if(band >= objectAttackTimes.size())
+      return false;
+   attackMs = objectAttackTimes[band];
+   releaseMs = objectReleaseTimes[band];
+   return true;
+}
+
+void FFTObject::pushHistory(){
+   U32 bands = AudioFreqOutput.size();
+   if(bands != objectHistoryBands){
+      // new band layout, the old rows do not line up with it
+      objectHistoryBands = bands;
+      objectHistory.setSize(objectHistoryRows*bands);
+      objectHistory.fill(0.0f);
+      objectHistoryCount = 0;
+   }
+   F32* row = objectHistory.address() + (objectHistoryCount % objectHistoryRows)*bands;
+   dMemcpy(row, AudioFreqOutput.address(), sizeof(F32)*bands);
+   objectHistoryCount++;
+}
+
+void FFTObject::setHistorySize(U32 rows){
+   MutexHandle mutex;
+   mutex.lock( &objectFFTDataMutex, true );
+
+   rows = getMin(rows, U32(AUDIO_FFT_HISTORY_MAX_ROWS));
+   if(rows == objectHistoryRows)
+      return;
+   objectHistoryRows = rows;
+   // start over, rebuilt with the current band count on the next frame
+   objectHistory.clear();
+   objectHistoryBands = 0;
+   objectHistoryCount = 0;
+}
+
+U32 FFTObject::getHistory(U32& startRow, Vector<F32>& retrows, U32& retbands){
+   MutexHandle mutex;
+   mutex.lock( &objectFFTDataMutex, true );
+
+   retrows.clear();
+   retbands = objectHistoryBands;
+   if(!objectHistoryRows || !objectHistoryBands)
+      return 0;
+
+   // rows older than the history (or from before it was cleared) are skipped
+   U32 stored = getMin(objectHistoryCount, objectHistoryRows);
+   if(objectHistoryCount - startRow > stored)
+      startRow = objectHistoryCount - stored;
+   U32 rows = objectHistoryCount - startRow;
+
+   // at most two contiguous runs
+   retrows.setSize(rows*objectHistoryBands);
+   U32 first = startRow % objectHistoryRows;
+   U32 span = getMin(rows, objectHistoryRows - first);
+   dMemcpy(retrows.address(), objectHistory.address() + first*objectHistoryBands, sizeof(F32)*span*objectHistoryBands);
+   if(span < rows)
+      dMemcpy(retrows.address() + span*objectHistoryBands, objectHistory.address(), sizeof(F32)*(rows - span)*objectHistoryBands);
+
+   return rows;
+}
+
+bool FFTObject::getHistoryRow(U32 age, Vector<F32>& retoutput){
+   MutexHandle mutex;
+   mutex.lock( &objectFFTDataMutex, true );
+
+   retoutput.clear();
+   if(age >= getMin(objectHistoryCount, objectHistoryRows))
+      return false;
+   U32 row = (objectHistoryCount - 1 - age) % objectHistoryRows;
+   const F32* src = objectHistory.address() + row*objectHistoryBands;
+   for(U32 count=0; count<objectHistoryBands; count++)
+      retoutput.push_back(src[count]);
+   return true;
+}
+
+void FFTObject::buildBandTable(){
+   U32 samplesize = objectFrameSize;
+   U32 bands = AudioFreqBands.size();
+   objectBandEdges.setSize(bands+1);
+   objectBandEdges[0] = 0;
+
+   // walk the bins once, a band ends at the first bin past the midpoint to the next band
+   U32 bandstep = 0;
+   for(U32 count=0; count<(samplesize/2) && bandstep<bands;){ 
       count++;
-      currentfreqbin = (count*objectSamplesPerSecond)/samplesize;      
+      U32 currentfreqbin = U32(((U64)count*objectSamplesPerSecond)/samplesize);
       U32 tempFreq;
 
       // discriminate frequencies as a center freq for each band
-      if(bandstep != AudioFreqBands.size()-1){
+      if(bandstep != bands-1){
          tempFreq = (AudioFreqBands[bandstep]+AudioFreqBands[bandstep+1])/2;
       }else{
          tempFreq = AudioFreqBands[bandstep]+AudioFreqBands[bandstep]/2;
       }
       if(currentfreqbin > tempFreq){ 
-         // divide magnitude of each band by the number of bins that it took to build the band          
-         //summing_buffer[bandstep] /= (F32)binsperband; // messes up the response on the high end
-         binsperband = 0;      
          bandstep++;
+         objectBandEdges[bandstep] = count;
       }
    }
+   // the last band reached takes the rest of the bins, bands above nyquist get none
+   for(U32 band=bandstep+1; band<=bands; band++){
+      objectBandEdges[band] = samplesize/2;
+   }
 
-   if(st)
-      kiss_fft_free(st);
-   if(out)
-      free(out);
+   // the same response per unit of time no matter the hop size
+   objectAttackCoefs.setSize(bands);
+   objectReleaseCoefs.setSize(bands);
+   for(U32 band=0; band<bands; band++){
+      objectAttackCoefs[band] = getHopCoefficient(objectAttackTimes[band], objectHopSize, objectSamplesPerSecond);
+      objectReleaseCoefs[band] = getHopCoefficient(objectReleaseTimes[band], objectHopSize, objectSamplesPerSecond);
+   }
 
-   for(U32 count=0; count<AudioFreqBands.size(); count++){
-      F32 logged = (F32)mLog(summing_buffer[count]);
-      
-      AudioFreqOutput[count] = lowPassFilter(logged,AudioFreqOutput[count],0.5f);            
-   }   
+   objectBandTableDirty = false;
 }
 
 // window functions
@@ -530,14 +638,21 @@ inline F32 lowPassFilter(F32 input, F32 last, F32 filter)
    return last + filter * (input - last);
 }
 
-DefineEngineFunction( startAudioLoopBack, void, (),,
-   "Get the frequency information from processing the current AudioLoopBack\n"
-   "@param No parameters.\n"
+DefineEngineFunction( startAudioLoopBack, void, (const char* source, const char* params, bool realtime), ("", "", true),
+   "Start the AudioLoopBack capture thread.\n"
+   "@param source Capture source: \"wasapi\" (default, Windows only), \"wav\" or \"synth\".\n"
+   "@param params File name for \"wav\", signal description for \"synth\" eg: \"sine 440 0.5; noise 0.05\".\n"
+   "@param realtime Pace \"wav\" and \"synth\" sources at their sample rate, false runs as fast as possible.\n"
    "@return Nothing.\n"
    "@ingroup AudioLoopBack" )
 {
    if(_activeLoopbackThread == NULL){
-      _activeLoopbackThread = new AudioLoopbackThread(false, true); // autodelete is true to be self cleaning
+      AudioCaptureSource* capture = AudioCaptureSource::create(source, params, realtime);
+      if(!capture){
+         Con::warnf("startAudioLoopBack: Could not create capture source: %s", source);
+         return;
+      }
+      _activeLoopbackThread = new AudioLoopbackThread(capture, false, true); // autodelete is true to be self cleaning
       _activeLoopbackThread->start();
    }else{
       Con::warnf("startAudioLoopBack: Existing active audio loopback thread.  New loopback thread not created.");
@@ -545,7 +660,7 @@ DefineEngineFunction( startAudioLoopBack, void, (),,
 }
 
 DefineEngineFunction( stopAudioLoopBack, void, (),,
-   "Get the frequency information from processing the current AudioLoopBack\n"
+   "Stop the AudioLoopBack capture thread started by startAudioLoopBack, returns once the thread has exited.\n"
    "@param No parameters.\n"
    "@return Nothing.\n"
    "@ingroup AudioLoopBack" )
@@ -553,10 +668,74 @@ DefineEngineFunction( stopAudioLoopBack, void, (),,
    if(_activeLoopbackThread != NULL){
       _activeLoopbackThread->stop();      
       _activeLoopbackThread = NULL;
+      // the thread deletes itself, wait for it so the ring and stats are free when we return
+      AudioLoopbackThread::waitForRingFree();
    }else{
-      Con::warnf("startAudioLoopBack: No active audio loopback to stop.");
+      Con::warnf("stopAudioLoopBack: No active audio loopback to stop.");
    }
 }
+DefineEngineFunction( benchmarkAudioLoopBack, F32, (U32 hops, const char* source, const char* params), (100, "synth", ""),
+   "Run the capture and processing loop on the calling thread as fast as possible.\n"
+   "Processes every LoopBackObject added with addAudioLoopBackObject.\n"
+   "Also prints the FFT plan, scratch buffer and sample block allocations made during the run.\n"
+   "@param hops Number of capture cycles to run.\n"
+   "@param source Capture source, \"synth\" or \"wav\".\n"
+   "@param params File name for \"wav\", signal description for \"synth\".\n"
+   "@return Speed relative to realtime, zero on failure.\n"
+   "@ingroup AudioLoopBack" )
+{
+   if(_activeLoopbackThread != NULL){
+      Con::warnf("benchmarkAudioLoopBack: Stop the active audio loopback thread first.");
+      return 0.0f;
+   }
+
+   AudioCaptureSource* capture = AudioCaptureSource::create(source, params, false);
+   if(!capture){
+      Con::warnf("benchmarkAudioLoopBack: Could not create capture source: %s", source);
+      return 0.0f;
+   }
+
+   // thread object is only used for its processing loop, it is never started
+   AudioLoopbackThread bench(capture, false, false);
+   U32 planAllocs = AudioFFTPlanCache::getAllocCount();
+   U32 scratchAllocs = AudioScratchBuffer::getAllocCount();
+   U32 blockAllocs = AudioSampleBlock::getAllocCount();
+   U32 start = Platform::getRealMilliseconds();
+   if(!bench.runHops(hops)){
+      Con::warnf("benchmarkAudioLoopBack: Capture source failed.");
+      return 0.0f;
+   }
+   U32 elapsed = getMax(Platform::getRealMilliseconds() - start, U32(1));
+
+   F32 audioms = F32(hops*AUDIO_CAPTURE_HOP_MS);
+   F32 factor = audioms/F32(elapsed);
+   Con::printf("benchmarkAudioLoopBack: %d hops, %.0f ms of audio in %d ms (%.1fx realtime)", hops, audioms, elapsed, factor);
+   // these only grow while new sizes or threads are seen, they should not scale with hops
+   Con::printf("benchmarkAudioLoopBack: %d FFT plan allocations, %d scratch buffer allocations, %d sample block data allocations",
+      AudioFFTPlanCache::getAllocCount() - planAllocs, AudioScratchBuffer::getAllocCount() - scratchAllocs,
+      AudioSampleBlock::getAllocCount() - blockAllocs);
+
+   return factor;
+}
+
+DefineEngineFunction( getAudioLoopBackStats, const char*, (),,
+   "Get capture and analysis counters for the current or last AudioLoopBack run.\n"
+   "Overruns mean the analysis could not keep up and skipped audio, underruns mean the analysis "
+   "waited without receiving any audio, discontinuities are glitches reported by the capture device.\n"
+   "@param No parameters.\n"
+   "@return \"packets frames discontinuities blocks analysedframes overruns droppedframes underruns maxbacklog\"\n"
+   "@ingroup AudioLoopBack" )
+{
+   AudioLoopbackStats& stats = AudioLoopbackThread::getStats();
+
+   char* retBuffer = Con::getReturnBuffer(256);
+   dSprintf(retBuffer, 256, "%d %d %d %d %d %d %d %d %d",
+      stats.capturePackets, stats.captureFrames, stats.discontinuities,
+      stats.analysisBlocks, stats.analysisFrames, stats.overruns, stats.droppedFrames,
+      stats.underruns, stats.maxBacklog);
+   return retBuffer;
+}
+
 /*
 DefineEngineFunction( onProcessAudioLoopBack, void, (),,
    "Called by the loopback thread or from script to process audio data.\n"
@@ -575,7 +754,7 @@ DefineEngineFunction( addAudioLoopBackObject, void, (SimObject* obj),,
 {   
    LoopBackObject *tobj = dynamic_cast<LoopBackObject*>(obj);
    if(tobj)
-      AudioLoopbackThread::addLoopbackObject(tobj);
+      AudioAnalysisThread::addLoopbackObject(tobj);
    else
       Con::warnf("addAudioLoopBackObject - Attempt to add non LoopBackObject to AudioLoopBack processing.");
 }
@@ -588,7 +767,7 @@ DefineEngineFunction( removeAudioLoopBackObject, void, (SimObject* obj),,
 {   
    LoopBackObject *tobj = dynamic_cast<LoopBackObject*>(obj);
    if(tobj)
-      AudioLoopbackThread::removeLoopbackObject(tobj);
+      AudioAnalysisThread::removeLoopbackObject(tobj);
    else
       Con::warnf("addAudioLoopBackObject - Attempt to remove non LoopBackObject from AudioLoopBack processing.");
 }
@@ -600,36 +779,86 @@ DefineConsoleMethod( LoopBackObject, delete, void, (),,
 {
    Con::printf("LoopBackObject: Special Delete called.");
    if(_activeLoopbackThread != NULL){
-      _activeLoopbackThread->removeLoopbackObject(object);
+      AudioAnalysisThread::removeLoopbackObject(object);
    }
    object->deleteObject();
 }
 */
 
-DefineEngineMethod(FFTObject, setAudioFreqBands, void, (const char* bandfreqstr),,
-   "Set FFTObject frequency bands.\n"
-   "@param Comma or space separated list of positive integers.\n"
-   "@return Nothing.\n"
-   "@ingroup AudioLoopBack")
-{
-   Vector<U32> tmpbands;
+const char* formatAudioFloatList(const Vector<F32>& values, const char* format){
+   MemStream tempStream(256);
+   char buff[32];
+   for(U32 count=0; count<values.size(); count++){
+      if(count)
+         tempStream.writeText(" ");
+      dSprintf(buff,32,format,values[count]);
+      tempStream.writeText(buff);
+   }
+   char *ret = Con::getReturnBuffer(tempStream.getStreamSize()+1);
+   dStrncpy(ret, (char *)tempStream.getBuffer(), tempStream.getStreamSize());
+   ret[tempStream.getStreamSize()] = '\0';
+
+   return ret;
+}
 
-   char *buff = new char[dStrlen(bandfreqstr)];
-   dStrncpy(buff,bandfreqstr,dStrlen(bandfreqstr));
+const char* formatAudioU32List(const Vector<U32>& values){
+   MemStream tempStream(256);
+   char buff[32];
+   for(U32 count=0; count<values.size(); count++){
+      if(count)
+         tempStream.writeText(" ");
+      dSprintf(buff,32,"%u",values[count]);
+      tempStream.writeText(buff);
+   }
+   char *ret = Con::getReturnBuffer(tempStream.getStreamSize()+1);
+   dStrncpy(ret, (char *)tempStream.getBuffer(), tempStream.getStreamSize());
+   ret[tempStream.getStreamSize()] = '\0';
+
+   return ret;
+}
+
+void parseAudioFreqBands(const char* bandfreqstr, Vector<U32>& retbands){
+   retbands.clear();
+
+   U32 length = dStrlen(bandfreqstr);
+   char *buff = new char[length+1];
+   dStrcpy(buff,bandfreqstr);
    char *value;
    value = dStrtok(buff, " ,");   
       
    while(value != NULL){
       U32 tmp = dAtoui(value);
-      tmpbands.push_back(tmp);
+      retbands.push_back(tmp);
       
       value = dStrtok(NULL, " ,");
    }   
 
+   delete [] buff;   
+}
+
+DefineEngineMethod(LoopBackObject, getProcessedOutput, const char*, (),,
+   "Get the processed output of any analysis object, the layout depends on the object type.\n"
+   "@param Nothing.\n"
+   "@return Space separated list of floats, empty for a plain LoopBackObject.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getProcessedOutput(tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+DefineEngineMethod(FFTObject, setAudioFreqBands, void, (const char* bandfreqstr),,
+   "Set FFTObject frequency bands.\n"
+   "@param Comma or space separated list of positive integers.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<U32> tmpbands;
+   parseAudioFreqBands(bandfreqstr, tmpbands);
+
    // set bands on object
    object->setAudioFreqBands(tmpbands);
-
-   delete buff;   
 }
 
 DefineEngineMethod(FFTObject, getAudioFreqBands, const char*, (),,
@@ -639,22 +868,11 @@ DefineEngineMethod(FFTObject, getAudioFreqBands, const char*, (),,
    "@ingroup AudioLoopBack")
 {
    Vector<U32> tmpbands;
-   Vector<U32>::iterator i;
    
    // get bands from object
    object->getAudioFreqBands(tmpbands);
 
-   MemStream tempStream(256);
-   char buff[32];
-   for(i=tmpbands.begin(); i != tmpbands.end(); i++){
-      dSprintf(buff,32,"%d ",*i);
-      tempStream.writeText(buff);
-   }   
-   char *ret = Con::getReturnBuffer(tempStream.getStreamSize());
-   dStrncpy(ret, (char *)tempStream.getBuffer(), tempStream.getStreamSize()-1);
-   ret[tempStream.getStreamSize()-1] = '\0';
-
-   return ret;
+   return formatAudioU32List(tmpbands);
 }
 
 DefineEngineMethod(FFTObject, getAudioFreqOutput, const char*, (),,
@@ -664,24 +882,133 @@ DefineEngineMethod(FFTObject, getAudioFreqOutput, const char*, (),,
    "@ingroup AudioLoopBack")
 {
    Vector<F32> tmpoutput;
-   Vector<F32>::iterator i;
    
    // get bands from object
    object->getAudioFreqOutput(tmpoutput);
 
-   MemStream tempStream(256);
-   char buff[32];
-   for(i=tmpoutput.begin(); i != tmpoutput.end(); i++){
-      dSprintf(buff,32,"%.4f ",*i);
-      tempStream.writeText(buff);
-   }   
-   char *ret = Con::getReturnBuffer(tempStream.getStreamSize());
-   dStrncpy(ret, (char *)tempStream.getBuffer(), tempStream.getStreamSize()-1);
-   ret[tempStream.getStreamSize()-1] = '\0';
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
+DefineEngineMethod(FFTObject, setFrameSize, void, (U32 size, F32 overlap), (AUDIO_FFT_FRAME_SIZE, AUDIO_FFT_OVERLAP),
+   "Set the FFT frame size and how much consecutive frames overlap.\n"
+   "Larger frames resolve low frequencies better but respond slower, overlap gives more "
+   "spectra per second from the same audio.\n"
+   "@param size Frame size in samples, rounded up to a power of 2 (64 to 32768).\n"
+   "@param overlap Fraction of each frame shared with the next, 0.5 is 50%, 0.75 is 75% (0 to 0.9).\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setFrameSize(size, overlap);
+}
+
+DefineEngineMethod(FFTObject, getFrameSize, U32, (),,
+   "Get the FFT frame size.\n"
+   "@param Nothing.\n"
+   "@return Frame size in samples.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getFrameSize();
+}
+
+DefineEngineMethod(FFTObject, setWindow, void, (const char* window), ("hann"),
+   "Set the window applied to each FFT frame.\n"
+   "@param window \"hann\" (default), \"hamming\", \"blackmanharris\" (low leakage) or \"flattop\" (accurate levels).\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   AudioWindow::WindowType type = AudioWindow::getTypeFromName(window);
+   if(type == AudioWindow::WindowTypeCount){
+      Con::warnf("FFTObject::setWindow - unknown window: %s", window);
+      return;
+   }
+   object->setWindowType(type);
+}
+
+DefineEngineMethod(FFTObject, getWindow, const char*, (),,
+   "Get the window applied to each FFT frame.\n"
+   "@param Nothing.\n"
+   "@return Window name.\n"
+   "@ingroup AudioLoopBack")
+{
+   return AudioWindow::getTypeName(object->getWindowType());
+}
+
+DefineEngineMethod(FFTObject, getHopSize, U32, (),,
+   "Get the number of samples between the start of consecutive FFT frames.\n"
+   "@param Nothing.\n"
+   "@return Hop size in samples.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getHopSize();
+}
+
+DefineEngineMethod(FFTObject, setAttackRelease, void, (F32 attackMs, F32 releaseMs, S32 band), (AUDIO_FFT_ATTACK_MS, AUDIO_FFT_RELEASE_MS, -1),
+   "Set how fast the band output follows the audio.  The times do not depend on the frame "
+   "size, overlap or capture rate so visuals keep their feel when the hop changes.\n"
+   "@param attackMs Time constant for rising levels in mS, 0 follows instantly.\n"
+   "@param releaseMs Time constant for falling levels in mS.\n"
+   "@param band Band index, -1 (default) sets every band.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setAttackRelease(attackMs, releaseMs, band);
+}
+
+DefineEngineMethod(FFTObject, getAttackRelease, const char*, (U32 band), (0),
+   "Get the attack and release time constants of a band.\n"
+   "@param band Band index.\n"
+   "@return \"attack release\" in mS, empty if there is no such band.\n"
+   "@ingroup AudioLoopBack")
+{
+   F32 attackMs, releaseMs;
+   if(!object->getAttackRelease(band, attackMs, releaseMs))
+      return "";
 
+   char *ret = Con::getReturnBuffer(64);
+   dSprintf(ret, 64, "%.1f %.1f", attackMs, releaseMs);
    return ret;
 }
 
+DefineEngineMethod(FFTObject, setHistorySize, void, (U32 rows), (256),
+   "Keep the last rows band outputs for spectrograms and waterfall displays.\n"
+   "@param rows Number of rows kept (0 to 4096), 0 turns the history off.\n"
+   "@return Nothing.\n"
+   "@ingroup AudioLoopBack")
+{
+   object->setHistorySize(rows);
+}
+
+DefineEngineMethod(FFTObject, getHistorySize, U32, (),,
+   "Get the number of band output rows kept in the history.\n"
+   "@param Nothing.\n"
+   "@return Number of rows, 0 if the history is off.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getHistorySize();
+}
+
+DefineEngineMethod(FFTObject, getHistoryCount, U32, (),,
+   "Get the number of rows written to the history, a script can poll this to see how many "
+   "new rows there are.\n"
+   "@param Nothing.\n"
+   "@return Rows written since the history was turned on or the bands changed.\n"
+   "@ingroup AudioLoopBack")
+{
+   return object->getHistoryCount();
+}
+
+DefineEngineMethod(FFTObject, getHistoryRow, const char*, (U32 age), (0),
+   "Get one row of the band output history.\n"
+   "@param age 0 for the newest row, 1 for the one before and so on.\n"
+   "@return Space separated list of floats, empty if the row is not in the history.\n"
+   "@ingroup AudioLoopBack")
+{
+   Vector<F32> tmpoutput;
+   object->getHistoryRow(age, tmpoutput);
+
+   return formatAudioFloatList(tmpoutput, "%.4f");
+}
+
 // resources
 // http://stackoverflow.com/questions/9645983/fft-applying-window-on-pcm-data
 // http://stackoverflow.com/questions/4675457/how-to-generate-the-audio-spectrum-using-fft-in-c
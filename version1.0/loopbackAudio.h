@@ -2,11 +2,10 @@
 #define _LOOPBACK_AUDIO_H_
 
 #include <core/util/tVector.h>
-#ifndef TORQUE_OS_XENON
-#include "platformWin32/platformWin32.h"
-#endif
 #include "platform/threads/thread.h"
 #include "platform/threads/mutex.h"
+#include "platform/threads/semaphore.h"
+#include "platform/threads/threadPool.h"
 #include "console/console.h"
 #include "platform/platformIntrinsics.h"
 //#include "scene/sceneObject.h"
@@ -16,13 +15,13 @@
 #include "gui/core/guiTypes.h"
 #include "gui/worldEditor/gizmo.h"
 
-#include <mmsystem.h>
-#undef INITGUID
-#include <mmdeviceapi.h>
-#include <dsound.h>
-#include <Audioclient.h>
-#include <Audiopolicy.h>
-#include <Mmreg.h>
+#include "audioCaptureSource.h"
+#include "audioFFT.h"
+#include "audioFramer.h"
+#include "audioWindow.h"
+#include "audioKernels.h"
+#include "audioAnalysisGraph.h"
+#include "audioSharedSpectrum.h"
 
 class BaseMatInstance;
 
@@ -30,85 +29,178 @@ class BaseMatInstance;
 #define AUDIO_FFT_BINS 256
 #define AUDIO_DATA_GAIN 1.0f
 
-#define AUDIO_NUM_CHANNELS 2
+// default STFT framing for FFTObject, 4096 frames is ~85 mS at 48 kHz
+#define AUDIO_FFT_FRAME_SIZE 4096
+#define AUDIO_FFT_OVERLAP 0.5f
+#define AUDIO_FFT_WINDOW AudioWindow::WindowHann
+// band output smoothing for every AUDIO_CAPTURE_HOP_MS of audio, scaled to the actual hop
+#define AUDIO_FFT_SMOOTHING 0.5f
+// default FFTObject band attack and release time constants in mS
+//    144 mS is the same as AUDIO_FFT_SMOOTHING with 100 mS captures
+#define AUDIO_FFT_ATTACK_MS 144.27f
+#define AUDIO_FFT_RELEASE_MS 144.27f
+// most band output rows FFTObject keeps for spectrograms, the history is off by default
+#define AUDIO_FFT_HISTORY_MAX_ROWS 4096
 
-//#define REFTIMES_PER_SEC  10000000
-//#define REFTIMES_PER_SEC  (10000000/20) // run every 50 mS
-#define REFTIMES_PER_SEC  (10000000/10) // run every 100 mS - much better freq delineation at the low end
-//#define REFTIMES_PER_SEC  (10000000/5) // run every 200 mS
-//#define REFTIMES_PER_SEC  (10000000/50) // run every 20 mS
-#define REFTIMES_PER_MILLISEC  (REFTIMES_PER_SEC/1000)
+// AUDIO_NUM_CHANNELS and REFTIMES_PER_SEC are defined in audioCaptureSource.h
 
-#define AUDIOLB_EXIT_ON_ERROR(hres)  \
-      if (FAILED(hres)) { goto Exit; }
-#define AUDIOLB_SAFE_RELEASE(punk)  \
-      if ((punk) != NULL)  \
-         { (punk)->Release(); (punk) = NULL; }
+// size of the capture ring in frames, ~5 seconds at 48 kHz
+//    readers more than 3/4 of this behind lose data
+#define AUDIO_RING_FRAMES (1 << 18)
+
+// objects are only farmed out to the worker pool when there are at least this many
+#define AUDIO_PARALLEL_MIN_OBJECTS 4
 
 class LoopBackObject;
+class AudioSampleBlock;
 
-class AudioLoopbackThread : public Thread
+// state for processing one block across the worker pool
+//    workers pull chunks of objects using an atomic index so fast workers take more of the list
+struct LoopBackProcessJob
+{
+   AudioSampleBlock* block;
+   LoopBackObject** objects;
+   U32 count;
+   U32 chunk;
+   volatile U32 next;      // next object to be processed
+   volatile U32 pending;   // work items that have not finished
+   Semaphore done;         // released by the last work item to finish
+
+   // process chunks until the list is exhausted
+   void processChunks();
+};
+
+// capture and analysis health, readable from script with getAudioLoopBackStats()
+//    each counter has a single writer, the capture or the analysis thread
+struct AudioLoopbackStats
+{
+   // capture thread
+   volatile U32 capturePackets;   // packets published to the ring
+   volatile U32 captureFrames;    // frames published to the ring
+   volatile U32 discontinuities;  // glitches reported by the source, eg: WASAPI buffer overruns
+
+   // analysis thread
+   volatile U32 analysisBlocks;   // blocks processed
+   volatile U32 analysisFrames;   // frames processed
+   volatile U32 overruns;         // analysis fell too far behind the capture and skipped data
+   volatile U32 droppedFrames;    // frames skipped by overruns
+   volatile U32 underruns;        // analysis waited a full timeout without receiving data
+   volatile U32 maxBacklog;       // most frames waiting in the ring when analysis woke up
+
+   void reset(){
+      capturePackets = captureFrames = discontinuities = 0;
+      analysisBlocks = analysisFrames = overruns = droppedFrames = underruns = maxBacklog = 0;
+   }
+};
+
+// how long the analysis thread waits for a packet before counting an underrun
+#define AUDIO_ANALYSIS_TIMEOUT_MS 500
+// most audio the analysis will process in one pass, older data is skipped as an overrun
+//    keeps a slow pass from producing an even larger (slower) block on the next pass
+#define AUDIO_ANALYSIS_MAX_BACKLOG_MS 250
+
+/*
+Analysis side of the loopback.  Drains whatever the capture thread has published to the
+sample ring since the last pass, copies it into one shared AudioSampleBlock and runs every
+registered LoopBackObject on it.  Runs on its own thread so slow objects never hold up
+the capture; if it falls too far behind it skips ahead and counts an overrun.
+*/
+class AudioAnalysisThread : public Thread
 {
 private:
-   HRESULT hr;
-   REFERENCE_TIME hnsRequestedDuration;
-   REFERENCE_TIME hnsActualDuration;
-   UINT32 bufferFrameCount;
-   UINT32 numFramesAvailable;
-   IMMDeviceEnumerator *pEnumerator;
-   IMMDevice *pDevice;
-   IAudioClient *pAudioClient;
-   IAudioCaptureClient *pCaptureClient;
-   WAVEFORMATEX *pwfx;
-   UINT32 packetLength;      
-   BYTE *pData;
-   DWORD flags;    
-
-   // internal sample data
-   F32 *internalSampleData;
+   AudioSampleRing* mRing;
+   // next frame to copy out of the ring into a shared block
+   U32 mReadIndex;
+   // number of blocks published
+   U32 mSequence;
+   // released by the capture thread after every publish
+   Semaphore mDataReady;
+
+   // workers for processing loopback objects, per hop list of live objects
+   ThreadPool* mProcessPool;
+   Vector<LoopBackObject*> mProcessList;
+   LoopBackProcessJob mProcessJob;
 
    static Mutex loopbackObjectsMutex;
    static Vector<SimObjectPtr<LoopBackObject>> loopbackObjects;
 
-private:
-   // contol access to buffer and details
-   static Mutex sampleBufferMutex;      
-   // 2 channels in the sample buffer
-   static F32* sampleBuffer;  // should this memory ever be freed?
-   static U32 sampleBufferSize; // total size of buffer divided by 2 (stereo data)
-   static U32 sampleBufferSamples; // total number of samples in buffer
-   static U32 samplesPerSecond;  // used to calculate bin freqs
-             
 public:
-   AudioLoopbackThread(bool start_thread = false, bool autodelete = false);
-   ~AudioLoopbackThread();
+   AudioAnalysisThread(AudioSampleRing* ring);
+   ~AudioAnalysisThread();
 
    // overriden methods
    void run(void *arg /* = 0 */);
 
+   // start reading at the current ring write position
+   void reset();
+   // wake the thread, called by the capture thread after publishing
+   void signalData(){ mDataReady.release(); }
+
+   // process everything published since the last call
+   //    returns false if there was no new data
+   bool processAvailable();
+   // run process on all loopback objects with block, returns when every object is done
+   //    loopbackObjectsMutex must be held
+   void processObjects(AudioSampleBlock* block);
+
    // add/remove objects to process loop
    static void addLoopbackObject(LoopBackObject* obj);        
    static void removeLoopbackObject(LoopBackObject* obj);   
 };
 
-//AudioLoopbackThread *_activeLoopbackThread = NULL;
+/*
+Capture side of the loopback.  Only reads the source and publishes to the sample ring,
+all processing happens on the AudioAnalysisThread it owns.
+*/
+class AudioLoopbackThread : public Thread
+{
+private:
+   // where the samples come from, owned by the thread
+   AudioCaptureSource* mSource;
+   // drains the ring, owned by the thread
+   AudioAnalysisThread* mAnalysis;
+
+private:
+   // captured stereo data, written by this thread only
+   //    each packet is copied out once into an AudioSampleBlock shared by all LoopBackObjects
+   static AudioSampleRing sampleRing;
+
+   static AudioLoopbackStats stats;
+   // held by the one AudioLoopbackThread using sampleRing and stats, from construction until
+   //    destruction, so a new thread or benchmark waits for a stopped thread to finish
+   static Semaphore ringFree;
+             
+public:
+   AudioLoopbackThread(AudioCaptureSource* source, bool start_thread = false, bool autodelete = false);
+   ~AudioLoopbackThread();
+
+   // overriden methods
+   void run(void *arg /* = 0 */);
+
+   // read one packet from the source and publish it to the ring
+   // returns false if the source failed
+   bool processCapture();
+   // run hops capture and analysis cycles on the calling thread, used for benchmarks with non realtime sources
+   bool runHops(U32 hops);
+
+   static AudioLoopbackStats& getStats(){ return stats; }
+   // block until no thread is using the ring, eg: after stop() on a self deleting thread
+   static void waitForRingFree(){ ringFree.acquire(true); ringFree.release(); }
+};
+
+// thread started by startAudioLoopBack, NULL when stopped
+extern AudioLoopbackThread *_activeLoopbackThread;
 
 class LoopBackObject : public SimObject
 {
 typedef SimObject Parent;
 
 protected:       
-   // external data source buffer
-   Mutex* extSampleBufferMutex;
-   F32** extSampleBuffer;
-   U32* extSampleBufferSize;
-   U32* extSampleBufferSamples;
-   U32* extSamplesPerSecond; 
-
    // internal object data
+   //    the sample block is read only and shared with every other LoopBackObject
+   //    derived objects that need to modify the samples must copy them to their own buffer
    Mutex objectSampleBufferMutex; 
-   F32* objectSampleBuffer;
-   U32 objectSampleBufferSize;
+   AudioSampleBlockRef objectSampleBlock;
    U32 objectSampleBufferSamples;
    U32 objectSamplesPerSecond;
    // flag to indicate that the data has changed
@@ -122,15 +214,22 @@ public:
    LoopBackObject();
    virtual ~LoopBackObject();      
 
-   virtual void setExtSampleBuffer(Mutex* extmut, F32** extbuff, U32* extbuffsize, U32* extbuffsamples, U32* extsamplessecond);
    void setRemoveFunction(void (*rfunc)(LoopBackObject* object)){removeFunc = rfunc;}
-   virtual void clearExtSampleBuffer();
+   bool hasRemoveFunction(){return removeFunc != NULL;}
+
+   // stop processing before the object leaves the sim, events posted by process_unique
+   //    are cancelled after onRemove and none can be posted once the object is removed
+   virtual void onRemove();
 
-   virtual void process();
+   // take a reference to the newest block and run process_unique on it
+   virtual void process(AudioSampleBlock* block);
    // placeholder for sub classes
    // objectSampleBufferMutex should be acquired before calling this function, see LoopBackObject::process()
    virtual void process_unique(){};
 
+   // read only access to the current block for derived objects
+   const F32* getSampleData(){ return objectSampleBlock ? objectSampleBlock->getData() : NULL; }
+
    // check for data changed
    //    the mDataChanged flag will update on each new sample from the source
    //    it is simply a counter that will roll over after 4 billion plus counts
@@ -147,7 +246,8 @@ public:
       mutex.lock( &objectSampleBufferMutex, true );      
 
       retoutput.clear();
-      retoutput.set( objectSampleBuffer, objectSampleBufferSamples*AUDIO_NUM_CHANNELS );   
+      if(objectSampleBlock)
+         retoutput.set( objectSampleBlock->getData(), objectSampleBufferSamples*AUDIO_NUM_CHANNELS );   
 
       return mDataChanged;
    }
@@ -163,6 +263,14 @@ public:
    DECLARE_CONOBJECT(LoopBackObject);
 };
 
+// format a list of floats as a space separated console return string
+//    format is a printf format for one value, eg "%.4f"
+const char* formatAudioFloatList(const Vector<F32>& values, const char* format);
+// format a list of unsigned integers (band frequencies, stage numbers) the same way
+const char* formatAudioU32List(const Vector<U32>& values);
+// parse a comma or space separated list of band frequencies from script
+void parseAudioFreqBands(const char* bandfreqstr, Vector<U32>& retbands);
+
 class FFTObject : public LoopBackObject
 {
 typedef LoopBackObject Parent;
@@ -170,8 +278,41 @@ typedef LoopBackObject Parent;
 private:
    // protect FFT data in FFTObject
    Mutex objectFFTDataMutex;     
+   // STFT framing of the stereo stream, fixed size overlapping frames
+   U32 objectFrameSize;
+   U32 objectHopSize;
+   F32 objectOverlap;
+   AudioWindow::WindowType objectWindowType;
+   // spectra for the frame size, hop and window, shared with every other object using
+   //    the same settings, looked up again when NULL
+   AudioSharedSpectrum* objectSpectrum;
+   // rate the smoothing and band table were set up for
+   U32 objectFramerRate;
+   // per band attack and release time constants in mS for the band output, and the
+   //    smoothing coefficients they work out to at the current hop and rate
+   Vector<F32> objectAttackTimes;
+   Vector<F32> objectReleaseTimes;
+   Vector<F32> objectAttackCoefs;
+   Vector<F32> objectReleaseCoefs;
+   // per band power before smoothing
+   Vector<F32> objectBandBuffer;
+   // first bin of each band, band n covers bins objectBandEdges[n] to objectBandEdges[n+1]-1
+   Vector<U32> objectBandEdges;
+   // set when the bands, sample rate or frame size change
+   bool objectBandTableDirty;
    Vector<U32> AudioFreqBands;
    Vector<F32> AudioFreqOutput;      
+   // spectrogram history, objectHistoryRows band outputs of objectHistoryBands values stored
+   //    back to back, row n of the stream is at n % objectHistoryRows
+   Vector<F32> objectHistory;
+   U32 objectHistoryRows;
+   U32 objectHistoryBands;
+   // rows written since the history was cleared, wraps at 2^32
+   U32 objectHistoryCount;
+
+   // copy the band output into the history
+   //    objectFFTDataMutex must be held
+   void pushHistory();
 
 public:
    FFTObject();
@@ -179,6 +320,50 @@ public:
 
    // custom processing for FFT 
    virtual void process_unique();
+   // update the band output from the power spectrum of one frame
+   //    objectFFTDataMutex must be held
+   void processSpectrum(const F32* power);
+   // work out which bins go in which band for the current bands, rate and frame size
+   //    objectFFTDataMutex must be held
+   void buildBandTable();
+
+   // set the STFT frame size (power of 2) and overlap (0 to 0.9, 0.5 = 50%)
+   void setFrameSize(U32 size, F32 overlap){
+      MutexHandle mutex;
+      mutex.lock( &objectFFTDataMutex, true );
+
+      objectOverlap = mClampF(overlap, 0.0f, 0.9f);
+      objectFrameSize = AudioFramer::roundFrameSize(size);
+      objectHopSize = getMax(U32(objectFrameSize*(1.0f - objectOverlap)), U32(1));
+      AudioAnalysisGraph::releaseNode(objectSpectrum);
+      objectSpectrum = NULL;
+      // recalculates smoothing and the band table on the next block
+      objectFramerRate = 0;
+   }
+   U32 getFrameSize(){
+      MutexHandle mutex;
+      mutex.lock( &objectFFTDataMutex, true );
+      return objectFrameSize;
+   }
+   U32 getHopSize(){
+      MutexHandle mutex;
+      mutex.lock( &objectFFTDataMutex, true );
+      return objectHopSize;
+   }
+   // set the window applied to each frame
+   void setWindowType(AudioWindow::WindowType type){
+      MutexHandle mutex;
+      mutex.lock( &objectFFTDataMutex, true );
+
+      objectWindowType = type;
+      AudioAnalysisGraph::releaseNode(objectSpectrum);
+      objectSpectrum = NULL;
+   }
+   AudioWindow::WindowType getWindowType(){
+      MutexHandle mutex;
+      mutex.lock( &objectFFTDataMutex, true );
+      return objectWindowType;
+   }
 
    // set the freq bands
    void setAudioFreqBands(Vector<U32>& bands){
@@ -187,6 +372,14 @@ public:
              
       AudioFreqBands.clear();
       AudioFreqBands.merge(bands);
+      objectBandTableDirty = true;
+      // new bands start with the default time constants
+      for(U32 count=objectAttackTimes.size(); count<bands.size(); count++){
+         objectAttackTimes.push_back(AUDIO_FFT_ATTACK_MS);
+         objectReleaseTimes.push_back(AUDIO_FFT_RELEASE_MS);
+      }
+      objectAttackTimes.setSize(bands.size());
+      objectReleaseTimes.setSize(bands.size());
       U32 outsize = AudioFreqOutput.size();
       U32 bandsize = AudioFreqBands.size();
       if(outsize != bandsize){                    
@@ -215,6 +408,32 @@ public:
       retoutput.clear();
       retoutput.merge(AudioFreqOutput);         
    }
+   // set how fast a band output follows rising (attack) and falling (release) levels
+   //    time constants are in mS whatever the hop size, band -1 sets every band
+   void setAttackRelease(F32 attackMs, F32 releaseMs, S32 band = -1);
+   // returns false if there is no such band
+   bool getAttackRelease(U32 band, F32& attackMs, F32& releaseMs);
+
+   // keep the last rows band outputs, 0 turns the history off
+   void setHistorySize(U32 rows);
+   U32 getHistorySize(){
+      MutexHandle mutex;
+      mutex.lock( &objectFFTDataMutex, true );
+      return objectHistoryRows;
+   }
+   // rows written so far, the newest row is getHistoryCount()-1
+   U32 getHistoryCount(){
+      MutexHandle mutex;
+      mutex.lock( &objectFFTDataMutex, true );
+      return objectHistoryCount;
+   }
+   // copy the rows from startRow to the newest into retrows oldest first, retbands values per row
+   //    startRow is moved forward past rows that are no longer in the history
+   //    returns the number of rows copied
+   U32 getHistory(U32& startRow, Vector<F32>& retrows, U32& retbands);
+   // copy one row, age 0 is the newest, returns false if the row is not in the history
+   bool getHistoryRow(U32 age, Vector<F32>& retoutput);
+
    // get the processed FFT output
    // returns changed flag
    virtual U32 getProcessedOutput(Vector<F32>& retoutput){  
@@ -235,5 +454,18 @@ inline F32 hanningWindow(F32 data, U32 i, U32 s);
 // DSP method for filtering data, freq response is approximately that of a moving average, but is more tunable, flexible, and uses less memory
 //    used to "smooth" the data
 inline F32 lowPassFilter(F32 input, F32 last, F32 filter);
+// convert a lowPassFilter factor meant for one AUDIO_CAPTURE_HOP_MS step to one for a step of hopFrames
+//    keeps the same amount of smoothing per unit of time whatever the analysis hop is
+inline F32 getHopSmoothing(F32 filter, U32 hopFrames, U32 samplesPerSecond){
+   F32 hopsPerCapture = (F32)(samplesPerSecond*AUDIO_CAPTURE_HOP_MS)/(1000.0f*getMax(hopFrames, U32(1)));
+   return 1.0f - mPow(1.0f - filter, 1.0f/getMax(hopsPerCapture, 0.001f));
+}
+// lowPassFilter factor for a time constant in mS at a step of hopFrames
+//    the output covers 63% of a step change after timeMs whatever the hop is, 0 mS follows instantly
+inline F32 getHopCoefficient(F32 timeMs, U32 hopFrames, U32 samplesPerSecond){
+   if(timeMs <= 0.0f || !samplesPerSecond)
+      return 1.0f;
+   return 1.0f - mExp(-(F32)getMax(hopFrames, U32(1))*1000.0f/(samplesPerSecond*timeMs));
+}
 
 #endif // _LOOPBACK_AUDIO_H_
\ No newline at end of file
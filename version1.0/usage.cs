@@ -51,4 +51,19 @@ new AudioTextureObject(AudioTexObject1) {
    scale = "1 1 1";
    canSave = "1";
    canSaveDynamicFields = "1";
+};
+
+/*
+ Scrolling spectrogram of an FFTObject, one row per band output with the newest at the bottom.
+ Only the new rows are uploaded each hop, set the FFTObject with setAudioObject as above.
+*/
+new AudioTextureObject(AudioWaterfallObject1) {
+   texture = "hellotex";
+   displayMode = "waterfall";
+   waterfallRows = "256";
+   waterfallMin = "-5";
+   waterfallMax = "15";
+   position = "-3.90218 5.99547 1.92351";
+   rotation = "1 0 0 0";
+   scale = "1 1 1";
 };
\ No newline at end of file